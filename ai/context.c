@@ -7,17 +7,64 @@
 // This file is subject to the terms and conditions defined in
 // 'LICENSE', which is part of this source code package.
 //
+// The audio thread keeps a handful of small buffers queued on one
+// OpenAL source, refilling each from the ring as it finishes playing.
+// How much audio is waiting (in the ring plus in the resampler) steers
+// the resampling ratio: a little faster when it builds up, a little
+// slower when it runs low, so the emulator's and the sound card's idea
+// of the sample rate never have to agree exactly.
+//
 
 #include "common.h"
+#include "thread.h"
+#include "timer.h"
 #include "ai/context.h"
+#include "ai/resample.h"
+#include "ai/ring.h"
+
+// Input frames we try to keep waiting, and how far (at most) the
+// ratio gets bent to get back there. 0.5% is well below what's audible.
+#define AI_CONTEXT_TARGET_FRAMES 2048
+#define AI_CONTEXT_MAX_SKEW 0.005
+
+// How often the audio thread looks for finished buffers.
+#define AI_CONTEXT_POLL_NS 2000000
+
+static CEN64_THREAD_RETURN_TYPE ai_context_thread(void *opaque);
+
+// Fills one buffer with the next chunk of resampled audio.
+static void ai_context_fill(struct cen64_ai_context *context, ALuint buffer) {
+  unsigned in_rate = context->ring.rate;
+  double step = 1.0, skew;
+
+  if (in_rate) {
+    context->fill += (ai_ring_count(&context->ring) +
+      context->resampler.frames - context->fill) * 0.05;
+
+    skew = (context->fill - AI_CONTEXT_TARGET_FRAMES) /
+      AI_CONTEXT_TARGET_FRAMES;
+
+    if (skew > 1.0)
+      skew = 1.0;
+    else if (skew < -1.0)
+      skew = -1.0;
+
+    step = (double) in_rate / AI_OUTPUT_RATE *
+      (1.0 + skew * AI_CONTEXT_MAX_SKEW);
+  }
+
+  if (ai_resample(&context->resampler, &context->ring, context->out,
+    AI_CONTEXT_BUFFER_FRAMES, step) < AI_CONTEXT_BUFFER_FRAMES && in_rate)
+    context->underruns++;
+
+  alBufferData(buffer, AL_FORMAT_STEREO16, context->out,
+    sizeof(context->out), AI_OUTPUT_RATE);
+}
 
 // Creates and initializes an audio context.
 int ai_context_create(struct cen64_ai_context *context) {
-  uint8_t buf[8];
   unsigned i;
 
-  context->cur_frequency = 31985;
-
   if ((context->dev = alcOpenDevice(NULL)) == NULL) {
     printf("Failed to open the OpenAL device.\n");
     return 1;
@@ -32,70 +79,92 @@ int ai_context_create(struct cen64_ai_context *context) {
   alcMakeContextCurrent(context->ctx);
 
   // Context/device is setup, create some buffers and a source.
-  alGenBuffers(sizeof(context->buffers) / sizeof(*context->buffers),
-    context->buffers);
+  alGenBuffers(AI_CONTEXT_BUFFERS, context->buffers);
 
-  if (alGetError() != AL_NO_ERROR) {
-    alcMakeContextCurrent(NULL);
-    alcDestroyContext(context->ctx);
-    alcCloseDevice(context->dev);
-    return 1;
-  }
+  if (alGetError() != AL_NO_ERROR)
+    goto err_buffers;
 
   alGenSources(1, &context->source);
 
-  if (alGetError() != AL_NO_ERROR) {
-    alDeleteBuffers(sizeof(context->buffers) / sizeof(*context->buffers),
-      context->buffers);
+  if (alGetError() != AL_NO_ERROR)
+    goto err_source;
 
-    alcMakeContextCurrent(NULL);
-    alcDestroyContext(context->ctx);
-    alcCloseDevice(context->dev);
-    return 1;
-  }
+  memset(&context->ring, 0, sizeof(context->ring));
+  ai_resampler_init(&context->resampler, AI_OUTPUT_RATE);
+  context->exiting = false;
+  context->fill = 0;
+  context->underruns = 0;
+
+  // Queue/prime buffers with silence to prevent pops. Playing
+  // them also allows us to verify that we (probably) won't get
+  // weird OpenAL errors later on if things work now.
+  for (i = 0; i < AI_CONTEXT_BUFFERS; i++)
+    ai_context_fill(context, context->buffers[i]);
 
-  // Queue/prime buffers, clear them to prevent pops.
-  // Playing a little test also allows us to verify
-  // that we (probably) won't get weird OpenAL errors
-  // later on if things work now.
-  memset(buf, 0x0, sizeof(buf));
+  alSourceQueueBuffers(context->source, AI_CONTEXT_BUFFERS,
+    context->buffers);
+  alSourcePlay(context->source);
 
-  for (i = 0; i < sizeof(context->buffers) / sizeof(*context->buffers); i++)
-    alBufferData(context->buffers[i], AL_FORMAT_STEREO16,
-      buf, sizeof(buf), context->cur_frequency);
+  if (alGetError() != AL_NO_ERROR) {
+    printf("Failed to start OpenAL playback.\n");
+    goto err_thread;
+  }
 
-  context->unqueued_buffers = sizeof(context->buffers) /
-    sizeof(*context->buffers);
+  if (cen64_thread_create(&context->thread, ai_context_thread, context))
+    goto err_thread;
 
+  cen64_thread_setname(&context->thread, "audio");
   return 0;
+
+err_thread:
+  alDeleteSources(1, &context->source);
+err_source:
+  alDeleteBuffers(AI_CONTEXT_BUFFERS, context->buffers);
+err_buffers:
+  alcMakeContextCurrent(NULL);
+  alcDestroyContext(context->ctx);
+  alcCloseDevice(context->dev);
+  return 1;
 }
 
 // Destroys audio contexts made with ai_context_create.
 void ai_context_destroy(struct cen64_ai_context *context) {
+  context->exiting = true;
+  cen64_thread_join(&context->thread);
+
   alDeleteSources(1, &context->source);
-  alDeleteBuffers(sizeof(context->buffers) / sizeof(*context->buffers),
-    context->buffers);
+  alDeleteBuffers(AI_CONTEXT_BUFFERS, context->buffers);
 
   alcMakeContextCurrent(NULL);
   alcDestroyContext(context->ctx);
   alcCloseDevice(context->dev);
 }
 
-// Generate buffers for some given frequency.
-int ai_switch_frequency(struct cen64_ai_context *context, ALint frequency) {
-  alDeleteSources(1, &context->source);
-  alDeleteBuffers(sizeof(context->buffers) / sizeof(*context->buffers),
-    context->buffers);
+// Keeps the source fed until the context is destroyed.
+CEN64_THREAD_RETURN_TYPE ai_context_thread(void *opaque) {
+  struct cen64_ai_context *context = (struct cen64_ai_context *) opaque;
 
-  alGenBuffers(sizeof(context->buffers) / sizeof(*context->buffers),
-    context->buffers);
-  alGenSources(1, &context->source);
+  while (!context->exiting) {
+    ALint processed, state;
+    ALuint buffer;
 
-  context->cur_frequency = frequency;
+    alGetSourcei(context->source, AL_BUFFERS_PROCESSED, &processed);
 
-  context->unqueued_buffers = sizeof(context->buffers) /
-    sizeof(*context->buffers);
+    while (processed-- > 0) {
+      alSourceUnqueueBuffers(context->source, 1, &buffer);
+      ai_context_fill(context, buffer);
+      alSourceQueueBuffers(context->source, 1, &buffer);
+    }
 
-  return 0;
+    // If every buffer ran dry, the source stopped on its own.
+    alGetSourcei(context->source, AL_SOURCE_STATE, &state);
+
+    if (state != AL_PLAYING)
+      alSourcePlay(context->source);
+
+    sleep_ns(AI_CONTEXT_POLL_NS);
+  }
+
+  return CEN64_THREAD_RETURN_VAL;
 }
 
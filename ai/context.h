@@ -11,24 +11,43 @@
 #ifndef CEN64_AI_CONTEXT_H
 #define CEN64_AI_CONTEXT_H
 #include "common.h"
+#include "thread.h"
+#include "ai/resample.h"
+#include "ai/ring.h"
 #include <al.h>
 #include <alc.h>
 
+// OpenAL always plays at this rate; the AI's samples get resampled.
+#define AI_OUTPUT_RATE 48000
+
+// Buffers queued on the source, and frames in each (~10ms).
+#define AI_CONTEXT_BUFFERS 4
+#define AI_CONTEXT_BUFFER_FRAMES 512
+
 struct cen64_ai_context {
-  ALuint buffers[3];
-  ALuint unqueued_buffers;
-  ALuint cur_frequency;
-  ALuint frequency;
+  ALuint buffers[AI_CONTEXT_BUFFERS];
   ALuint source;
 
   ALCdevice *dev;
   ALCcontext *ctx;
+
+  // Filled by the AI, drained by the audio thread (which is the only
+  // one that talks to OpenAL once it's running).
+  struct ai_ring ring;
+  struct ai_resampler resampler;
+  int16_t out[AI_CONTEXT_BUFFER_FRAMES * 2];
+
+  cen64_thread thread;
+  volatile bool exiting;
+
+  // Smoothed count of frames waiting to be played.
+  double fill;
+
+  unsigned long long underruns;
 };
 
 cen64_cold int ai_context_create(struct cen64_ai_context *context);
 cen64_cold void ai_context_destroy(struct cen64_ai_context *context);
 
-int ai_switch_frequency(struct cen64_ai_context *context, ALint frequency);
-
 #endif
 
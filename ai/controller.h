@@ -13,6 +13,8 @@
 #include "common.h"
 #include "ai/context.h"
 
+struct ai_dump;
+
 enum ai_register {
 #define X(reg) reg,
 #include "ai/registers.md"
@@ -38,11 +40,14 @@ struct ai_controller {
 
   unsigned fifo_count, fifo_wi, fifo_ri;
   struct ai_fifo_entry fifo[2];
+  struct ai_dump *dump;
   bool no_output;
 };
 
 cen64_cold int ai_init(struct ai_controller *ai, struct bus_controller *bus,
-  bool no_interface);
+  bool no_interface, const char *dump_audio_path,
+  const char *dump_audio_format, bool dump_audio_wait);
+cen64_cold void ai_destroy(struct ai_controller *ai);
 
 // Only invoke ai_cycle_ when the counter has expired (timeout).
 void ai_cycle_(struct ai_controller *ai);
@@ -0,0 +1,305 @@
+//
+// ai/dump.c: AI output recording.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Each AI DMA is copied into a ring of preallocated slots along with
+// the sample rate it plays at; a writer thread writes them out. When
+// the writer falls behind, the AI drops whole DMAs rather than waiting,
+// unless asked to wait; the frames lost that way are reported on close.
+//
+// A WAV header can only hold one sample rate, so it records the rate
+// of the first DMA; should a game switch rates later on, the switch is
+// reported on stdout (which is the only record of the rate for raw
+// output in any case). When the output can be seeked, the header's
+// sizes are filled in on close; otherwise they're left at 0xFFFFFFFF,
+// which is what readers of streamed WAV expect.
+//
+
+#include "common.h"
+#include "thread.h"
+#include "ai/dump.h"
+#include <signal.h>
+
+#ifdef _WIN32
+#define fdopen _fdopen
+#endif
+
+#define AI_DUMP_WAV_HEADER_SIZE 44
+
+// Used for the header if nothing was ever played.
+#define AI_DUMP_DEFAULT_RATE 48000
+
+struct ai_dump_slot {
+  uint8_t samples[AI_DUMP_SLOT_SIZE];
+  uint32_t length;
+  unsigned rate;
+};
+
+struct ai_dump {
+  struct ai_dump_slot slots[AI_DUMP_SLOTS];
+
+  FILE *f;
+  enum ai_dump_format format;
+  bool wait;
+  unsigned header_rate;
+  unsigned rate;
+
+  cen64_thread thread;
+  cen64_mutex mutex;
+  cen64_cv filled_cv;
+  cen64_cv freed_cv;
+
+  // head is only touched by the AI, tail by the writer;
+  // count is shared and protected by the mutex.
+  unsigned head, tail, count;
+  bool exiting;
+  bool failed;
+
+  unsigned long long frames;
+  unsigned long long dropped;
+  unsigned rate_changes;
+};
+
+static CEN64_THREAD_RETURN_TYPE ai_dump_thread(void *opaque);
+
+static void ai_dump_put32(uint8_t *p, uint32_t word) {
+  p[0] = word >> 0;
+  p[1] = word >> 8;
+  p[2] = word >> 16;
+  p[3] = word >> 24;
+}
+
+// Writes a 16-bit stereo PCM header for data_size bytes of samples.
+static int ai_dump_write_header(struct ai_dump *dump, uint32_t data_size) {
+  uint8_t header[AI_DUMP_WAV_HEADER_SIZE];
+
+  memcpy(header + 0, "RIFF", 4);
+  ai_dump_put32(header + 4, data_size + AI_DUMP_WAV_HEADER_SIZE - 8);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  ai_dump_put32(header + 16, 16);
+  ai_dump_put32(header + 20, 1 | (2 << 16));  // PCM, 2 channels
+  ai_dump_put32(header + 24, dump->header_rate);
+  ai_dump_put32(header + 28, dump->header_rate * 4);
+  ai_dump_put32(header + 32, 4 | (16 << 16)); // 4-byte frames, 16 bits
+  memcpy(header + 36, "data", 4);
+  ai_dump_put32(header + 40, data_size);
+
+  return fwrite(header, sizeof(header), 1, dump->f) != 1;
+}
+
+// Writes out one queued DMA. Returns nonzero on error.
+static int ai_dump_write(struct ai_dump *dump,
+  const struct ai_dump_slot *slot) {
+  if (dump->rate == 0) {
+    dump->rate = dump->header_rate = slot->rate;
+
+    if (dump->format == AI_DUMP_FORMAT_WAV &&
+      ai_dump_write_header(dump, 0xFFFFFFFFU - AI_DUMP_WAV_HEADER_SIZE))
+      return 1;
+
+    printf("AI dump: %u Hz.\n", dump->rate);
+  }
+
+  else if (dump->rate != slot->rate) {
+    printf("AI dump: %u Hz from frame %llu on.\n", slot->rate, dump->frames);
+
+    dump->rate = slot->rate;
+    dump->rate_changes++;
+  }
+
+  dump->frames += slot->length / 4;
+  return fwrite(slot->samples, slot->length, 1, dump->f) != 1;
+}
+
+struct ai_dump *ai_dump_open(const char *path,
+  const char *format, bool wait) {
+  struct ai_dump *dump;
+  const char *ext;
+
+  if ((dump = calloc(1, sizeof(*dump))) == NULL)
+    return NULL;
+
+  dump->wait = wait;
+
+  if (format == NULL) {
+    ext = strrchr(path, '.');
+    format = ext && !strcmp(ext, ".wav") ? "wav" : "raw";
+  }
+
+  if (!strcmp(format, "wav"))
+    dump->format = AI_DUMP_FORMAT_WAV;
+
+  else if (!strcmp(format, "raw"))
+    dump->format = AI_DUMP_FORMAT_RAW;
+
+  else {
+    printf("Unknown audio dump format: %s\n", format);
+    free(dump);
+    return NULL;
+  }
+
+  if (path[0] && strspn(path, "0123456789") == strlen(path))
+    dump->f = fdopen(atoi(path), "wb");
+  else
+    dump->f = fopen(path, "wb");
+
+  if (dump->f == NULL) {
+    printf("Can't open %s\n", path);
+    free(dump);
+    return NULL;
+  }
+
+#ifdef SIGPIPE
+  // If the reader goes away, fail the write instead of exiting.
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  if (cen64_mutex_create(&dump->mutex))
+    goto err_mutex;
+
+  if (cen64_cv_create(&dump->filled_cv))
+    goto err_filled_cv;
+
+  if (cen64_cv_create(&dump->freed_cv))
+    goto err_freed_cv;
+
+  if (cen64_thread_create(&dump->thread, ai_dump_thread, dump))
+    goto err_thread;
+
+  cen64_thread_setname(&dump->thread, "ai_dump");
+  return dump;
+
+err_thread:
+  cen64_cv_destroy(&dump->freed_cv);
+err_freed_cv:
+  cen64_cv_destroy(&dump->filled_cv);
+err_filled_cv:
+  cen64_mutex_destroy(&dump->mutex);
+err_mutex:
+  fclose(dump->f);
+  free(dump);
+  return NULL;
+}
+
+// Writes out whatever is still queued up and closes the file.
+void ai_dump_close(struct ai_dump *dump) {
+  unsigned long long size;
+
+  if (dump == NULL)
+    return;
+
+  cen64_mutex_lock(&dump->mutex);
+  dump->exiting = true;
+  cen64_cv_signal(&dump->filled_cv);
+  cen64_mutex_unlock(&dump->mutex);
+
+  cen64_thread_join(&dump->thread);
+
+  if (dump->format == AI_DUMP_FORMAT_WAV && !dump->failed) {
+    size = dump->frames * 4;
+
+    if (size > 0xFFFFFFFFU - AI_DUMP_WAV_HEADER_SIZE)
+      size = 0xFFFFFFFFU - AI_DUMP_WAV_HEADER_SIZE;
+
+    // Nothing was played; leave behind a valid, empty file.
+    if (dump->rate == 0) {
+      dump->header_rate = AI_DUMP_DEFAULT_RATE;
+      dump->failed = ai_dump_write_header(dump, 0) != 0;
+    }
+
+    // Fill in the real sizes, if this isn't a pipe.
+    else if (fseek(dump->f, 0, SEEK_SET) == 0)
+      dump->failed = ai_dump_write_header(dump, size) != 0;
+  }
+
+  if (ferror(dump->f) | fclose(dump->f))
+    dump->failed = true;
+
+  printf("AI dump: %llu frames written, %llu dropped%s.\n",
+    dump->frames, dump->dropped, dump->failed ? " (write error)" : "");
+
+  if (dump->rate_changes)
+    printf("AI dump: %u sample rate change(s) after the first "
+      "DMA; the header only records the first rate.\n", dump->rate_changes);
+
+  cen64_cv_destroy(&dump->freed_cv);
+  cen64_cv_destroy(&dump->filled_cv);
+  cen64_mutex_destroy(&dump->mutex);
+  free(dump);
+}
+
+void ai_dump_samples(struct ai_dump *dump, const uint8_t *samples,
+  uint32_t length, unsigned rate) {
+  struct ai_dump_slot *slot;
+
+  cen64_mutex_lock(&dump->mutex);
+
+  while (dump->count == AI_DUMP_SLOTS && dump->wait && !dump->failed) {
+    cen64_cv_wait(&dump->freed_cv, &dump->mutex);
+    cen64_mutex_lock(&dump->mutex);
+  }
+
+  if (dump->count == AI_DUMP_SLOTS || dump->failed) {
+    cen64_mutex_unlock(&dump->mutex);
+    dump->dropped += length / 4;
+    return;
+  }
+
+  cen64_mutex_unlock(&dump->mutex);
+
+  // The slot at head isn't visible to the writer until count is
+  // bumped, so it can be filled in without holding the lock.
+  slot = dump->slots + dump->head;
+  memcpy(slot->samples, samples, length);
+  slot->length = length;
+  slot->rate = rate;
+
+  dump->head = (dump->head + 1) % AI_DUMP_SLOTS;
+
+  cen64_mutex_lock(&dump->mutex);
+
+  if (dump->count++ == 0)
+    cen64_cv_signal(&dump->filled_cv);
+
+  cen64_mutex_unlock(&dump->mutex);
+}
+
+// Drains the ring until ai_dump_close is called and it's empty.
+static CEN64_THREAD_RETURN_TYPE ai_dump_thread(void *opaque) {
+  struct ai_dump *dump = (struct ai_dump *) opaque;
+  bool failed = false;
+
+  cen64_mutex_lock(&dump->mutex);
+
+  while (1) {
+    while (dump->count == 0 && !dump->exiting) {
+      cen64_cv_wait(&dump->filled_cv, &dump->mutex);
+      cen64_mutex_lock(&dump->mutex);
+    }
+
+    if (dump->count == 0)
+      break;
+
+    cen64_mutex_unlock(&dump->mutex);
+
+    if (!failed && ai_dump_write(dump, dump->slots + dump->tail))
+      failed = true;
+
+    dump->tail = (dump->tail + 1) % AI_DUMP_SLOTS;
+
+    cen64_mutex_lock(&dump->mutex);
+    dump->failed = failed;
+
+    if (dump->count-- == AI_DUMP_SLOTS)
+      cen64_cv_signal(&dump->freed_cv);
+  }
+
+  cen64_mutex_unlock(&dump->mutex);
+  return CEN64_THREAD_RETURN_VAL;
+}
+
@@ -0,0 +1,40 @@
+//
+// ai/dump.h: AI output recording.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef CEN64_AI_DUMP_H
+#define CEN64_AI_DUMP_H
+#include "common.h"
+
+// DMAs that can be queued up before the AI has to drop (or wait), and
+// the most a single DMA can carry (AI_LEN_REG is 18 bits).
+#define AI_DUMP_SLOTS 8
+#define AI_DUMP_SLOT_SIZE 0x40000
+
+enum ai_dump_format {
+  AI_DUMP_FORMAT_RAW,  // Signed 16-bit little-endian stereo PCM
+  AI_DUMP_FORMAT_WAV,  // The same, behind a RIFF/WAVE header
+};
+
+struct ai_dump;
+
+// Opens path for writing (or, if it's a number, that file descriptor).
+// format is "raw" or "wav"; if NULL, it's picked from the extension.
+// If wait is set, the AI waits for the writer instead of dropping
+// DMAs when the queue is full.
+cen64_cold struct ai_dump *ai_dump_open(const char *path,
+  const char *format, bool wait);
+cen64_cold void ai_dump_close(struct ai_dump *dump);
+
+// Queues up a byteswapped DMA buffer that plays at rate Hz.
+void ai_dump_samples(struct ai_dump *dump, const uint8_t *samples,
+  uint32_t length, unsigned rate);
+
+#endif
+
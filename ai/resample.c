@@ -0,0 +1,175 @@
+//
+// ai/resample.c: Polyphase audio resampler.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Each output frame is a 16-tap FIR over the input frames around it;
+// the taps are a Blackman-windowed sinc, tabulated for 256 fractional
+// positions and linearly interpolated between those. The step between
+// output frames can change from one call to the next, which is what
+// lets the audio thread speed up or slow down playback slightly.
+//
+
+#include "common.h"
+#include "ai/resample.h"
+#include "ai/ring.h"
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// Builds the filter for the current input rate; the cutoff sits a
+// little below whichever of the two rates' Nyquist is lower.
+static void ai_resampler_build(struct ai_resampler *resampler,
+  unsigned in_rate) {
+  double cutoff = 0.46;
+  unsigned p, k;
+
+  if (resampler->out_rate < in_rate)
+    cutoff *= (double) resampler->out_rate / in_rate;
+
+  for (p = 0; p <= AI_RESAMPLE_PHASES; p++) {
+    double frac = (double) p / AI_RESAMPLE_PHASES;
+    double taps[AI_RESAMPLE_TAPS], sum = 0;
+
+    for (k = 0; k < AI_RESAMPLE_TAPS; k++) {
+      double x = k - (AI_RESAMPLE_TAPS / 2 - 1) - frac;
+      double t = (x + AI_RESAMPLE_TAPS / 2) / AI_RESAMPLE_TAPS;
+      double window = 0.42 - 0.5 * cos(2 * M_PI * t) +
+        0.08 * cos(4 * M_PI * t);
+
+      taps[k] = x == 0 ? 2 * cutoff :
+        sin(2 * M_PI * cutoff * x) / (M_PI * x);
+
+      taps[k] *= window;
+      sum += taps[k];
+    }
+
+    // Unity gain at DC, whatever the phase.
+    for (k = 0; k < AI_RESAMPLE_TAPS; k++)
+      resampler->coeffs[p][k] = taps[k] / sum;
+  }
+
+  resampler->in_rate = in_rate;
+}
+
+void ai_resampler_init(struct ai_resampler *resampler, unsigned out_rate) {
+  memset(resampler, 0, sizeof(*resampler));
+
+  resampler->out_rate = out_rate;
+  ai_resampler_build(resampler, out_rate);
+}
+
+// Filters the input around frame i, fractional position frac.
+static inline void ai_resample_frame(const struct ai_resampler *resampler,
+  unsigned i, double frac, int16_t *out) {
+  unsigned p = frac * AI_RESAMPLE_PHASES;
+  float f = frac * AI_RESAMPLE_PHASES - p;
+  const float *c0 = resampler->coeffs[p];
+  const float *c1 = resampler->coeffs[p + 1];
+  const float *left = resampler->left + i;
+  const float *right = resampler->right + i;
+  float l, r;
+  unsigned k;
+
+#ifdef __SSE2__
+  __m128 fv = _mm_set1_ps(f);
+  __m128 lacc = _mm_setzero_ps();
+  __m128 racc = _mm_setzero_ps();
+  __m128 sums;
+
+  for (k = 0; k < AI_RESAMPLE_TAPS; k += 4) {
+    __m128 a = _mm_loadu_ps(c0 + k);
+    __m128 b = _mm_loadu_ps(c1 + k);
+    __m128 c = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fv));
+
+    lacc = _mm_add_ps(lacc, _mm_mul_ps(_mm_loadu_ps(left + k), c));
+    racc = _mm_add_ps(racc, _mm_mul_ps(_mm_loadu_ps(right + k), c));
+  }
+
+  // (l0 + l2, r0 + r2, l1 + l3, r1 + r3), then fold the halves.
+  sums = _mm_add_ps(_mm_unpacklo_ps(lacc, racc), _mm_unpackhi_ps(lacc, racc));
+  sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+
+  l = _mm_cvtss_f32(sums);
+  r = _mm_cvtss_f32(_mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 1, 1, 1)));
+#else
+  l = r = 0;
+
+  for (k = 0; k < AI_RESAMPLE_TAPS; k++) {
+    float c = c0[k] + (c1[k] - c0[k]) * f;
+
+    l += left[k] * c;
+    r += right[k] * c;
+  }
+#endif
+
+  l = l > 32767.0f ? 32767.0f : l < -32768.0f ? -32768.0f : l;
+  r = r > 32767.0f ? 32767.0f : r < -32768.0f ? -32768.0f : r;
+
+  out[0] = (int16_t) (l + (l < 0 ? -0.5f : 0.5f));
+  out[1] = (int16_t) (r + (r < 0 ? -0.5f : 0.5f));
+}
+
+unsigned ai_resample(struct ai_resampler *resampler, struct ai_ring *ring,
+  int16_t *out, unsigned count, double step) {
+  unsigned in_rate = ring->rate;
+  unsigned need, got, i, n;
+
+  if (in_rate && in_rate != resampler->in_rate)
+    ai_resampler_build(resampler, in_rate);
+
+  // Top up the input with as much as this call could use.
+  need = (unsigned) (resampler->pos + count * step) + AI_RESAMPLE_TAPS + 1;
+
+  if (need > AI_RESAMPLE_FRAMES)
+    need = AI_RESAMPLE_FRAMES;
+
+  if (resampler->frames < need) {
+    got = ai_ring_pop(ring, resampler->popped, need - resampler->frames);
+
+    for (i = 0; i < got; i++) {
+      resampler->left[resampler->frames + i] = resampler->popped[i * 2 + 0];
+      resampler->right[resampler->frames + i] = resampler->popped[i * 2 + 1];
+    }
+
+    resampler->frames += got;
+  }
+
+  for (n = 0; n < count; n++) {
+    i = (unsigned) resampler->pos;
+
+    if (i + AI_RESAMPLE_TAPS > resampler->frames)
+      break;
+
+    ai_resample_frame(resampler, i, resampler->pos - i, out + n * 2);
+    resampler->pos += step;
+  }
+
+  memset(out + n * 2, 0, (count - n) * 4);
+
+  // Let go of the input frames that are behind us now.
+  i = (unsigned) resampler->pos;
+
+  if (i > resampler->frames)
+    i = resampler->frames;
+
+  memmove(resampler->left, resampler->left + i,
+    (resampler->frames - i) * sizeof(*resampler->left));
+  memmove(resampler->right, resampler->right + i,
+    (resampler->frames - i) * sizeof(*resampler->right));
+
+  resampler->frames -= i;
+  resampler->pos -= i;
+  return n;
+}
+
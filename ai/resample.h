@@ -0,0 +1,51 @@
+//
+// ai/resample.h: Polyphase audio resampler.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef CEN64_AI_RESAMPLE_H
+#define CEN64_AI_RESAMPLE_H
+#include "common.h"
+#include "ai/ring.h"
+
+#define AI_RESAMPLE_TAPS 16
+#define AI_RESAMPLE_PHASES 256
+
+// Input frames held on to between calls.
+#define AI_RESAMPLE_FRAMES 4096
+
+struct ai_resampler {
+  // Windowed sinc filter for each fractional position (the extra row
+  // lets the last phase be interpolated towards the next sample).
+  float coeffs[AI_RESAMPLE_PHASES + 1][AI_RESAMPLE_TAPS];
+
+  float left[AI_RESAMPLE_FRAMES];
+  float right[AI_RESAMPLE_FRAMES];
+  int16_t popped[AI_RESAMPLE_FRAMES * 2];
+
+  // Valid input frames, and where the next output frame falls
+  // between them (in input frames).
+  unsigned frames;
+  double pos;
+
+  unsigned in_rate;
+  unsigned out_rate;
+};
+
+cen64_cold void ai_resampler_init(struct ai_resampler *resampler,
+  unsigned out_rate);
+
+// Produces count stereo frames at the output rate, taking input from
+// the ring; step is how many input frames to advance per output frame.
+// Whatever can't be produced for lack of input is filled with silence.
+// Returns the number of frames that were actually resampled.
+unsigned ai_resample(struct ai_resampler *resampler, struct ai_ring *ring,
+  int16_t *out, unsigned count, double step);
+
+#endif
+
@@ -0,0 +1,107 @@
+//
+// ai/ring.h: Single-producer, single-consumer audio sample ring.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// The AI pushes the samples of each DMA; the audio thread pops them.
+// Each side only ever writes its own index, so neither takes a lock.
+// When the ring is full, the AI drops what doesn't fit rather than
+// waiting for the audio device.
+//
+
+#ifndef CEN64_AI_RING_H
+#define CEN64_AI_RING_H
+#include "common.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// In stereo frames; must be a power of two.
+#define AI_RING_FRAMES 16384
+
+struct ai_ring {
+  int16_t samples[AI_RING_FRAMES * 2];
+
+  // Frames pushed and popped so far (they wrap around together).
+  volatile uint32_t head;
+  volatile uint32_t tail;
+
+  // Sample rate of the frames being pushed (set by the AI).
+  volatile unsigned rate;
+
+  // Written by the AI thread.
+  unsigned long long dropped;
+};
+
+// Orders the sample copies against the index updates (x86 doesn't
+// reorder stores with stores or loads with loads, so MSVC only needs
+// to be kept from doing so itself).
+static inline void ai_ring_barrier(void) {
+#ifdef _MSC_VER
+  _ReadWriteBarrier();
+#else
+  __sync_synchronize();
+#endif
+}
+
+static inline uint32_t ai_ring_count(const struct ai_ring *ring) {
+  return ring->head - ring->tail;
+}
+
+// AI: pushes count frames of interleaved L/R samples.
+static inline void ai_ring_push(struct ai_ring *ring,
+  const int16_t *samples, uint32_t count) {
+  uint32_t head = ring->head;
+  uint32_t space = AI_RING_FRAMES - (head - ring->tail);
+  uint32_t offset, first;
+
+  if (count > space) {
+    ring->dropped += count - space;
+    count = space;
+  }
+
+  offset = head & (AI_RING_FRAMES - 1);
+  first = AI_RING_FRAMES - offset;
+
+  if (first > count)
+    first = count;
+
+  memcpy(ring->samples + offset * 2, samples, first * 4);
+  memcpy(ring->samples, samples + first * 2, (count - first) * 4);
+
+  ai_ring_barrier();
+  ring->head = head + count;
+}
+
+// Audio thread: pops up to count frames; returns how many it got.
+static inline uint32_t ai_ring_pop(struct ai_ring *ring,
+  int16_t *samples, uint32_t count) {
+  uint32_t tail = ring->tail;
+  uint32_t available = ring->head - tail;
+  uint32_t offset, first;
+
+  if (count > available)
+    count = available;
+
+  ai_ring_barrier();
+  offset = tail & (AI_RING_FRAMES - 1);
+  first = AI_RING_FRAMES - offset;
+
+  if (first > count)
+    first = count;
+
+  memcpy(samples, ring->samples + offset * 2, first * 4);
+  memcpy(samples + first * 2, ring->samples, (count - first) * 4);
+
+  ai_ring_barrier();
+  ring->tail = tail + count;
+  return count;
+}
+
+#endif
+
@@ -8,27 +8,407 @@
 //
 
 #include "common.h"
-#include "arch/arm/rsp/rsp.h"
-
-cen64_align(const uint8_t shuffle_keys[16][16], CACHE_LINE_SIZE) = {
-  /* -- */ {0x0,0x8,0x1,0x9,0x2,0xA,0x3,0xB,0x4,0xC,0x5,0xD,0x6,0xE,0x7,0xF},
-  /* -- */ {0x0,0x8,0x1,0x9,0x2,0xA,0x3,0xB,0x4,0xC,0x5,0xD,0x6,0xE,0x7,0xF},
-
-  /* 0q */ {0x0,0x8,0x0,0x8,0x2,0xA,0x2,0xA,0x4,0xC,0x4,0xC,0x6,0xE,0x6,0xE},
-  /* 1q */ {0x1,0x9,0x1,0x9,0x3,0xB,0x3,0xB,0x5,0xD,0x5,0xD,0x7,0xF,0x7,0xF},
-
-  /* 0h */ {0x0,0x8,0x0,0x8,0x0,0x8,0x0,0x8,0x4,0xC,0x4,0xC,0x4,0xC,0x4,0xC},
-  /* 1h */ {0x1,0x9,0x1,0x9,0x1,0x9,0x1,0x9,0x5,0xD,0x5,0xD,0x5,0xD,0x5,0xD},
-  /* 2h */ {0x2,0xA,0x2,0xA,0x2,0xA,0x2,0xA,0x6,0xE,0x6,0xE,0x6,0xE,0x6,0xE},
-  /* 3h */ {0x3,0xB,0x3,0xB,0x3,0xB,0x3,0xB,0x7,0xF,0x7,0xF,0x7,0xF,0x7,0xF},
-
-  /* 0w */ {0x0,0x8,0x0,0x8,0x0,0x8,0x0,0x8,0x0,0x8,0x0,0x8,0x0,0x8,0x0,0x8},
-  /* 1w */ {0x1,0x9,0x1,0x9,0x1,0x9,0x1,0x9,0x1,0x9,0x1,0x9,0x1,0x9,0x1,0x9},
-  /* 2w */ {0x2,0xA,0x2,0xA,0x2,0xA,0x2,0xA,0x2,0xA,0x2,0xA,0x2,0xA,0x2,0xA},
-  /* 3w */ {0x3,0xB,0x3,0xB,0x3,0xB,0x3,0xB,0x3,0xB,0x3,0xB,0x3,0xB,0x3,0xB},
-  /* 4w */ {0x4,0xC,0x4,0xC,0x4,0xC,0x4,0xC,0x4,0xC,0x4,0xC,0x4,0xC,0x4,0xC},
-  /* 5w */ {0x5,0xD,0x5,0xD,0x5,0xD,0x5,0xD,0x5,0xD,0x5,0xD,0x5,0xD,0x5,0xD},
-  /* 6w */ {0x6,0xE,0x6,0xE,0x6,0xE,0x6,0xE,0x6,0xE,0x6,0xE,0x6,0xE,0x6,0xE},
-  /* 7w */ {0x7,0xF,0x7,0xF,0x7,0xF,0x7,0xF,0x7,0xF,0x7,0xF,0x7,0xF,0x7,0xF},
+#include "rsp/cpu.h"
+#include "rsp/pipeline.h"
+#include "rsp/rsp.h"
+
+//
+// Masks for AND/OR/XOR and NAND/NOR/NXOR.
+//
+cen64_align(const uint16_t rsp_vlogic_mask[2][8], 32) = {
+  { 0,  0,  0,  0,  0,  0,  0,  0},
+  {~0, ~0, ~0, ~0, ~0, ~0, ~0, ~0}
+};
+
+//
+// This table is used to "shuffle" the RSP vector after loading it.
+//
+cen64_align(const uint16_t shuffle_keys[16][8], CACHE_LINE_SIZE)  = {
+  /* -- */ {0x0100, 0x0302, 0x0504, 0x0706, 0x0908, 0x0B0A, 0x0D0C, 0x0F0E},
+  /* -- */ {0x0100, 0x0302, 0x0504, 0x0706, 0x0908, 0x0B0A, 0x0D0C, 0x0F0E},
+
+  /* 0q */ {0x0100, 0x0100, 0x0504, 0x0504, 0x0908, 0x0908, 0x0D0C, 0x0D0C},
+  /* 1q */ {0x0302, 0x0302, 0x0706, 0x0706, 0x0B0A, 0x0B0A, 0x0F0E, 0x0F0E},
+
+  /* 0h */ {0x0100, 0x0100, 0x0100, 0x0100, 0x0908, 0x0908, 0x0908, 0x0908},
+  /* 1h */ {0x0302, 0x0302, 0x0302, 0x0302, 0x0B0A, 0x0B0A, 0x0B0A, 0x0B0A},
+  /* 2h */ {0x0504, 0x0504, 0x0504, 0x0504, 0x0D0C, 0x0D0C, 0x0D0C, 0x0D0C},
+  /* 3h */ {0x0706, 0x0706, 0x0706, 0x0706, 0x0F0E, 0x0F0E, 0x0F0E, 0x0F0E},
+
+  /* 0w */ {0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100, 0x0100},
+  /* 1w */ {0x0302, 0x0302, 0x0302, 0x0302, 0x0302, 0x0302, 0x0302, 0x0302},
+  /* 2w */ {0x0504, 0x0504, 0x0504, 0x0504, 0x0504, 0x0504, 0x0504, 0x0504},
+  /* 3w */ {0x0706, 0x0706, 0x0706, 0x0706, 0x0706, 0x0706, 0x0706, 0x0706},
+  /* 4w */ {0x0908, 0x0908, 0x0908, 0x0908, 0x0908, 0x0908, 0x0908, 0x0908},
+  /* 5w */ {0x0B0A, 0x0B0A, 0x0B0A, 0x0B0A, 0x0B0A, 0x0B0A, 0x0B0A, 0x0B0A},
+  /* 6w */ {0x0D0C, 0x0D0C, 0x0D0C, 0x0D0C, 0x0D0C, 0x0D0C, 0x0D0C, 0x0D0C},
+  /* 7w */ {0x0F0E, 0x0F0E, 0x0F0E, 0x0F0E, 0x0F0E, 0x0F0E, 0x0F0E, 0x0F0E},
+};
+
+//
+// These tables are used to shift data loaded from DMEM.
+// In addition to shifting, they also take into account that
+// DMEM uses big-endian byte ordering, whereas vectors are
+// 2-byte little-endian.
+//
+
+// Shift left LUT; shifts in zeros from the right, one byte at a time.
+cen64_align(static const uint16_t sll_b2l_keys[16][8], CACHE_LINE_SIZE) = {
+  {0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F},
+  {0x8000, 0x0102, 0x0304, 0x0506, 0x0708, 0x090A, 0x0B0C, 0x0D0E},
+  {0x8080, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D},
+  {0x8080, 0x8000, 0x0102, 0x0304, 0x0506, 0x0708, 0x090A, 0x0B0C},
+
+  {0x8080, 0x8080, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B},
+  {0x8080, 0x8080, 0x8000, 0x0102, 0x0304, 0x0506, 0x0708, 0x090A},
+  {0x8080, 0x8080, 0x8080, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809},
+  {0x8080, 0x8080, 0x8080, 0x8000, 0x0102, 0x0304, 0x0506, 0x0708},
+
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x0001, 0x0203, 0x0405, 0x0607},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8000, 0x0102, 0x0304, 0x0506},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0001, 0x0203, 0x0405},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8000, 0x0102, 0x0304},
+
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0001, 0x0203},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8000, 0x0102},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0001},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8000},
+};
+
+// Shift left LUT; shirts low order to high order, inserting 0x00s.
+cen64_align(static const uint16_t sll_l2b_keys[16][8], CACHE_LINE_SIZE) = {
+  {0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F},
+  {0x0180, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0E0C},
+  {0x8080, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D},
+  {0x8080, 0x0180, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A},
+
+  {0x8080, 0x8080, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B},
+  {0x8080, 0x8080, 0x0180, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08},
+  {0x8080, 0x8080, 0x8080, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809},
+  {0x8080, 0x8080, 0x8080, 0x0180, 0x0300, 0x0502, 0x0704, 0x0906},
+
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x0001, 0x0203, 0x0405, 0x0607},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x0180, 0x0300, 0x0502, 0x0704},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0001, 0x0203, 0x0405},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0180, 0x0300, 0x0502},
+
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0001, 0x0203},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0180, 0x0300},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0001},
+  {0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x8080, 0x0180},
+};
+
+cen64_align(static const uint16_t ror_b2l_keys[16][8], CACHE_LINE_SIZE) = {
+  {0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F},
+  {0x0102, 0x0304, 0x0506, 0x0708, 0x090A, 0x0B0C, 0x0D0E, 0x0F00},
+  {0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001},
+  {0x0304, 0x0506, 0x0708, 0x090A, 0x0B0C, 0x0D0E, 0x0F00, 0x0102},
+
+  {0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203},
+  {0x0506, 0x0708, 0x090A, 0x0B0C, 0x0D0E, 0x0F00, 0x0102, 0x0304},
+  {0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405},
+  {0x0708, 0x090A, 0x0B0C, 0x0D0E, 0x0F00, 0x0102, 0x0304, 0x0506},
+
+  {0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607},
+  {0x090A, 0x0B0C, 0x0D0E, 0x0F00, 0x0102, 0x0304, 0x0506, 0x0708},
+  {0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809},
+  {0x0B0C, 0x0D0E, 0x0F00, 0x0102, 0x0304, 0x0506, 0x0708, 0x090A},
+
+  {0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B},
+  {0x0D0E, 0x0F00, 0x0102, 0x0304, 0x0506, 0x0708, 0x090A, 0x0B0C},
+  {0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D},
+  {0x0F00, 0x0102, 0x0304, 0x0506, 0x0708, 0x090A, 0x0B0C, 0x0D0E},
+};
+
+// Rotate left LUT; rotates high order bytes back to low order.
+cen64_align(static const uint16_t rol_l2b_keys[16][8], CACHE_LINE_SIZE) = {
+  {0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F},
+  {0x010E, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0F0C},
+  {0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D},
+  {0x0F0C, 0x010E, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A},
+
+  {0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B},
+  {0x0D0A, 0x0F0C, 0x010E, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08},
+  {0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809},
+  {0x0B08, 0x0D0A, 0x0F0C, 0x010E, 0x0300, 0x0502, 0x0704, 0x0906},
+
+  {0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607},
+  {0x0906, 0x0B08, 0x0D0A, 0x0F0C, 0x010E, 0x0300, 0x0502, 0x0704},
+  {0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405},
+  {0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0F0C, 0x010E, 0x0300, 0x0502},
+
+  {0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203},
+  {0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0F0C, 0x010E, 0x0300},
+  {0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001},
+  {0x0300, 0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0F0C, 0x010E},
 };
 
+// Rotate right LUT; rotates high order bytes back to low order.
+cen64_align(static const uint16_t ror_l2b_keys[16][8], CACHE_LINE_SIZE) = {
+  {0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F},
+  {0x0300, 0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0F0C, 0x010E},
+  {0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001},
+  {0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0F0C, 0x010E, 0x0300},
+
+  {0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203},
+  {0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0F0C, 0x010E, 0x0300, 0x0502},
+  {0x0607, 0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405},
+  {0x0906, 0x0B08, 0x0D0A, 0x0F0C, 0x010E, 0x0300, 0x0502, 0x0704},
+
+  {0x0809, 0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607},
+  {0x0B08, 0x0D0A, 0x0F0C, 0x010E, 0x0300, 0x0502, 0x0704, 0x0906},
+  {0x0A0B, 0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809},
+  {0x0D0A, 0x0F0C, 0x010E, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08},
+
+  {0x0C0D, 0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B},
+  {0x0F0C, 0x010E, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A},
+  {0x0E0F, 0x0001, 0x0203, 0x0405, 0x0607, 0x0809, 0x0A0B, 0x0C0D},
+  {0x010E, 0x0300, 0x0502, 0x0704, 0x0906, 0x0B08, 0x0D0A, 0x0F0C},
+};
+
+// Loads 16 bytes of DMEM as two 8-byte halves, which is
+// how the hardware wraps accesses around the end of DMEM.
+static inline uint8x16_t rsp_vect_load_wrapped(const struct rsp *rsp,
+  uint32_t addr) {
+  uint32_t aligned_addr_lo = addr & ~0x7;
+  uint32_t aligned_addr_hi = (aligned_addr_lo + 8) & 0xFFF;
+
+  return vcombine_u8(
+    vld1_u8(rsp->mem + aligned_addr_lo),
+    vld1_u8(rsp->mem + aligned_addr_hi));
+}
+
+// Deallocates dynarec buffers for NEON.
+void arch_rsp_destroy(struct rsp *rsp) {}
+
+// Uses a LUT to populate flag registers.
+void rsp_set_flags(uint16_t *flags, uint16_t rt) {
+  unsigned i;
+
+  static const uint16_t array[16][4] = {
+    {0x0000, 0x0000, 0x0000, 0x0000},
+    {0xFFFF, 0x0000, 0x0000, 0x0000},
+    {0x0000, 0xFFFF, 0x0000, 0x0000},
+    {0xFFFF, 0xFFFF, 0x0000, 0x0000},
+    {0x0000, 0x0000, 0xFFFF, 0x0000},
+    {0xFFFF, 0x0000, 0xFFFF, 0x0000},
+    {0x0000, 0xFFFF, 0xFFFF, 0x0000},
+    {0xFFFF, 0xFFFF, 0xFFFF, 0x0000},
+    {0x0000, 0x0000, 0x0000, 0xFFFF},
+    {0xFFFF, 0x0000, 0x0000, 0xFFFF},
+    {0x0000, 0xFFFF, 0x0000, 0xFFFF},
+    {0xFFFF, 0xFFFF, 0x0000, 0xFFFF},
+    {0x0000, 0x0000, 0xFFFF, 0xFFFF},
+    {0xFFFF, 0x0000, 0xFFFF, 0xFFFF},
+    {0x0000, 0xFFFF, 0xFFFF, 0xFFFF},
+    {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF},
+  };
+
+  for (i = 0; i < 2; i++, rt >>= 4)
+    memcpy(flags + 8 + i * 4, array[rt & 0xF], sizeof(array[0]));
+
+  for (i = 0; i < 2; i++, rt >>= 4)
+    memcpy(flags + 0 + i * 4, array[rt & 0xF], sizeof(array[0]));
+}
+
+// Allocates dynarec buffers for NEON.
+int arch_rsp_init(struct rsp *rsp) { return 0; }
+
+//
+// NEON loads for group I. Byteswap big-endian to 2-byte
+// little-endian vector. Start at vector element offset, discarding any
+// wraparound as necessary.
+//
+// TODO: Reverse-engineer what happens when loads to vector elements must
+//       wraparound. Do we just discard the data, as below, or does the
+//       data effectively get rotated around the edge of the vector?
+//
+void rsp_vload_group1(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm) {
+  uint8x16_t data, mask;
+
+  unsigned offset = addr & 0x7;
+  unsigned ror = offset - element;
+
+  // Always load in 8-byte chunks to emulate wraparound.
+  if (offset)
+    data = rsp_vect_load_wrapped(rsp, addr);
+
+  else
+    data = vcombine_u8(vld1_u8(rsp->mem + addr), vdup_n_u8(0));
+
+  // Shift the DQM up to the point where we mux in the data.
+  mask = rsp_vect_shuffle_bytes(vreinterpretq_u8_u16(dqm),
+    sll_b2l_keys[element]);
+
+  // Align the data to the DQM so we can mask it in.
+  data = rsp_vect_shuffle_bytes(data, ror_b2l_keys[ror & 0xF]);
+
+  // Mask and mux in the data.
+  reg = vbslq_u16(vreinterpretq_u16_u8(mask), vreinterpretq_u16_u8(data), reg);
+  vst1q_u16(regp, reg);
+}
+
+//
+// NEON loads for group II.
+//
+// TODO: Reverse-engineer what happens when loads to vector elements must
+//       wraparound. Do we just discard the data, as below, or does the
+//       data effectively get rotated around the edge of the vector?
+//
+// TODO: Reverse-engineer what happens when element != 0.
+//
+void rsp_vload_group2(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm) {
+  unsigned offset = addr & 0x7;
+  uint16x8_t data;
+  uint8x8_t bytes;
+
+  // Always load in 8-byte chunks to emulate wraparound.
+  if (offset) {
+    uint8_t temp[16];
+
+    vst1q_u8(temp, rsp_vect_load_wrapped(rsp, addr));
+    bytes = vld1_u8(temp + offset);
+  }
+
+  else
+    bytes = vld1_u8(rsp->mem + addr);
+
+  // "Unpack" the data.
+  data = vshll_n_u8(bytes, 8);
+
+  if (rsp->pipeline.exdf_latch.request.type != RSP_MEM_REQUEST_PACK)
+    data = vshrq_n_u16(data, 1);
+
+  vst1q_u16(regp, data);
+}
+
+//
+// NEON loads for group IV. Byteswap big-endian to 2-byte
+// little-endian vector. Stop loading at quadword boundaries.
+//
+// TODO: Reverse-engineer what happens when loads from vector elements
+//       must wraparound (i.e., the address offset is small, starting
+//       element is large).
+//
+void rsp_vload_group4(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm) {
+  uint32_t aligned_addr = addr & 0xFF0;
+  unsigned offset = addr & 0xF;
+  unsigned ror;
+
+  uint8x16_t data = vld1q_u8(rsp->mem + aligned_addr);
+  uint8x16_t mask = vreinterpretq_u8_u16(dqm);
+
+  // TODO: Use of element is almost certainly wrong...
+  ror = 16 - element + offset;
+
+  if (rsp->pipeline.exdf_latch.request.type != RSP_MEM_REQUEST_QUAD)
+    mask = vceqq_u8(mask, vdupq_n_u8(0));
+
+  data = rsp_vect_shuffle_bytes(data, ror_b2l_keys[ror & 0xF]);
+  mask = rsp_vect_shuffle_bytes(mask, ror_b2l_keys[ror & 0xF]);
+
+  // Mask and mux in the data.
+  reg = vbslq_u16(vreinterpretq_u16_u8(mask), vreinterpretq_u16_u8(data), reg);
+  vst1q_u16(regp, reg);
+}
+
+//
+// NEON stores for group I. Byteswap 2-byte little-endian
+// vector back to big-endian. Start at vector element offset, wrapping
+// around the edge of the vector as necessary.
+//
+// TODO: Reverse-engineer what happens when stores from vector elements
+//       must wraparound. Do we just stop storing the data, or do we
+//       continue storing from the front of the vector, as below?
+//
+void rsp_vstore_group1(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm) {
+  unsigned offset = addr & 0x7;
+  unsigned ror = element - offset;
+  uint8x16_t data, mask, value;
+
+  // Shift the DQM up to the point where we mux in the data.
+  mask = rsp_vect_shuffle_bytes(vreinterpretq_u8_u16(dqm),
+    sll_l2b_keys[offset]);
+
+  // Rotate the reg to align with the DQM.
+  value = rsp_vect_shuffle_bytes(vreinterpretq_u8_u16(reg),
+    ror_l2b_keys[ror & 0xF]);
+
+  // Always load in 8-byte chunks to emulate wraparound.
+  if (offset) {
+    uint32_t aligned_addr_lo = addr & ~0x7;
+    uint32_t aligned_addr_hi = (aligned_addr_lo + 8) & 0xFFF;
+
+    data = rsp_vect_load_wrapped(rsp, addr);
+    data = vbslq_u8(mask, value, data);
+
+    vst1_u8(rsp->mem + aligned_addr_lo, vget_low_u8(data));
+    vst1_u8(rsp->mem + aligned_addr_hi, vget_high_u8(data));
+  }
+
+  else {
+    uint8x8_t bytes = vld1_u8(rsp->mem + addr);
+
+    bytes = vbsl_u8(vget_low_u8(mask), vget_low_u8(value), bytes);
+    vst1_u8(rsp->mem + addr, bytes);
+  }
+}
+
+//
+// NEON stores for group II. Byteswap 2-byte little-endian
+// vector back to big-endian. Start at vector element offset, wrapping
+// around the edge of the vector as necessary.
+//
+// TODO: Reverse-engineer what happens when stores from vector elements
+//       must wraparound. Do we just stop storing the data, or do we
+//       continue storing from the front of the vector, as below?
+//
+// TODO: Reverse-engineer what happens when element != 0.
+//
+void rsp_vstore_group2(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm) {
+  int16x8_t value = vreinterpretq_s16_u16(reg);
+
+  // "Pack" the data.
+  if (rsp->pipeline.exdf_latch.request.type != RSP_MEM_REQUEST_PACK)
+    value = vshlq_n_s16(value, 1);
+
+  value = vshrq_n_s16(value, 8);
+
+  // TODO: Always store in 8-byte chunks to emulate wraparound.
+  vst1_s8((int8_t *) (rsp->mem + addr), vqmovn_s16(value));
+}
+
+//
+// NEON stores for group IV. Byteswap 2-byte little-endian
+// vector back to big-endian. Stop storing at quadword boundaries.
+//
+void rsp_vstore_group4(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm) {
+  uint32_t aligned_addr = addr & 0xFF0;
+  unsigned offset = addr & 0xF;
+  unsigned rol = offset;
+
+  uint8x16_t data = vld1q_u8(rsp->mem + aligned_addr);
+  uint8x16_t mask = vreinterpretq_u8_u16(dqm);
+  uint8x16_t value;
+
+  if (rsp->pipeline.exdf_latch.request.type == RSP_MEM_REQUEST_QUAD)
+    rol -= element;
+
+  // TODO: How is this adjusted for SRV when e != 0?
+  else
+    mask = vceqq_u8(mask, vdupq_n_u8(0));
+
+  value = rsp_vect_shuffle_bytes(vreinterpretq_u8_u16(reg),
+    rol_l2b_keys[rol & 0xF]);
+
+  // Mask and mux out the data, write.
+  data = vbslq_u8(mask, value, data);
+  vst1q_u8(rsp->mem + aligned_addr, data);
+}
+
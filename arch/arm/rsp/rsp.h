@@ -12,39 +12,200 @@
 #include "common.h"
 #include <arm_neon.h>
 
+struct rsp;
 typedef uint16x8_t rsp_vect_t;
 
+// Gives the architecture backend a chance to initialize the RSP.
+cen64_cold void arch_rsp_destroy(struct rsp *rsp);
+cen64_cold int arch_rsp_init(struct rsp *rsp);
+
+// Masks for AND/OR/XOR and NAND/NOR/NXOR.
+extern const uint16_t rsp_vlogic_mask[2][8];
+
+// Byte shuffle with pshufb semantics: an index with the
+// high bit set yields zero (as does any index above 15).
+static inline uint8x16_t rsp_vect_shuffle_bytes(uint8x16_t v,
+  const uint16_t *keys) {
+  uint8x16_t key = vreinterpretq_u8_u16(vld1q_u16(keys));
+
+#ifdef __aarch64__
+  return vqtbl1q_u8(v, key);
+#else
+  uint8x8x2_t table = {{vget_low_u8(v), vget_high_u8(v)}};
+
+  return vcombine_u8(
+    vtbl2_u8(table, vget_low_u8(key)),
+    vtbl2_u8(table, vget_high_u8(key)));
+#endif
+}
+
 // Loads and shuffles a 16x8 vector according to element.
-extern const uint8_t shuffle_keys[16][16];
+extern const uint16_t shuffle_keys[16][8];
 
 static inline uint16x8_t rsp_vect_load_and_shuffle_operand(
-  const uint8_t *src, unsigned element) {
-  const uint8x16_t keys = vld1q_u8(shuffle_keys[element]);
-  const uint8x8x2_t packed_operand = vld2_u8(src);
+  const uint16_t *src, unsigned element) {
+  uint8x16_t operand = vreinterpretq_u8_u16(vld1q_u16(src));
 
-  uint8x8_t operand_lo_8x8 = vtbl2_u8(packed_operand, vget_low_u8(keys));
-  uint8x8_t operand_hi_8x8 = vtbl2_u8(packed_operand, vget_high_u8(keys));
-  uint8x16_t operand = vcombine_u8(operand_lo_8x8, operand_hi_8x8);
-
-  return vreinterpretq_u16_u8(operand);
+  return vreinterpretq_u16_u8(rsp_vect_shuffle_bytes(
+    operand, shuffle_keys[element]));
 }
 
 // Loads a vector without shuffling its elements.
-static inline uint16x8_t rsp_vect_load_unshuffled_operand(const uint8_t *src) {
-  return vreinterpretq_u16_u8(vld1q_u8(src));
+static inline uint16x8_t rsp_vect_load_unshuffled_operand(const uint16_t *src) {
+  return vld1q_u16(src);
 }
 
 // Writes an operand back to memory.
-static inline void rsp_vect_write_operand(uint8_t *dest, uint16x8_t src) {
-  vst1q_u8(dest, vreinterpretq_u8_u16(src));
+static inline void rsp_vect_write_operand(uint16_t *dest, uint16x8_t src) {
+  vst1q_u16(dest, src);
+}
+
+// Multiplies, returning the upper 16 bits of each product.
+static inline uint16x8_t rsp_vmulhi_s16(uint16x8_t vs, uint16x8_t vt) {
+  int16x8_t s = vreinterpretq_s16_u16(vs);
+  int16x8_t t = vreinterpretq_s16_u16(vt);
+
+  int32x4_t lo = vmull_s16(vget_low_s16(s), vget_low_s16(t));
+  int32x4_t hi = vmull_s16(vget_high_s16(s), vget_high_s16(t));
+
+  return vreinterpretq_u16_s16(vcombine_s16(
+    vshrn_n_s32(lo, 16), vshrn_n_s32(hi, 16)));
+}
+
+static inline uint16x8_t rsp_vmulhi_u16(uint16x8_t vs, uint16x8_t vt) {
+  uint32x4_t lo = vmull_u16(vget_low_u16(vs), vget_low_u16(vt));
+  uint32x4_t hi = vmull_u16(vget_high_u16(vs), vget_high_u16(vt));
+
+  return vcombine_u16(vshrn_n_u32(lo, 16), vshrn_n_u32(hi, 16));
+}
+
+// Arithmetic shift right; yields a mask from the sign bit.
+static inline uint16x8_t rsp_vsign_mask(uint16x8_t v) {
+  return vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(v), 15));
+}
+
+// Functions for reading/writing the accumulator.
+static inline uint16x8_t read_acc_lo(const uint16_t *acc) {
+  return rsp_vect_load_unshuffled_operand(acc + 16);
+}
+static inline uint16x8_t read_acc_md(const uint16_t *acc) {
+  return rsp_vect_load_unshuffled_operand(acc + 8);
+}
+static inline uint16x8_t read_acc_hi(const uint16_t *acc) {
+  return rsp_vect_load_unshuffled_operand(acc);
+}
+static inline uint16x8_t read_vcc_lo(const uint16_t *vcc) {
+  return rsp_vect_load_unshuffled_operand(vcc + 8);
+}
+static inline uint16x8_t read_vcc_hi(const uint16_t *vcc) {
+  return rsp_vect_load_unshuffled_operand(vcc);
+}
+static inline uint16x8_t read_vco_lo(const uint16_t *vco) {
+  return rsp_vect_load_unshuffled_operand(vco + 8);
+}
+static inline uint16x8_t read_vco_hi(const uint16_t *vco) {
+  return rsp_vect_load_unshuffled_operand(vco);
+}
+static inline uint16x8_t read_vce(const uint16_t *vce) {
+  return rsp_vect_load_unshuffled_operand(vce + 8);
+}
+static inline void write_acc_lo(uint16_t *acc, uint16x8_t acc_lo) {
+  rsp_vect_write_operand(acc + 16, acc_lo);
+}
+static inline void write_acc_md(uint16_t *acc, uint16x8_t acc_md) {
+  rsp_vect_write_operand(acc + 8, acc_md);
+}
+static inline void write_acc_hi(uint16_t *acc, uint16x8_t acc_hi) {
+  rsp_vect_write_operand(acc, acc_hi);
+}
+static inline void write_vcc_lo(uint16_t *vcc, uint16x8_t vcc_lo) {
+  rsp_vect_write_operand(vcc + 8, vcc_lo);
+}
+static inline void write_vcc_hi(uint16_t *vcc, uint16x8_t vcc_hi) {
+  rsp_vect_write_operand(vcc, vcc_hi);
+}
+static inline void write_vco_lo(uint16_t *vco, uint16x8_t vco_lo) {
+  rsp_vect_write_operand(vco + 8, vco_lo);
+}
+static inline void write_vco_hi(uint16_t *vco, uint16x8_t vco_hi) {
+  rsp_vect_write_operand(vco, vco_hi);
+}
+static inline void write_vce(uint16_t *vce, uint16x8_t vce_r) {
+  rsp_vect_write_operand(vce + 8, vce_r);
+}
+
+// Returns scalar bitmasks for VCO/VCC/VCE.
+static inline int16_t rsp_get_flags(const uint16_t *flags) {
+  static const uint16_t bits[2][8] = {
+    {0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080},
+    {0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, 0x8000},
+  };
+
+  uint16x8_t lo = vandq_u16(rsp_vsign_mask(vld1q_u16(flags + 8)),
+    vld1q_u16(bits[0]));
+  uint16x8_t hi = vandq_u16(rsp_vsign_mask(vld1q_u16(flags + 0)),
+    vld1q_u16(bits[1]));
+
+  uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vorrq_u16(lo, hi)));
+  return (int16_t) (vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
 }
 
+void rsp_set_flags(uint16_t *flags, uint16_t rt);
+
+// Zeroes out a vector register.
+static inline uint16x8_t rsp_vzero(void) {
+  return vdupq_n_u16(0);
+}
+
+// Load and store functions.
+void rsp_vload_group1(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm);
+
+void rsp_vload_group2(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm);
+
+void rsp_vload_group4(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm);
+
+void rsp_vstore_group1(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm);
+
+void rsp_vstore_group2(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm);
+
+void rsp_vstore_group4(struct rsp *rsp, uint32_t addr, unsigned element,
+  uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm);
+
+#include "arch/arm/rsp/clamp.h"
+#include "arch/arm/rsp/transpose.h"
+#include "arch/arm/rsp/vabs.h"
+#include "arch/arm/rsp/vadd.h"
+#include "arch/arm/rsp/vaddc.h"
 #include "arch/arm/rsp/vand.h"
-#include "arch/arm/rsp/vnand.h"
-#include "arch/arm/rsp/vnor.h"
+#include "arch/arm/rsp/vch.h"
+#include "arch/arm/rsp/vcmp.h"
+#include "arch/arm/rsp/vcl.h"
+#include "arch/arm/rsp/vcr.h"
+#include "arch/arm/rsp/vmac.h"
+#include "arch/arm/rsp/vmrg.h"
+#include "arch/arm/rsp/vmul.h"
+#include "arch/arm/rsp/vmulh.h"
+#include "arch/arm/rsp/vmull.h"
+#include "arch/arm/rsp/vmulm.h"
+#include "arch/arm/rsp/vmuln.h"
 #include "arch/arm/rsp/vor.h"
-#include "arch/arm/rsp/vnxor.h"
+#include "arch/arm/rsp/vsub.h"
+#include "arch/arm/rsp/vsubc.h"
 #include "arch/arm/rsp/vxor.h"
 
+uint16x8_t rsp_vdivh(struct rsp *rsp,
+  unsigned src, unsigned e, unsigned dest, unsigned de);
+
+uint16x8_t rsp_vmov(struct rsp *rsp,
+  unsigned src, unsigned e, unsigned dest, rsp_vect_t vt_shuffle);
+
+uint16x8_t rsp_vrcp_vrsq(struct rsp *rsp, uint32_t iw, int dp,
+  unsigned src, unsigned e, unsigned dest, unsigned de);
+
 #endif
 
@@ -0,0 +1,10 @@
+//
+// arch/arm/rsp/transpose.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+void rsp_ltv(struct rsp *rsp, uint32_t addr, unsigned vt, unsigned element);
+
+void rsp_stv(struct rsp *rsp, uint32_t addr, unsigned vt, unsigned element);
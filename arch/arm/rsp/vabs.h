@@ -0,0 +1,25 @@
+//
+// arch/arm/rsp/vabs.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vabs(uint16x8_t vs, uint16x8_t vt,
+  uint16x8_t zero, uint16x8_t *acc_lo) {
+  uint16x8_t vs_zero = vceqq_u16(vs, zero);
+  uint16x8_t sign_lt = rsp_vsign_mask(vs);
+  uint16x8_t vd = vbicq_u16(vt, vs_zero);
+
+  // Careful: if VT = 0x8000 and VS is negative,
+  // acc_lo will be 0x8000 but vd will be 0x7FFF.
+  vd = veorq_u16(vd, sign_lt);
+  *acc_lo = vsubq_u16(vd, sign_lt);
+
+  return vreinterpretq_u16_s16(vqsubq_s16(
+    vreinterpretq_s16_u16(vd), vreinterpretq_s16_u16(sign_lt)));
+}
+
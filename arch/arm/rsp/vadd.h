@@ -0,0 +1,27 @@
+//
+// arch/arm/rsp/vadd.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vadd(uint16x8_t vs, uint16x8_t vt,
+  uint16x8_t carry, uint16x8_t *acc_lo) {
+  int16x8_t svs = vreinterpretq_s16_u16(vs);
+  int16x8_t svt = vreinterpretq_s16_u16(vt);
+  int16x8_t minimum, maximum;
+
+  // VCC uses unsaturated arithmetic.
+  *acc_lo = vsubq_u16(vaddq_u16(vs, vt), carry);
+
+  // VD is the signed sum of the two sources and the carry. Since we
+  // have to saturate the sum of all three, we have to be clever.
+  minimum = vminq_s16(svs, svt);
+  maximum = vmaxq_s16(svs, svt);
+  minimum = vqsubq_s16(minimum, vreinterpretq_s16_u16(carry));
+  return vreinterpretq_u16_s16(vqaddq_s16(minimum, maximum));
+}
+
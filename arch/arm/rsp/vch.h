@@ -0,0 +1,50 @@
+//
+// arch/arm/rsp/vch.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vch(uint16x8_t vs, uint16x8_t vt,
+  uint16x8_t zero, uint16x8_t *ge, uint16x8_t *le, uint16x8_t *eq,
+  uint16x8_t *sign, uint16x8_t *vce) {
+
+  uint16x8_t sign_negvt, vt_neg;
+  uint16x8_t diff, diff_zero, diff_sel_mask;
+  uint16x8_t diff_gez, diff_lez;
+
+  // sign = (vs ^ vt) < 0
+  *sign = rsp_vsign_mask(veorq_u16(vs, vt));
+
+  // sign_negvt = sign ? -vt : vt
+  sign_negvt = veorq_u16(vt, *sign);
+  sign_negvt = vsubq_u16(sign_negvt, *sign);
+
+  // Compute diff, diff_zero:
+  diff = vsubq_u16(vs, sign_negvt);
+  diff_zero = vceqq_u16(diff, zero);
+
+  // Compute le/ge:
+  vt_neg = rsp_vsign_mask(vt);
+  diff_lez = vcgtq_s16(vreinterpretq_s16_u16(diff), vreinterpretq_s16_u16(zero));
+  diff_gez = vorrq_u16(diff_lez, diff_zero);
+  diff_lez = vmvnq_u16(diff_lez);
+
+  *ge = vbslq_u16(*sign, vt_neg, diff_gez);
+  *le = vbslq_u16(*sign, diff_lez, vt_neg);
+
+  // Compute vce:
+  *vce = vceqq_u16(diff, *sign);
+  *vce = vandq_u16(*vce, *sign);
+
+  // Compute !eq:
+  *eq = vmvnq_u16(vorrq_u16(diff_zero, *vce));
+
+  // Compute result:
+  diff_sel_mask = vbslq_u16(*sign, *le, *ge);
+  return vbslq_u16(diff_sel_mask, sign_negvt, vs);
+}
+
@@ -0,0 +1,56 @@
+//
+// arch/arm/rsp/vcmp.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_veq_vge_vlt_vne(uint32_t iw, uint16x8_t vs,
+  uint16x8_t vt, uint16x8_t zero, uint16x8_t *le, uint16x8_t eq,
+  uint16x8_t sign) {
+  int16x8_t svs = vreinterpretq_s16_u16(vs);
+  int16x8_t svt = vreinterpretq_s16_u16(vt);
+  uint16x8_t equal = vceqq_u16(vs, vt);
+
+  // VNE & VGE
+  if (iw & 0x2) {
+    // VGE
+    if (iw & 0x1) {
+      uint16x8_t gt = vcgtq_s16(svs, svt);
+      uint16x8_t equalsign = vandq_u16(eq, sign);
+
+      equal = vbicq_u16(equal, equalsign);
+      *le = vorrq_u16(gt, equal);
+    }
+
+    // VNE
+    else {
+      uint16x8_t nequal = vmvnq_u16(equal);
+
+      *le = vandq_u16(eq, equal);
+      *le = vorrq_u16(*le, nequal);
+    }
+  }
+
+  // VEQ & VLT
+  else {
+    // VEQ
+    if (iw & 0x1)
+      *le = vbicq_u16(equal, eq);
+
+    // VLT
+    else {
+      uint16x8_t lt = vcltq_s16(svs, svt);
+
+      equal = vandq_u16(eq, equal);
+      equal = vandq_u16(sign, equal);
+      *le = vorrq_u16(lt, equal);
+    }
+  }
+
+  return vbslq_u16(*le, vs, vt);
+}
+
@@ -0,0 +1,37 @@
+//
+// arch/arm/rsp/vcr.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vcr(uint16x8_t vs, uint16x8_t vt,
+  uint16x8_t zero, uint16x8_t *ge, uint16x8_t *le) {
+  uint16x8_t diff_sel_mask, diff_gez, diff_lez;
+  uint16x8_t sign, sign_notvt;
+
+  // sign = (vs ^ vt) < 0
+  sign = rsp_vsign_mask(veorq_u16(vs, vt));
+
+  // Compute le
+  diff_lez = vandq_u16(vs, sign);
+  diff_lez = vaddq_u16(diff_lez, vt);
+  *le = rsp_vsign_mask(diff_lez);
+
+  // Compute ge
+  diff_gez = vorrq_u16(vs, sign);
+  diff_gez = vreinterpretq_u16_s16(vminq_s16(
+    vreinterpretq_s16_u16(diff_gez), vreinterpretq_s16_u16(vt)));
+  *ge = vceqq_u16(diff_gez, vt);
+
+  // sign_notvt = sn ? ~vt : vt
+  sign_notvt = veorq_u16(vt, sign);
+
+  // Compute result:
+  diff_sel_mask = vbslq_u16(sign, *le, *ge);
+  return vbslq_u16(diff_sel_mask, sign_notvt, vs);
+}
+
@@ -0,0 +1,66 @@
+//
+// arch/arm/rsp/vmac.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vmacf_vmacu(uint32_t iw, uint16x8_t vs,
+  uint16x8_t vt, uint16x8_t zero, uint16x8_t *acc_lo, uint16x8_t *acc_md,
+  uint16x8_t *acc_hi) {
+  uint16x8_t overflow_hi_mask, overflow_md_mask;
+  uint16x8_t lo, md, hi, carry, overflow_mask;
+
+  // Get the product and shift it over
+  // being sure to save the carries.
+  lo = vmulq_u16(vs, vt);
+  hi = rsp_vmulhi_s16(vs, vt);
+
+  md = vshlq_n_u16(hi, 1);
+  carry = vshrq_n_u16(lo, 15);
+  hi = rsp_vsign_mask(hi);
+  md = vorrq_u16(md, carry);
+  lo = vshlq_n_u16(lo, 1);
+
+  // Tricky part: start accumulating everything.
+  // Get/keep the carry as we'll add it in later.
+  overflow_mask = vqaddq_u16(*acc_lo, lo);
+  *acc_lo = vaddq_u16(*acc_lo, lo);
+  overflow_mask = vmvnq_u16(vceqq_u16(*acc_lo, overflow_mask));
+
+  // Add in the carry. If the middle portion is
+  // already 0xFFFF and we have a carry, we have
+  // to carry the all the way up to hi.
+  md = vsubq_u16(md, overflow_mask);
+  carry = vceqq_u16(md, zero);
+  carry = vandq_u16(carry, overflow_mask);
+  hi = vsubq_u16(hi, carry);
+
+  // Accumulate the middle portion.
+  overflow_mask = vqaddq_u16(*acc_md, md);
+  *acc_md = vaddq_u16(*acc_md, md);
+  overflow_mask = vmvnq_u16(vceqq_u16(*acc_md, overflow_mask));
+
+  // Finish up the accumulation of the... accumulator.
+  *acc_hi = vaddq_u16(*acc_hi, hi);
+  *acc_hi = vsubq_u16(*acc_hi, overflow_mask);
+
+  // VMACU
+  if (iw & 0x1) {
+    overflow_hi_mask = rsp_vsign_mask(*acc_hi);
+    overflow_md_mask = rsp_vsign_mask(*acc_md);
+    md = vorrq_u16(overflow_md_mask, *acc_md);
+    overflow_mask = vcgtq_s16(vreinterpretq_s16_u16(*acc_hi),
+      vreinterpretq_s16_u16(zero));
+    md = vbicq_u16(md, overflow_hi_mask);
+    return vorrq_u16(overflow_mask, md);
+  }
+
+  // VMACF
+  else
+    return rsp_sclamp_acc_tomd(*acc_md, *acc_hi);
+}
+
@@ -0,0 +1,23 @@
+//
+// arch/arm/rsp/vmov.c
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rsp/cpu.h"
+#include "rsp/rsp.h"
+
+uint16x8_t rsp_vmov(struct rsp *rsp,
+  unsigned src, unsigned e, unsigned dest, rsp_vect_t vt_shuffle) {
+  uint16_t data[8];
+
+  // Copy element into data
+  vst1q_u16(data, vt_shuffle);
+
+  // Write out the upper part of the result.
+  rsp->cp2.regs[dest].e[e & 0x7] = data[e & 0x7];
+  return rsp_vect_load_unshuffled_operand(rsp->cp2.regs[dest].e);
+}
+
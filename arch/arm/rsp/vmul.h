@@ -0,0 +1,41 @@
+//
+// arch/arm/rsp/vmul.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vmulf_vmulu(uint32_t iw, uint16x8_t vs,
+  uint16x8_t vt, uint16x8_t zero, uint16x8_t *acc_lo, uint16x8_t *acc_md,
+  uint16x8_t *acc_hi) {
+  uint16x8_t lo, hi, sign1, sign2, eq, neg;
+
+  lo = vmulq_u16(vs, vt);
+  sign1 = vshrq_n_u16(lo, 15);
+  lo = vaddq_u16(lo, lo);
+  hi = rsp_vmulhi_s16(vs, vt);
+  sign2 = vshrq_n_u16(lo, 15);
+  *acc_lo = vaddq_u16(vdupq_n_u16(0x8000), lo);
+  sign1 = vaddq_u16(sign1, sign2);
+
+  hi = vshlq_n_u16(hi, 1);
+  eq = vceqq_u16(vs, vt);
+  *acc_md = vaddq_u16(hi, sign1);
+
+  neg = rsp_vsign_mask(*acc_md);
+  *acc_hi = vbicq_u16(neg, eq);
+
+  // VMULU
+  if (iw & 0x1) {
+    hi = vorrq_u16(*acc_md, neg);
+    return vbicq_u16(hi, *acc_hi);
+  }
+
+  // VMULF
+  else
+    return vaddq_u16(*acc_md, vandq_u16(eq, neg));
+}
+
@@ -0,0 +1,40 @@
+//
+// arch/arm/rsp/vmulh.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vmadh_vmudh(uint32_t iw, uint16x8_t vs,
+  uint16x8_t vt, uint16x8_t zero, uint16x8_t *acc_lo, uint16x8_t *acc_md,
+  uint16x8_t *acc_hi) {
+  uint16x8_t lo, hi, overflow_mask;
+
+  lo = vmulq_u16(vs, vt);
+  hi = rsp_vmulhi_s16(vs, vt);
+
+  // VMADH
+  if (iw & 0x8) {
+    // Tricky part: start accumulate everything.
+    // Get/keep the carry as we'll add it in later.
+    overflow_mask = vqaddq_u16(*acc_md, lo);
+    *acc_md = vaddq_u16(*acc_md, lo);
+    overflow_mask = vmvnq_u16(vceqq_u16(*acc_md, overflow_mask));
+
+    hi = vsubq_u16(hi, overflow_mask);
+    *acc_hi = vaddq_u16(*acc_hi, hi);
+  }
+
+  // VMUDH
+  else {
+    *acc_lo = zero;
+    *acc_md = lo;
+    *acc_hi = hi;
+  }
+
+  return rsp_sclamp_acc_tomd(*acc_md, *acc_hi);
+}
+
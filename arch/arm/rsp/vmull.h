@@ -0,0 +1,50 @@
+//
+// arch/arm/rsp/vmull.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vmadl_vmudl(uint32_t iw, uint16x8_t vs,
+  uint16x8_t vt, uint16x8_t zero, uint16x8_t *acc_lo, uint16x8_t *acc_md,
+  uint16x8_t *acc_hi) {
+  uint16x8_t hi, overflow_mask;
+
+  hi = rsp_vmulhi_u16(vs, vt);
+
+  // VMADL
+  if (iw & 0x8) {
+
+    // Tricky part: start accumulate everything.
+    // Get/keep the carry as we'll add it in later.
+    overflow_mask = vqaddq_u16(*acc_lo, hi);
+    *acc_lo = vaddq_u16(*acc_lo, hi);
+    overflow_mask = vmvnq_u16(vceqq_u16(*acc_lo, overflow_mask));
+    hi = vsubq_u16(zero, overflow_mask);
+
+    // Check for overflow of the upper sum.
+    overflow_mask = vqaddq_u16(*acc_md, hi);
+    *acc_md = vaddq_u16(*acc_md, hi);
+    overflow_mask = vmvnq_u16(vceqq_u16(*acc_md, overflow_mask));
+
+    // Finish up the accumulation of the... accumulator.
+    // Since the product was unsigned, only worry about
+    // positive overflow (i.e.: borrowing not possible).
+    *acc_hi = vsubq_u16(*acc_hi, overflow_mask);
+
+    return rsp_uclamp_acc(*acc_lo, *acc_md, *acc_hi, zero);
+  }
+
+  // VMUDL
+  else {
+    *acc_lo = hi;
+    *acc_md = zero;
+    *acc_hi = zero;
+
+    return hi;
+  }
+}
+
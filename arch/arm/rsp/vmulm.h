@@ -0,0 +1,58 @@
+//
+// arch/arm/rsp/vmulm.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vmadm_vmudm(uint32_t iw, uint16x8_t vs,
+  uint16x8_t vt, uint16x8_t zero, uint16x8_t *acc_lo, uint16x8_t *acc_md,
+  uint16x8_t *acc_hi) {
+  uint16x8_t lo, hi, sign, overflow_mask;
+
+  lo = vmulq_u16(vs, vt);
+  hi = rsp_vmulhi_u16(vs, vt);
+
+  // Fix up the unsigned product: if vs was negative,
+  // subtract vt from the upper 16-bits of the product.
+  sign = rsp_vsign_mask(vs);
+  vt = vandq_u16(vt, sign);
+  hi = vsubq_u16(hi, vt);
+
+  // VMADM
+  if (iw & 0x8) {
+    // Tricky part: start accumulate everything.
+    // Get/keep the carry as we'll add it in later.
+    overflow_mask = vqaddq_u16(*acc_lo, lo);
+    *acc_lo = vaddq_u16(*acc_lo, lo);
+    overflow_mask = vmvnq_u16(vceqq_u16(*acc_lo, overflow_mask));
+
+    // We can only borrow past 32-bits, so the
+    // carry can just be folded in here.
+    hi = vsubq_u16(hi, overflow_mask);
+
+    // Check for overflow of the upper sum.
+    overflow_mask = vqaddq_u16(*acc_md, hi);
+    *acc_md = vaddq_u16(*acc_md, hi);
+    overflow_mask = vmvnq_u16(vceqq_u16(*acc_md, overflow_mask));
+
+    // Finish up the accumulation of the... accumulator.
+    *acc_hi = vaddq_u16(*acc_hi, rsp_vsign_mask(hi));
+    *acc_hi = vsubq_u16(*acc_hi, overflow_mask);
+
+    return rsp_sclamp_acc_tomd(*acc_md, *acc_hi);
+  }
+
+  // VMUDM
+  else {
+    *acc_lo = lo;
+    *acc_md = hi;
+    *acc_hi = rsp_vsign_mask(hi);
+
+    return hi;
+  }
+}
+
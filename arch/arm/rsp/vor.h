@@ -8,7 +8,11 @@
 #include "common.h"
 #include <arm_neon.h>
 
-static inline uint16x8_t rsp_vor(uint16x8_t vs, uint16x8_t vt) {
-  return vorrq_u16(vs, vt);
+static inline uint16x8_t rsp_vor_vnor(uint32_t iw,
+  uint16x8_t vs, uint16x8_t vt) {
+  uint16x8_t vmask = vld1q_u16(rsp_vlogic_mask[iw & 0x1]);
+
+  uint16x8_t vd = vorrq_u16(vs, vt);
+  return veorq_u16(vd, vmask);
 }
 
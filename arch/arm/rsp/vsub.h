@@ -0,0 +1,29 @@
+//
+// arch/arm/rsp/vsub.h
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include <arm_neon.h>
+
+static inline uint16x8_t rsp_vsub(uint16x8_t vs, uint16x8_t vt,
+  uint16x8_t carry, uint16x8_t *acc_lo) {
+  int16x8_t svs = vreinterpretq_s16_u16(vs);
+  int16x8_t scarry = vreinterpretq_s16_u16(carry);
+  int16x8_t unsat_diff, sat_diff, overflow, vd;
+
+  // acc_lo uses saturated arithmetic.
+  unsat_diff = vsubq_s16(vreinterpretq_s16_u16(vt), scarry);
+  sat_diff = vqsubq_s16(vreinterpretq_s16_u16(vt), scarry);
+
+  *acc_lo = vreinterpretq_u16_s16(vsubq_s16(svs, unsat_diff));
+  vd = vqsubq_s16(svs, sat_diff);
+
+  // VD is the signed diff of the two sources and the carry. Since we
+  // have to saturate the diff of all three, we have to be clever.
+  overflow = vreinterpretq_s16_u16(vcgtq_s16(sat_diff, unsat_diff));
+  return vreinterpretq_u16_s16(vqaddq_s16(vd, overflow));
+}
+
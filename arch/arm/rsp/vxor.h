@@ -8,7 +8,11 @@
 #include "common.h"
 #include <arm_neon.h>
 
-static inline uint16x8_t rsp_vxor(uint16x8_t vs, uint16x8_t vt) {
-  return veorq_u16(vs, vt);
+static inline uint16x8_t rsp_vxor_vnxor(uint32_t iw,
+  uint16x8_t vs, uint16x8_t vt) {
+  uint16x8_t vmask = vld1q_u16(rsp_vlogic_mask[iw & 0x1]);
+
+  uint16x8_t vd = veorq_u16(vs, vt);
+  return veorq_u16(vd, vmask);
 }
 
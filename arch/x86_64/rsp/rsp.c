@@ -309,7 +309,10 @@ __m128i rsp_vect_load_and_shuffle_operand(
 //
 void rsp_vload_group1(struct rsp *rsp, uint32_t addr, unsigned element,
   uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm) {
-  __m128i ekey, data;
+  __m128i data;
+#ifdef __SSSE3__
+  __m128i ekey;
+#endif
 
   unsigned offset = addr & 0x7;
   unsigned ror = offset - element;
@@ -418,7 +421,9 @@ void rsp_vload_group4(struct rsp *rsp, uint32_t addr, unsigned element,
   unsigned ror;
 
   __m128i data = _mm_load_si128((__m128i *) (rsp->mem + aligned_addr));
+#ifdef __SSSE3__
   __m128i dkey;
+#endif
 
   // TODO: Use of element is almost certainly wrong...
   ror = 16 - element + offset;
@@ -460,7 +465,10 @@ void rsp_vstore_group1(struct rsp *rsp, uint32_t addr, unsigned element,
   uint16_t *regp, rsp_vect_t reg, rsp_vect_t dqm) {
   unsigned offset = addr & 0x7;
   unsigned ror = element - offset;
-  __m128i ekey, data;
+  __m128i data;
+#ifdef __SSSE3__
+  __m128i ekey;
+#endif
 
   // Shift the DQM up to the point where we mux in the data.
 #ifndef __SSSE3__
@@ -555,7 +563,9 @@ void rsp_vstore_group4(struct rsp *rsp, uint32_t addr, unsigned element,
   unsigned rol = offset;
 
   __m128i data = _mm_load_si128((__m128i *) (rsp->mem + aligned_addr));
+#ifdef __SSSE3__
   __m128i ekey;
+#endif
 
   if (rsp->pipeline.exdf_latch.request.type == RSP_MEM_REQUEST_QUAD)
     rol -= element;
@@ -26,6 +26,7 @@
 #endif
 #include "pi/is_viewer.h"
 #include "thread.h"
+#include <signal.h>
 #include <stdlib.h>
 
 cen64_cold static int check_extensions(void);
@@ -39,6 +40,15 @@ cen64_cold static int validate_sha(struct rom_file *rom, const uint8_t *good_sum
 cen64_cold static int run_device(struct cen64_device *device, bool no_video);
 cen64_cold static CEN64_THREAD_RETURN_TYPE run_device_thread(void *opaque);
 
+#ifdef SIGUSR1
+static struct rdp_stats *rdp_stats_signal_target;
+
+// Asks for an RDP statistics report at the end of the next frame.
+static void rdp_stats_signal_handler(int sig) {
+  rdp_stats_request_dump(rdp_stats_signal_target);
+}
+#endif
+
 // Called when another simulation instance is desired.
 int cen64_main(int argc, const char **argv) {
   struct controller controller[4] = { { 0, }, };
@@ -215,7 +225,15 @@ int cen64_main(int argc, const char **argv) {
     if (device_create(device, &ddipl, dd_variant, &ddrom,
       &pifrom, &cart, &eeprom, &sram,
       &flashram, is_in, controller,
-      options.no_audio, options.no_video, options.enable_profiling) == NULL) {
+      options.no_audio, options.no_video, options.enable_profiling,
+      options.enable_rsp_profiling, options.hle_audio,
+      options.rdp_capture_path, options.enable_rdp_stats,
+      options.soft_vi_threads, options.dump_video_path,
+      options.dump_video_format, options.dump_video_wait,
+      options.vi_hash_path, options.vi_hash_ref_path,
+      options.pace, options.unlimited, options.frameskip_skip,
+      options.frameskip_period, options.dump_audio_path,
+      options.dump_audio_format, options.dump_audio_wait) == NULL) {
       printf("Failed to create a device.\n");
       status = EXIT_FAILURE;
     }
@@ -474,11 +492,34 @@ int run_device(struct cen64_device *device, bool no_video) {
 
   cen64_thread_setname(&thread, "device");
 
+#ifdef SIGUSR1
+  if (device->rdp.stats) {
+    rdp_stats_signal_target = device->rdp.stats;
+    signal(SIGUSR1, rdp_stats_signal_handler);
+  }
+#endif
+
   if (!no_video)
     cen64_gl_window_thread(device);
 
   device->running = false;
   cen64_thread_join(&thread);
+
+  if (device->vi.window) {
+    const struct cen64_frame_queue *frames = &device->vi.window->frames;
+
+    printf("VI: %llu frames pushed, %llu drawn, %llu dropped, %llu late\n",
+      frames->pushed, frames->drawn, frames->dropped, frames->late);
+  }
+
+#ifdef SIGUSR1
+  if (device->rdp.stats)
+    signal(SIGUSR1, SIG_DFL);
+#endif
+
+  if (device->vi.hash && vi_hash_diverged(device->vi.hash))
+    return 1;
+
   return 0;
 }
 
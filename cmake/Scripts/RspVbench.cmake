@@ -0,0 +1,35 @@
+#
+# Runs each build of cen64-rsp-vbench, fails if any of them disagree
+# with the recorded hashes (util/rsp-vbench.hashes), then prints their
+# timings. The recorded hashes are what lets a single build, such as
+# the one ARM hosts get, be checked on its own.
+#
+# Usage: cmake -DRSP_VBENCH_BINARIES="a|b|..."
+#   [-DRSP_VBENCH_EMULATOR="qemu-aarch64|-L|..."]
+#   -DRSP_VBENCH_REFERENCE=hashes -P RspVbench.cmake
+#
+
+string(REPLACE "|" ";" binaries "${RSP_VBENCH_BINARIES}")
+string(REPLACE "|" ";" emulator "${RSP_VBENCH_EMULATOR}")
+file(READ ${RSP_VBENCH_REFERENCE} reference_hashes)
+string(REPLACE "\r" "" reference_hashes "${reference_hashes}")
+
+foreach (binary ${binaries})
+  execute_process(COMMAND ${emulator} ${binary} -hashes
+    OUTPUT_VARIABLE hashes RESULT_VARIABLE result)
+
+  string(REPLACE "\r" "" hashes "${hashes}")
+
+  if (NOT result EQUAL 0)
+    message(FATAL_ERROR "${binary} failed (${result}).")
+  endif ()
+
+  if (NOT hashes STREQUAL reference_hashes)
+    message(FATAL_ERROR "${binary} disagrees with ${RSP_VBENCH_REFERENCE}:\n"
+      "${hashes}\nexpected:\n${reference_hashes}")
+  endif ()
+endforeach ()
+
+foreach (binary ${binaries})
+  execute_process(COMMAND ${emulator} ${binary})
+endforeach ()
@@ -0,0 +1,18 @@
+# For cross-compiling CEN64 with aarch64-linux-gnu (Debian/Ubuntu).
+# Binaries are run through qemu-user where the build needs to run them.
+
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR aarch64)
+
+SET(PREFIX aarch64-linux-gnu)
+SET(CMAKE_C_COMPILER   ${PREFIX}-gcc)
+SET(CMAKE_CXX_COMPILER ${PREFIX}-g++)
+SET(CMAKE_AR           ${PREFIX}-gcc-ar)
+SET(CMAKE_NM           ${PREFIX}-gcc-nm)
+
+set(CMAKE_FIND_ROOT_PATH /usr/${PREFIX})
+set(CMAKE_CROSSCOMPILING_EMULATOR qemu-aarch64 -L /usr/${PREFIX})
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
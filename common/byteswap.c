@@ -0,0 +1,125 @@
+//
+// common/byteswap.c: Bulk byteswapping copies.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Like the rest of CEN64, the vector width is picked when building
+// (CEN64_ARCH_SUPPORT): AVX2 and SSSE3 shuffle bytes directly, SSE2
+// gets by with shifts, and NEON has dedicated byte-reversal ops.
+//
+
+#include "common.h"
+#include "common/byteswap.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+void byteswap_copy_16(void *dest, const void *src, size_t length) {
+  uint8_t *out = (uint8_t *) dest;
+  const uint8_t *in = (const uint8_t *) src;
+  size_t i = 0;
+
+#ifndef BIG_ENDIAN_HOST
+#if defined(__AVX2__)
+  const __m256i key = _mm256_set_epi8(
+    14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1,
+    14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i data = _mm256_loadu_si256((const __m256i *) (in + i));
+    _mm256_storeu_si256((__m256i *) (out + i), _mm256_shuffle_epi8(data, key));
+  }
+#elif defined(__SSE2__)
+#ifdef __SSSE3__
+  const __m128i key = _mm_set_epi8(
+    14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+#endif
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i data = _mm_loadu_si128((const __m128i *) (in + i));
+#ifdef __SSSE3__
+    data = _mm_shuffle_epi8(data, key);
+#else
+    data = _mm_or_si128(_mm_slli_epi16(data, 8), _mm_srli_epi16(data, 8));
+#endif
+    _mm_storeu_si128((__m128i *) (out + i), data);
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 16 <= length; i += 16)
+    vst1q_u8(out + i, vrev16q_u8(vld1q_u8(in + i)));
+#endif
+
+  for (; i < length; i += 2) {
+    uint16_t hword;
+
+    memcpy(&hword, in + i, sizeof(hword));
+    hword = byteswap_16(hword);
+    memcpy(out + i, &hword, sizeof(hword));
+  }
+#else
+  if (dest != src)
+    memcpy(dest, src, length);
+#endif
+}
+
+void byteswap_copy_32(void *dest, const void *src, size_t length) {
+  uint8_t *out = (uint8_t *) dest;
+  const uint8_t *in = (const uint8_t *) src;
+  size_t i = 0;
+
+#ifndef BIG_ENDIAN_HOST
+#if defined(__AVX2__)
+  const __m256i key = _mm256_set_epi8(
+    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+  for (; i + 32 <= length; i += 32) {
+    __m256i data = _mm256_loadu_si256((const __m256i *) (in + i));
+    _mm256_storeu_si256((__m256i *) (out + i), _mm256_shuffle_epi8(data, key));
+  }
+#elif defined(__SSE2__)
+#ifdef __SSSE3__
+  const __m128i key = _mm_set_epi8(
+    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+#endif
+
+  for (; i + 16 <= length; i += 16) {
+    __m128i data = _mm_loadu_si128((const __m128i *) (in + i));
+#ifdef __SSSE3__
+    data = _mm_shuffle_epi8(data, key);
+#else
+    data = _mm_or_si128(_mm_slli_epi16(data, 8), _mm_srli_epi16(data, 8));
+    data = _mm_shufflelo_epi16(data, _MM_SHUFFLE(2, 3, 0, 1));
+    data = _mm_shufflehi_epi16(data, _MM_SHUFFLE(2, 3, 0, 1));
+#endif
+    _mm_storeu_si128((__m128i *) (out + i), data);
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  for (; i + 16 <= length; i += 16)
+    vst1q_u8(out + i, vrev32q_u8(vld1q_u8(in + i)));
+#endif
+
+  for (; i < length; i += 4) {
+    uint32_t word;
+
+    memcpy(&word, in + i, sizeof(word));
+    word = byteswap_32(word);
+    memcpy(out + i, &word, sizeof(word));
+  }
+#else
+  if (dest != src)
+    memcpy(dest, src, length);
+#endif
+}
+
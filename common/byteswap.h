@@ -0,0 +1,25 @@
+//
+// common/byteswap.h: Bulk byteswapping copies.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __common_byteswap_h__
+#define __common_byteswap_h__
+#include "common.h"
+
+// Copies length bytes from src to dest, swapping the bytes of each
+// 16-bit halfword (or 32-bit word) on the way; that is, converting
+// between big-endian RDRAM contents and host order. length must be a
+// multiple of the element size. Neither buffer needs to be aligned,
+// and dest may equal src, but they mustn't otherwise overlap. Both
+// are plain copies on big-endian hosts.
+void byteswap_copy_16(void *dest, const void *src, size_t length);
+void byteswap_copy_32(void *dest, const void *src, size_t length);
+
+#endif
+
@@ -395,12 +395,14 @@ int dd_dma_write(void *opaque, uint32_t source, uint32_t dest, uint32_t length)
   // data buffer
   if (source == DD_DS_BUFFER_ADDRESS) {
     memcpy(dd->bus->ri->ram + dest, dd->ds_buffer, length);
+    ri_mark_dirty(dd->bus->ri, dest, length);
     dd_update_bm(dd);
   }
 
   // C2 buffer, always 0's
   else if (source == DD_C2S_BUFFER_ADDRESS) {
     memset(dd->bus->ri->ram + dest, 0, length);
+    ri_mark_dirty(dd->bus->ri, dest, length);
     dd_update_bm(dd);
   }
 
@@ -45,7 +45,14 @@ struct cen64_device *device_create(struct cen64_device *device,
   const struct save_file *eeprom, const struct save_file *sram,
   const struct save_file *flashram, struct is_viewer *is,
   const struct controller *controller,
-  bool no_audio, bool no_video, bool profiling) {
+  bool no_audio, bool no_video, bool profiling, bool rsp_profiling,
+  bool hle_audio, const char *rdp_capture_path, bool rdp_stats,
+  unsigned soft_vi_threads, const char *dump_video_path,
+  const char *dump_video_format, bool dump_video_wait,
+  const char *vi_hash_path, const char *vi_hash_ref_path,
+  bool pace, bool unlimited, unsigned frameskip_skip,
+  unsigned frameskip_period, const char *dump_audio_path,
+  const char *dump_audio_format, bool dump_audio_wait) {
 
   // Allocate memory for VR4300
   if ((device->vr4300 = vr4300_alloc()) == NULL) {
@@ -72,7 +79,8 @@ struct cen64_device *device_create(struct cen64_device *device,
   }
 
   // Initialize the AI.
-  if (ai_init(&device->ai, &device->bus, no_audio)) {
+  if (ai_init(&device->ai, &device->bus, no_audio,
+    dump_audio_path, dump_audio_format, dump_audio_wait)) {
     debug("create_device: Failed to initialize the AI.\n");
     return NULL;
   }
@@ -105,19 +113,22 @@ struct cen64_device *device_create(struct cen64_device *device,
   }
 
   // Initialize the VI.
-  if (vi_init(&device->vi, &device->bus, no_video)) {
+  if (vi_init(&device->vi, &device->bus, no_video, soft_vi_threads,
+    dump_video_path, dump_video_format, dump_video_wait,
+    vi_hash_path, vi_hash_ref_path, pace, unlimited)) {
     debug("create_device: Failed to initialize the VI.\n");
     return NULL;
   }
 
   // Initialize the RDP.
-  if (rdp_init(&device->rdp, &device->bus)) {
+  if (rdp_init(&device->rdp, &device->bus, rdp_capture_path, rdp_stats,
+    frameskip_skip, frameskip_period)) {
     debug("create_device: Failed to initialize the RDP.\n");
     return NULL;
   }
 
   // Initialize the RSP.
-  if (rsp_init(&device->rsp, &device->bus)) {
+  if (rsp_init(&device->rsp, &device->bus, rsp_profiling, hle_audio)) {
     debug("create_device: Failed to initialize the RSP.\n");
     return NULL;
   }
@@ -135,8 +146,47 @@ struct cen64_device *device_create(struct cen64_device *device,
 // Cleans up memory allocated for the device.
 void device_destroy(struct cen64_device *device, const char *cart_path) {
   vr4300_free(device->vr4300);
+
+  // Save RSP task profile, if any
+  if (cart_path && device->rsp.profile) {
+    char path[PATH_MAX];
+    FILE *f;
+
+    snprintf(path, PATH_MAX, "%s.rsp_profile", cart_path);
+    path[PATH_MAX - 1] = '\0';
+
+    if ((f = fopen(path, "w")) != NULL) {
+      rsp_profile_dump(device->rsp.profile, f);
+      fclose(f);
+    }
+
+    else
+      printf("Can't open %s\n", path);
+  }
+
   rsp_destroy(&device->rsp);
 
+  // Save RDP statistics, if any
+  if (cart_path && device->rdp.stats) {
+    char path[PATH_MAX];
+    FILE *f;
+
+    snprintf(path, PATH_MAX, "%s.rdp_stats", cart_path);
+    path[PATH_MAX - 1] = '\0';
+
+    if ((f = fopen(path, "w")) != NULL) {
+      rdp_stats_dump(device->rdp.stats, f);
+      fclose(f);
+    }
+
+    else
+      printf("Can't open %s\n", path);
+  }
+
+  ai_destroy(&device->ai);
+  rdp_destroy(&device->rdp);
+  vi_destroy(&device->vi);
+
   // Save profiling data, if any
   if (cart_path && has_profile_samples(device->vr4300)) {
     char path[PATH_MAX];
@@ -62,7 +62,14 @@ cen64_cold struct cen64_device *device_create(struct cen64_device *device,
   const struct save_file *eeprom, const struct save_file *sram,
   const struct save_file *flashram, struct is_viewer *is,
   const struct controller *controller,
-  bool no_audio, bool no_video, bool profiling);
+  bool no_audio, bool no_video, bool profiling, bool rsp_profiling,
+  bool hle_audio, const char *rdp_capture_path, bool rdp_stats,
+  unsigned soft_vi_threads, const char *dump_video_path,
+  const char *dump_video_format, bool dump_video_wait,
+  const char *vi_hash_path, const char *vi_hash_ref_path,
+  bool pace, bool unlimited, unsigned frameskip_skip,
+  unsigned frameskip_period, const char *dump_audio_path,
+  const char *dump_audio_format, bool dump_audio_wait);
 
 cen64_cold void device_exit(struct bus_controller *bus);
 cen64_cold void device_run(struct cen64_device *device);
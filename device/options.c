@@ -23,15 +23,32 @@ const struct cen64_options default_cen64_options = {
   NULL, // pifrom_path
   NULL, // cart_path
   NULL, // debugger_addr
+  NULL, // rdp_capture_path
+  NULL, // dump_video_path
+  NULL, // dump_video_format
+  NULL, // dump_audio_path
+  NULL, // dump_audio_format
+  NULL, // vi_hash_path
+  NULL, // vi_hash_ref_path
   NULL, // eeprom_path
   0,    // eeprom_size
   NULL, // sram_path
   0,    // sram_size
   NULL, // flashram_path
   0,    // is_viewer_output
+  0,    // soft_vi_threads
+  0,    // frameskip_skip
+  0,    // frameskip_period
   NULL, // controller
   false, // enable_debugger
   false, // enable_profiling
+  false, // enable_rsp_profiling
+  false, // enable_rdp_stats
+  false, // dump_video_wait
+  false, // dump_audio_wait
+  false, // pace
+  false, // unlimited
+  false, // hle_audio
   false, // multithread
   false, // no_audio
   false, // no_video
@@ -57,9 +74,122 @@ int parse_options(struct cen64_options *options, int argc, const char *argv[]) {
     else if (!strcmp(argv[i], "-profile"))
       options->enable_profiling = true;
 
+    else if (!strcmp(argv[i], "-rsp-profile"))
+      options->enable_rsp_profiling = true;
+
+    else if (!strcmp(argv[i], "-rdp-stats"))
+      options->enable_rdp_stats = true;
+
+    else if (!strcmp(argv[i], "-rdp-capture")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-rdp-capture requires a path to the trace file.\n\n");
+        return 1;
+      }
+
+      options->rdp_capture_path = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], "-pace"))
+      options->pace = true;
+
+    else if (!strcmp(argv[i], "-unlimited"))
+      options->unlimited = true;
+
+    else if (!strcmp(argv[i], "-frameskip")) {
+      if ((i + 1) >= (argc - 1) || sscanf(argv[i + 1], "%u/%u",
+        &options->frameskip_skip, &options->frameskip_period) != 2 ||
+        options->frameskip_skip >= options->frameskip_period) {
+        printf("-frameskip requires N/M, with N less than M.\n\n");
+        return 1;
+      }
+
+      i++;
+    }
+
     else if (!strcmp(argv[i], "-multithread"))
       options->multithread = true;
 
+    else if (!strcmp(argv[i], "-soft-vi")) {
+      if (!options->soft_vi_threads)
+        options->soft_vi_threads = 4;
+    }
+
+    else if (!strcmp(argv[i], "-soft-vi-threads")) {
+      if ((i + 1) >= (argc - 1) || !(options->soft_vi_threads =
+        strtoul(argv[i + 1], NULL, 10))) {
+        printf("-soft-vi-threads requires a number of threads.\n\n");
+        return 1;
+      }
+
+      i++;
+    }
+
+    else if (!strcmp(argv[i], "-dump-video")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-dump-video requires a path or file descriptor.\n\n");
+        return 1;
+      }
+
+      options->dump_video_path = argv[++i];
+
+      // The recorded frames are the software VI's output.
+      if (!options->soft_vi_threads)
+        options->soft_vi_threads = 4;
+    }
+
+    else if (!strcmp(argv[i], "-dump-video-format")) {
+      if ((i + 1) >= (argc - 1) || (strcmp(argv[i + 1], "raw") &&
+        strcmp(argv[i + 1], "y4m"))) {
+        printf("-dump-video-format requires raw or y4m.\n\n");
+        return 1;
+      }
+
+      options->dump_video_format = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], "-dump-video-wait"))
+      options->dump_video_wait = true;
+
+    else if (!strcmp(argv[i], "-dump-audio")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-dump-audio requires a path or file descriptor.\n\n");
+        return 1;
+      }
+
+      options->dump_audio_path = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], "-dump-audio-format")) {
+      if ((i + 1) >= (argc - 1) || (strcmp(argv[i + 1], "raw") &&
+        strcmp(argv[i + 1], "wav"))) {
+        printf("-dump-audio-format requires raw or wav.\n\n");
+        return 1;
+      }
+
+      options->dump_audio_format = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], "-dump-audio-wait"))
+      options->dump_audio_wait = true;
+
+    else if (!strcmp(argv[i], "-vi-hash")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-vi-hash requires a path to the log file.\n\n");
+        return 1;
+      }
+
+      options->vi_hash_path = argv[++i];
+    }
+
+    else if (!strcmp(argv[i], "-vi-hash-ref")) {
+      if ((i + 1) >= (argc - 1)) {
+        printf("-vi-hash-ref requires a path to the reference log.\n\n");
+        return 1;
+      }
+
+      options->vi_hash_ref_path = argv[++i];
+    }
+
     else if (!strcmp(argv[i], "-ddipl")) {
       if ((i + 1) >= (argc - 1)) {
         printf("-ddipl requires a path to the ROM file.\n\n");
@@ -83,6 +213,9 @@ int parse_options(struct cen64_options *options, int argc, const char *argv[]) {
       options->no_video = true;
     }
 
+    else if (!strcmp(argv[i], "-hle-audio"))
+      options->hle_audio = true;
+
     else if (!strcmp(argv[i], "-noaudio"))
       options->no_audio = true;
 
@@ -282,12 +415,38 @@ void print_command_line_usage(const char *invokation_string) {
       "                               By default, CEN64 uses localhost:64646.\n"
       "                               NOTE: the debugger is not implemented yet.\n"
       "  -profile                   : Profile the ROM (cpu-side).\n"
+      "  -rsp-profile               : Profile RSP tasks per microcode.\n"
+      "  -rdp-stats                 : Count RDP work per command and frame.\n"
+      "                               Send SIGUSR1 for a report of the last frame.\n"
+      "  -rdp-capture <path>        : Record RDP command lists (see rdp-replay).\n"
+      "  -pace                      : Run at real-time speed (by default, CEN64\n"
+      "                               runs as fast as it can).\n"
+      "  -unlimited                 : Like -pace, but start out running as fast\n"
+      "                               as possible; Tab toggles between the two.\n"
+      "  -frameskip <N/M>           : Don't draw N out of every M VI fields.\n"
       "  -multithread               : Run in a threaded (but quasi-accurate) mode.\n"
       "                             : This mode cannot be run with the debugger.\n"
+      "  -soft-vi                   : Produce the VI's output (filters, gamma) in\n"
+      "                               software; also works with -novideo.\n"
+      "  -soft-vi-threads <n>       : Threads used by -soft-vi (default: 4).\n"
+      "  -dump-video <path|fd>      : Record every VI frame (implies -soft-vi).\n"
+      "  -dump-video-format <fmt>   : raw (640x480 RGBA) or y4m; by default,\n"
+      "                               y4m if the path ends in .y4m.\n"
+      "  -dump-video-wait           : Slow down rather than drop frames when\n"
+      "                               the recording can't keep up.\n"
+      "  -dump-audio <path|fd>      : Record every AI DMA (works with -noaudio).\n"
+      "  -dump-audio-format <fmt>   : raw (16-bit stereo PCM) or wav; by default,\n"
+      "                               wav if the path ends in .wav.\n"
+      "  -dump-audio-wait           : Slow down rather than drop samples when\n"
+      "                               the recording can't keep up.\n"
+      "  -vi-hash <path>            : Log a hash of the frame buffer every frame.\n"
+      "  -vi-hash-ref <path>        : Stop at the first frame whose hash doesn't\n"
+      "                               match this log (from -vi-hash).\n"
       "  -ddipl <path>              : Path to the 64DD IPL ROM (enables 64DD mode).\n"
       "  -ddrom <path>              : Path to the 64DD disk ROM (requires -ddipl).\n"
       "  -headless                  : Run emulator without user-interface components.\n"
       "  -noaudio                   : Run emulator without audio.\n"
+      "  -hle-audio                 : Run known audio microcodes natively (inexact).\n"
       "  -novideo                   : Run emulator without video.\n"
       "  -is-viewer                 : Show IS Viewer 64 output.\n"
       "\n"
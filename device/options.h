@@ -18,6 +18,13 @@ struct cen64_options {
   const char *pifrom_path;
   const char *cart_path;
   const char *debugger_addr;
+  const char *rdp_capture_path;
+  const char *dump_video_path;
+  const char *dump_video_format;
+  const char *dump_audio_path;
+  const char *dump_audio_format;
+  const char *vi_hash_path;
+  const char *vi_hash_ref_path;
 
   const char *eeprom_path;
   size_t eeprom_size;
@@ -25,11 +32,21 @@ struct cen64_options {
   size_t sram_size;
   const char *flashram_path;
   int is_viewer_output;
+  unsigned soft_vi_threads;
+  unsigned frameskip_skip;
+  unsigned frameskip_period;
 
   struct controller *controller;
 
   bool enable_debugger;
   bool enable_profiling;
+  bool enable_rsp_profiling;
+  bool enable_rdp_stats;
+  bool dump_video_wait;
+  bool dump_audio_wait;
+  bool pace;
+  bool unlimited;
+  bool hle_audio;
   bool multithread;
   bool no_audio;
   bool no_video;
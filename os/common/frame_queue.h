@@ -0,0 +1,152 @@
+//
+// os/common/frame_queue.h: Triple-buffered VI to UI frame hand-off.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// The VI fills the back frame and swaps it with the ready one; the UI
+// swaps the ready frame with the one it last drew, but only if it's
+// a new one. Neither side ever waits for the other: the VI overwrites
+// frames that the UI didn't get to, and the UI always draws the most
+// recent complete one.
+//
+
+#ifndef CEN64_OS_COMMON_FRAME_QUEUE
+#define CEN64_OS_COMMON_FRAME_QUEUE
+#include "common.h"
+#include "timer.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define FRAMEBUF_SZ (640 * 480 * 4)
+#define CEN64_FRAME_QUEUE_FRESH 0x4U
+
+// Frames the UI draws later than this after the VI pushed them
+// count as late (one NTSC field).
+#define CEN64_FRAME_QUEUE_LATE_NS (NS_PER_SEC / 60)
+
+struct cen64_frame {
+  // Points at storage, unless the renderer provides memory that it
+  // can upload from more directly (see vi/upload.c).
+  uint8_t *data;
+  uint8_t storage[FRAMEBUF_SZ];
+
+  unsigned hres, vres;
+  unsigned hskip, type;
+  cen64_time pushed;
+
+  // Where in RDRAM data came from (maintained by the VI), and
+  // whether 16-bit pixels were put in host order on the way.
+  uint32_t origin;
+  size_t size;
+  bool swapped;
+};
+
+struct cen64_frame_queue {
+  struct cen64_frame frames[3];
+
+  // Index of the ready frame, ORed with CEN64_FRAME_QUEUE_FRESH
+  // until the UI picks it up. back/front are private to the VI/UI.
+  volatile unsigned ready;
+  unsigned back, front;
+
+  // Written by the VI thread.
+  unsigned long long pushed;
+  unsigned long long dropped;
+
+  // Written by the UI thread.
+  unsigned long long drawn;
+  unsigned long long late;
+};
+
+static inline unsigned cen64_frame_queue_exchange(
+  volatile unsigned *slot, unsigned value) {
+#ifdef _MSC_VER
+  return _InterlockedExchange((volatile long *) slot, value);
+#else
+  unsigned old;
+
+  do {
+    old = *slot;
+  } while (!__sync_bool_compare_and_swap(slot, old, value));
+
+  return old;
+#endif
+}
+
+static inline void cen64_frame_queue_init(struct cen64_frame_queue *queue) {
+  unsigned i;
+
+  memset(queue, 0, sizeof(*queue));
+
+  for (i = 0; i < sizeof(queue->frames) / sizeof(*queue->frames); i++)
+    queue->frames[i].data = queue->frames[i].storage;
+
+  queue->back = 0;
+  queue->ready = 1;
+  queue->front = 2;
+}
+
+// VI: the frame to fill next.
+static inline struct cen64_frame *cen64_frame_queue_back(
+  struct cen64_frame_queue *queue) {
+  return queue->frames + queue->back;
+}
+
+// VI: hands the back frame to the UI. Returns true if the UI needs to
+// be notified; if it hadn't picked up the previous frame yet, that one
+// is dropped and the notification for it is still pending.
+static inline bool cen64_frame_queue_push(struct cen64_frame_queue *queue) {
+  unsigned old;
+
+  get_time(&queue->frames[queue->back].pushed);
+  old = cen64_frame_queue_exchange(&queue->ready,
+    queue->back | CEN64_FRAME_QUEUE_FRESH);
+
+  queue->back = old & 0x3;
+  queue->pushed++;
+
+  if (old & CEN64_FRAME_QUEUE_FRESH) {
+    queue->dropped++;
+    return false;
+  }
+
+  return true;
+}
+
+// UI: returns the newest frame, or NULL if there's been none since
+// the last call.
+static inline const struct cen64_frame *cen64_frame_queue_pop(
+  struct cen64_frame_queue *queue) {
+  unsigned old;
+
+  if (!(queue->ready & CEN64_FRAME_QUEUE_FRESH))
+    return NULL;
+
+  old = cen64_frame_queue_exchange(&queue->ready, queue->front);
+  queue->front = old & 0x3;
+
+  return queue->frames + queue->front;
+}
+
+// UI: called once a frame from cen64_frame_queue_pop is on screen.
+static inline void cen64_frame_queue_drawn(struct cen64_frame_queue *queue,
+  const struct cen64_frame *frame) {
+  cen64_time now;
+
+  get_time(&now);
+
+  if (compute_time_difference(&now, &frame->pushed) >
+    CEN64_FRAME_QUEUE_LATE_NS)
+    queue->late++;
+
+  queue->drawn++;
+}
+
+#endif
+
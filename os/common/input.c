@@ -13,6 +13,7 @@
 #include "input.h"
 #include "os/keycodes.h"
 #include "si/controller.h"
+#include "vi/controller.h"
 
 bool shift_down;
 bool left_down;
@@ -73,6 +74,11 @@ void keyboard_press_callback(struct bus_controller *bus, unsigned key) {
     case CEN64_KEY_H: si->input[1] |= 1 << 0; break;
     case CEN64_KEY_T: si->input[1] |= 1 << 3; break;
     case CEN64_KEY_G: si->input[1] |= 1 << 2; break;
+
+    // Run as fast as possible, or at real-time speed.
+    case CEN64_KEY_TAB:
+      bus->vi->pacer.turbo = !bus->vi->pacer.turbo;
+      break;
   }
 }
 
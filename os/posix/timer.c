@@ -10,6 +10,7 @@
 
 #include "common.h"
 #include "os/posix/timer.h"
+#include <errno.h>
 #include <time.h>
 #include <sys/time.h>
 
@@ -39,3 +40,19 @@ void get_time(cen64_time *t) {
 #endif
 }
 
+// Sleeps for (at least) ns nanoseconds.
+void sleep_ns(unsigned long long ns) {
+  struct timespec ts;
+
+  ts.tv_sec = ns / NS_PER_SEC;
+  ts.tv_nsec = ns % NS_PER_SEC;
+
+#if defined(__APPLE__)
+  while (nanosleep(&ts, &ts) && errno == EINTR);
+#else
+  // Can't sleep on the raw clock; the rate difference doesn't matter
+  // for sleeps this short.
+  while (clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR);
+#endif
+}
+
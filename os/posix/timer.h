@@ -33,6 +33,7 @@ cen64_cold unsigned long long compute_time_difference(
   const cen64_time *now, const cen64_time *before);
 
 cen64_cold void get_time(cen64_time *t);
+cen64_cold void sleep_ns(unsigned long long ns);
 
 #endif
 
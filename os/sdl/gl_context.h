@@ -31,4 +31,10 @@ static inline void cen64_gl_context_destroy(
     SDL_GL_DeleteContext(window->window);
 }
 
+// Looks up an OpenGL entry point beyond what the headers provide.
+static inline void *cen64_gl_context_get_proc(const char *name)
+{
+    return SDL_GL_GetProcAddress(name);
+}
+
 #endif
@@ -88,14 +88,17 @@ bool cen64_gl_window_pump_events(struct vi_controller *vi,
         if (e.type == SDL_USEREVENT)
         {
             cen64_gl_window window = vi->window;
+            const struct cen64_frame *frame;
 
-            cen64_mutex_lock(&window->render_mutex);
+            // The VI may have pushed again since it notified us, in
+            // which case we already drew its newest frame.
+            if ((frame = cen64_frame_queue_pop(&window->frames)) == NULL)
+                continue;
 
-            gl_window_render_frame(vi, window->frame_buffer,
-                                   window->frame_hres, window->frame_vres,
-                                   window->frame_hskip, window->frame_type);
+            gl_window_render_frame(vi, frame->data, frame->hres,
+                                   frame->vres, frame->hskip, frame->type);
 
-            cen64_mutex_unlock(&window->render_mutex);
+            cen64_frame_queue_drawn(&window->frames, frame);
 
             // Update the window title every 60 VIs
             // to display the current VI/s rate.
@@ -133,19 +136,14 @@ int cen64_gl_window_create_objects(cen64_gl_window window)
         return 1;
     }
 
-    if (cen64_mutex_create(&window->render_mutex))
-    {
-        cen64_mutex_destroy(&window->event_mutex);
-        return 1;
-    }
-
     if (pipe(window->pipefds) < 0)
     {
-        cen64_mutex_destroy(&window->render_mutex);
         cen64_mutex_destroy(&window->event_mutex);
         return 1;
     }
 
+    cen64_frame_queue_init(&window->frames);
+
     return 0;
 }
 
@@ -12,13 +12,13 @@
 #define CEN64_OS_SDL_GL_WINDOW
 #include "common.h"
 #include "gl_config.h"
+#include "frame_queue.h"
 #include "gl_common.h"
 #include "gl_display.h"
 #include "gl_screen.h"
 #include "thread.h"
 #include <unistd.h>
 
-#define FRAMEBUF_SZ (640 * 474 * 4)
 #define CEN64_GL_WINDOW_BAD (NULL)
 struct cen64_gl_window
 {
@@ -29,10 +29,7 @@ struct cen64_gl_window
 
     int pipefds[2];
 
-    cen64_mutex render_mutex;
-    uint8_t frame_buffer[FRAMEBUF_SZ];
-    unsigned frame_hres, frame_vres;
-    unsigned frame_hskip, frame_type;
+    struct cen64_frame_queue frames;
 
     cen64_mutex event_mutex;
     bool exit_requested;
@@ -55,7 +52,6 @@ static inline void cen64_gl_window_destroy(cen64_gl_window window)
     close(window->pipefds[0]);
     close(window->pipefds[1]);
 
-    cen64_mutex_destroy(&window->render_mutex);
     cen64_mutex_destroy(&window->event_mutex);
     free(window);
 }
@@ -79,6 +79,7 @@
 #define CEN64_KEY_SEMICOLON SDLK_semicolon
 #define CEN64_KEY_SLASH SDLK_slash
 #define CEN64_KEY_SPACE SDLK_space
+#define CEN64_KEY_TAB SDLK_TAB
 
 #endif
 
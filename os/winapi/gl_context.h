@@ -45,5 +45,10 @@ static inline void cen64_gl_context_destroy(
   wglDeleteContext(context);
 }
 
+// Looks up an OpenGL entry point beyond what the headers provide.
+static inline void *cen64_gl_context_get_proc(const char *name) {
+  return (void *) wglGetProcAddress(name);
+}
+
 #endif
 
@@ -74,14 +74,17 @@ bool cen64_gl_window_pump_events(struct vi_controller *vi,
 
     else if (msg.message == WM_USER) {
       cen64_gl_window window = vi->window;
+      const struct cen64_frame *frame;
 
-      cen64_mutex_lock(&window->render_mutex);
+      // The VI may have pushed again since it notified us, in
+      // which case we already drew its newest frame.
+      if ((frame = cen64_frame_queue_pop(&window->frames)) == NULL)
+        continue;
 
-      gl_window_render_frame(vi, window->frame_buffer,
-        window->frame_hres, window->frame_vres,
-        window->frame_hskip, window->frame_type);
+      gl_window_render_frame(vi, frame->data, frame->hres,
+        frame->vres, frame->hskip, frame->type);
 
-      cen64_mutex_unlock(&window->render_mutex);
+      cen64_frame_queue_drawn(&window->frames, frame);
 
       // Update the window title every 60 VIs
       // to display the current VI/s rate.
@@ -184,7 +187,7 @@ cen64_gl_window cen64_gl_window_create(
 
   window->exit_requested = false;
   cen64_mutex_create(&window->event_mutex);
-  cen64_mutex_create(&window->render_mutex);
+  cen64_frame_queue_init(&window->frames);
   window->thread_id = GetCurrentThreadId();
   return window;
 }
@@ -11,6 +11,7 @@
 #ifndef CEN64_OS_WINAPI_GL_WINDOW
 #define CEN64_OS_WINAPI_GL_WINDOW
 #include "common.h"
+#include "frame_queue.h"
 #include "gl_common.h"
 #include "gl_config.h"
 #include "gl_display.h"
@@ -18,7 +19,6 @@
 #include "thread.h"
 #include <windows.h>
 
-#define FRAMEBUF_SZ (640 * 474 * 4)
 #define CEN64_GL_WINDOW_BAD (NULL)
 struct cen64_gl_window {
   HINSTANCE hinstance;
@@ -28,10 +28,7 @@ struct cen64_gl_window {
   DWORD thread_id;
   int pixel_format;
 
-  cen64_mutex render_mutex;
-  uint8_t frame_buffer[FRAMEBUF_SZ];
-  unsigned frame_hres, frame_vres;
-  unsigned frame_hskip, frame_type;
+  struct cen64_frame_queue frames;
 
   cen64_mutex event_mutex;
   bool exit_requested;
@@ -53,7 +50,6 @@ static inline void cen64_gl_window_destroy(cen64_gl_window window) {
   DestroyWindow(window->hwnd);
   UnregisterClass("CEN64", window->hinstance);
 
-  cen64_mutex_destroy(&window->render_mutex);
   cen64_mutex_destroy(&window->event_mutex);
   free(window);
 }
@@ -79,6 +79,7 @@
 #define CEN64_KEY_SEMICOLON VK_OEM_1
 #define CEN64_KEY_SLASH VK_OEM_2
 #define CEN64_KEY_SPACE VK_SPACE
+#define CEN64_KEY_TAB VK_TAB
 
 #endif
 
@@ -26,3 +26,7 @@ void get_time(cen64_time *t) {
   *t = timeGetTime();
 }
 
+void sleep_ns(unsigned long long ns) {
+  Sleep((DWORD) (ns / 1000000));
+}
+
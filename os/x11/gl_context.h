@@ -42,5 +42,10 @@ static inline void cen64_gl_context_destroy(
   glXDestroyContext(window->display, context);
 }
 
+// Looks up an OpenGL entry point beyond what the headers provide.
+static inline void *cen64_gl_context_get_proc(const char *name) {
+  return (void *) glXGetProcAddressARB((const GLubyte *) name);
+}
+
 #endif
 
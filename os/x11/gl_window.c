@@ -136,17 +136,13 @@ int cen64_gl_window_create_objects(cen64_gl_window window) {
     return 1;
   }
 
-  if (cen64_mutex_create(&window->render_mutex)) {
-    cen64_mutex_destroy(&window->event_mutex);
-    return 1;
-  }
-
   if (pipe(window->pipefds) < 0) {
-    cen64_mutex_destroy(&window->render_mutex);
     cen64_mutex_destroy(&window->event_mutex);
     return 1;
   }
 
+  cen64_frame_queue_init(&window->frames);
+
   return 0;
 }
 
@@ -188,15 +184,19 @@ int cen64_gl_window_thread(struct cen64_device *device) {
 
       // Did we get a UI event?
       if (FD_ISSET(vi->window->pipefds[0], &ready_to_read)) {
+        const struct cen64_frame *frame;
+
         read(vi->window->pipefds[0], &window, sizeof(window));
 
-        cen64_mutex_lock(&window->render_mutex);
+        // The VI may have pushed again since it notified us, in
+        // which case we already drew its newest frame.
+        if ((frame = cen64_frame_queue_pop(&window->frames)) == NULL)
+          continue;
 
-        gl_window_render_frame(vi, window->frame_buffer,
-          window->frame_hres, window->frame_vres,
-          window->frame_hskip, window->frame_type);
+        gl_window_render_frame(vi, frame->data, frame->hres,
+          frame->vres, frame->hskip, frame->type);
 
-        cen64_mutex_unlock(&window->render_mutex);
+        cen64_frame_queue_drawn(&window->frames, frame);
 
         // Update the window title every 60 VIs
         // to display the current VI/s rate.
@@ -11,6 +11,7 @@
 #ifndef CEN64_OS_X11_GL_WINDOW
 #define CEN64_OS_X11_GL_WINDOW
 #include "common.h"
+#include "frame_queue.h"
 #include "gl_common.h"
 #include "gl_config.h"
 #include "gl_display.h"
@@ -19,7 +20,6 @@
 #include <unistd.h>
 #include <X11/Xlib.h>
 
-#define FRAMEBUF_SZ (640 * 474 * 4)
 #define CEN64_GL_WINDOW_BAD (NULL)
 struct cen64_gl_window {
   cen64_gl_display display;
@@ -32,10 +32,7 @@ struct cen64_gl_window {
 
   int pipefds[2];
 
-  cen64_mutex render_mutex;
-  uint8_t frame_buffer[FRAMEBUF_SZ];
-  unsigned frame_hres, frame_vres;
-  unsigned frame_hskip, frame_type;
+  struct cen64_frame_queue frames;
 
   cen64_mutex event_mutex;
   bool exit_requested;
@@ -60,7 +57,6 @@ static inline void cen64_gl_window_destroy(cen64_gl_window window) {
   close(window->pipefds[0]);
   close(window->pipefds[1]);
 
-  cen64_mutex_destroy(&window->render_mutex);
   cen64_mutex_destroy(&window->event_mutex);
   free(window);
 }
@@ -79,6 +79,7 @@
 #define CEN64_KEY_SEMICOLON XK_semicolon
 #define CEN64_KEY_SLASH XK_slash
 #define CEN64_KEY_SPACE XK_space
+#define CEN64_KEY_TAB XK_Tab
 
 #endif
 
@@ -113,6 +113,7 @@ static int pi_dma_write(struct pi_controller *pi) {
       length = 0x003FFFFF - source;
 
     memcpy(pi->bus->ri->ram + dest, pi->bus->dd->ipl_rom + source, length);
+    ri_mark_dirty(pi->bus->ri, dest, length);
   }
 
   else if ((source & 0x05000000) == 0x05000000)
@@ -128,8 +129,10 @@ static int pi_dma_write(struct pi_controller *pi) {
       uint32_t sram_offset = (sram_bank * 0x8000) + (source & 0x7FFF);
       // Check SRAM address boundaries to prevent contiguous access across banks
       uint32_t sram_bank_end = (sram_offset + length - 1) / 0x8000;
-      if (sram_bank == sram_bank_end && sram_offset + length <= pi->sram->size)
+      if (sram_bank == sram_bank_end && sram_offset + length <= pi->sram->size) {
         memcpy(pi->bus->ri->ram + dest, (const uint8_t *) (pi->sram->ptr) + sram_offset, length);
+        ri_mark_dirty(pi->bus->ri, dest, length);
+      }
     }
     // FlashRAM
     else if (pi->flashram.data != NULL) {
@@ -138,10 +141,13 @@ static int pi_dma_write(struct pi_controller *pi) {
       if (pi->flashram.mode == FLASHRAM_STATUS) {
         uint64_t status = htonll(pi->flashram.status);
         memcpy(pi->bus->ri->ram + dest, &status, 8);
+        ri_mark_dirty(pi->bus->ri, dest, 8);
       }
       // FlashRAM read
-      else if (pi->flashram.mode == FLASHRAM_READ)
+      else if (pi->flashram.mode == FLASHRAM_READ) {
         memcpy(pi->bus->ri->ram + dest, pi->flashram.data + flashram_offset * 2, length);
+        ri_mark_dirty(pi->bus->ri, dest, length);
+      }
     }
   }
 
@@ -209,6 +215,7 @@ static int pi_dma_write(struct pi_controller *pi) {
       }
 
       memcpy(pi->bus->ri->ram+dest, mem, cur_len);
+      ri_mark_dirty(pi->bus->ri, dest, cur_len);
       pi->regs[PI_DRAM_ADDR_REG] += cur_len;
       pi->regs[PI_DRAM_ADDR_REG] = (pi->regs[PI_DRAM_ADDR_REG] + 7) & ~7;
 
@@ -0,0 +1,121 @@
+//
+// rdp/capture.c: RDP command list capture.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/capture.h"
+#include "ri/controller.h"
+
+static void rdp_capture_write_record(struct rdp_capture *capture,
+  uint32_t type, uint32_t arg) {
+  struct rdp_capture_record record;
+
+  record.type = byteswap_32(type);
+  record.arg = byteswap_32(arg);
+  fwrite(&record, sizeof(record), 1, capture->f);
+}
+
+// Opens a trace file for writing and emits its header.
+struct rdp_capture *rdp_capture_open(const char *path) {
+  struct rdp_capture_header header;
+  struct rdp_capture *capture;
+
+  if ((capture = calloc(1, sizeof(*capture))) == NULL)
+    return NULL;
+
+  if ((capture->f = fopen(path, "wb")) == NULL) {
+    printf("Can't open %s\n", path);
+
+    free(capture);
+    return NULL;
+  }
+
+  header.magic = byteswap_32(RDP_CAPTURE_MAGIC);
+  header.version = byteswap_32(RDP_CAPTURE_VERSION);
+  header.ram_size = byteswap_32(MAX_RDRAM_SIZE);
+  header.page_size = byteswap_32(RDP_CAPTURE_PAGE_SIZE);
+  fwrite(&header, sizeof(header), 1, capture->f);
+
+  return capture;
+}
+
+// Flushes and closes the trace file.
+void rdp_capture_close(struct rdp_capture *capture) {
+  if (capture == NULL)
+    return;
+
+  if (ferror(capture->f) | fclose(capture->f))
+    printf("RDP capture: Failed to write the trace.\n");
+
+  else
+    printf("RDP capture: %llu lists, %llu command words, %llu pages.\n",
+      (unsigned long long) capture->lists,
+      (unsigned long long) capture->words,
+      (unsigned long long) capture->pages);
+
+  free(capture);
+}
+
+// Called before the RDP starts on a list: records every page
+// that was written to (by the CPU, RSP, PI, ...) since the last one.
+void rdp_capture_begin(struct rdp_capture *capture,
+  struct ri_controller *ri) {
+  uint32_t addr, block, i;
+
+  for (addr = 0; addr < MAX_RDRAM_SIZE; addr += RDP_CAPTURE_PAGE_SIZE) {
+    bool dirty = false;
+
+    block = addr >> RDRAM_DIRTY_BLOCK_SHIFT;
+
+    for (i = 0; i < RDP_CAPTURE_PAGE_BLOCKS; i++) {
+      dirty |= (ri->dirty[block + i] & RDP_CAPTURE_DIRTY_BIT) != 0;
+      ri->dirty[block + i] &= ~RDP_CAPTURE_DIRTY_BIT;
+    }
+
+    if (!dirty)
+      continue;
+
+    rdp_capture_write_record(capture, RDP_CAPTURE_RECORD_PAGE, addr);
+    fwrite(ri->ram + addr, RDP_CAPTURE_PAGE_SIZE, 1, capture->f);
+    capture->pages++;
+  }
+}
+
+static void rdp_capture_flush(struct rdp_capture *capture) {
+  if (capture->buffered == 0)
+    return;
+
+  rdp_capture_write_record(capture,
+    RDP_CAPTURE_RECORD_COMMANDS, capture->buffered);
+
+  fwrite(capture->buffer, sizeof(*capture->buffer),
+    capture->buffered, capture->f);
+
+  capture->words += capture->buffered;
+  capture->buffered = 0;
+}
+
+// Records a command that the RDP has fully executed. The words
+// are taken as they sit in DMEM or RDRAM (i.e., big-endian).
+void rdp_capture_commands(struct rdp_capture *capture,
+  const uint32_t *words, uint32_t count) {
+  if (capture->buffered + count > RDP_CAPTURE_BUFFER_WORDS)
+    rdp_capture_flush(capture);
+
+  memcpy(capture->buffer + capture->buffered, words, count * sizeof(*words));
+  capture->buffered += count;
+}
+
+// Called after the RDP finishes a list.
+void rdp_capture_end(struct rdp_capture *capture) {
+  rdp_capture_flush(capture);
+  rdp_capture_write_record(capture, RDP_CAPTURE_RECORD_END, 0);
+  capture->lists++;
+}
+
@@ -0,0 +1,80 @@
+//
+// rdp/capture.h: RDP command list capture.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_capture_h__
+#define __rdp_capture_h__
+#include "common.h"
+#include "ri/controller.h"
+
+// A trace is a header followed by a stream of records. Every
+// field is stored big-endian, and RDRAM pages are stored as-is
+// (RDRAM is kept in big-endian order), so traces are portable.
+//
+// Before each command list, every RDRAM page that was written to
+// since the RDP last saw it is recorded; the commands that the list
+// executed follow. Replaying the records in order from a fresh
+// RDP reproduces exactly what the RDP read and rendered.
+//
+// The RDP's own writes don't set the capture's dirty bit (replay
+// makes them again), so anything else that writes to RDRAM while
+// a list runs is picked up before the next one.
+#define RDP_CAPTURE_MAGIC         0x52445054U // "RDPT"
+#define RDP_CAPTURE_VERSION       1
+#define RDP_CAPTURE_PAGE_SIZE     0x1000
+#define RDP_CAPTURE_BUFFER_WORDS  0x4000
+
+#define RDP_CAPTURE_PAGE_BLOCKS \
+  (RDP_CAPTURE_PAGE_SIZE / RDRAM_DIRTY_BLOCK_SIZE)
+
+// The capture's bit in the RDRAM dirty map (the VI's frames
+// use the low bits).
+#define RDP_CAPTURE_DIRTY_BIT     0x80
+
+enum rdp_capture_record_type {
+  RDP_CAPTURE_RECORD_PAGE = 1,      // arg: address; data: one page
+  RDP_CAPTURE_RECORD_COMMANDS = 2,  // arg: word count; data: words
+  RDP_CAPTURE_RECORD_END = 3,       // arg: 0 (end of a command list)
+};
+
+struct rdp_capture_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t ram_size;
+  uint32_t page_size;
+};
+
+struct rdp_capture_record {
+  uint32_t type;
+  uint32_t arg;
+};
+
+struct rdp_capture {
+  FILE *f;
+
+  // Executed command words (big-endian), written out in bulk.
+  uint32_t buffer[RDP_CAPTURE_BUFFER_WORDS];
+  uint32_t buffered;
+
+  uint64_t lists;
+  uint64_t pages;
+  uint64_t words;
+};
+
+cen64_cold struct rdp_capture *rdp_capture_open(const char *path);
+cen64_cold void rdp_capture_close(struct rdp_capture *capture);
+
+void rdp_capture_begin(struct rdp_capture *capture,
+  struct ri_controller *ri);
+void rdp_capture_commands(struct rdp_capture *capture,
+  const uint32_t *words, uint32_t count);
+void rdp_capture_end(struct rdp_capture *capture);
+
+#endif
+
@@ -24,10 +24,47 @@ static void rdp_connect_bus(struct rdp *rdp, struct bus_controller *bus) {
   rdp->bus = bus;
 }
 
+// Releases memory acquired for the RDP component.
+void rdp_destroy(struct rdp *rdp) {
+  rdp_capture_close(rdp->capture);
+  rdp->capture = NULL;
+
+  rdp_stats_free(rdp->stats);
+  rdp->stats = NULL;
+
+  rdp_frameskip_free(rdp->frameskip);
+  rdp->frameskip = NULL;
+}
+
 // Initializes the RDP component.
-int rdp_init(struct rdp *rdp, struct bus_controller *bus) {
+int rdp_init(struct rdp *rdp, struct bus_controller *bus,
+  const char *capture_path, bool stats,
+  unsigned frameskip_skip, unsigned frameskip_period) {
   rdp_connect_bus(rdp, bus);
 
+  rdp->capture = NULL;
+  rdp->stats = NULL;
+  rdp->frameskip = NULL;
+
+  if (capture_path &&
+    (rdp->capture = rdp_capture_open(capture_path)) == NULL)
+    return 1;
+
+  if (stats && (rdp->stats = rdp_stats_alloc()) == NULL)
+    goto err_stats;
+
+  if (frameskip_skip && (rdp->frameskip = rdp_frameskip_alloc(
+    frameskip_skip, frameskip_period)) == NULL)
+    goto err_frameskip;
+
   return 0;
+
+err_frameskip:
+  rdp_stats_free(rdp->stats);
+  rdp->stats = NULL;
+err_stats:
+  rdp_capture_close(rdp->capture);
+  rdp->capture = NULL;
+  return 1;
 }
 
@@ -11,6 +11,9 @@
 #ifndef __rdp_cpu_h__
 #define __rdp_cpu_h__
 #include "common.h"
+#include "rdp/capture.h"
+#include "rdp/frameskip.h"
+#include "rdp/stats.h"
 
 enum dp_register {
 #define X(reg) reg,
@@ -26,9 +29,15 @@ extern const char *dp_register_mnemonics[NUM_DP_REGISTERS];
 struct rdp {
   uint32_t regs[NUM_DP_REGISTERS];
   struct bus_controller *bus;
+  struct rdp_capture *capture;
+  struct rdp_stats *stats;
+  struct rdp_frameskip *frameskip;
 };
 
-cen64_cold int rdp_init(struct rdp *rdp, struct bus_controller *bus);
+cen64_cold void rdp_destroy(struct rdp *rdp);
+cen64_cold int rdp_init(struct rdp *rdp, struct bus_controller *bus,
+  const char *capture_path, bool stats,
+  unsigned frameskip_skip, unsigned frameskip_period);
 
 #endif
 
@@ -0,0 +1,120 @@
+//
+// rdp/frameskip.c: Skipping rasterization of undisplayed frames.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// During skipped fields, triangles and rectangles aimed at one of
+// the frame buffers the VI has been showing are dropped; everything
+// else (modes, tiles, TMEM loads, and drawing into any other buffer,
+// such as the depth buffer or render-to-texture targets) still runs.
+//
+// Frame buffers that get used as a texture (e.g. for a pause screen
+// or motion blur) are noticed when the texture is loaded. Drawing
+// into those is never skipped again, although the frame being loaded
+// at the time might already be incomplete. CPU reads of the frame
+// buffer aren't tracked.
+//
+
+#include "common.h"
+#include "rdp/frameskip.h"
+
+// Returns the remembered frame buffer that overlaps the range, if any.
+static struct rdp_frameskip_buffer *rdp_frameskip_find(
+  struct rdp_frameskip *frameskip, uint32_t start, uint32_t end) {
+  unsigned i;
+
+  for (i = 0; i < RDP_FRAMESKIP_BUFFERS; i++) {
+    struct rdp_frameskip_buffer *buffer = frameskip->buffers + i;
+
+    if (start < buffer->end && buffer->start < end)
+      return buffer;
+  }
+
+  return NULL;
+}
+
+struct rdp_frameskip *rdp_frameskip_alloc(unsigned skip, unsigned period) {
+  struct rdp_frameskip *frameskip;
+
+  if ((frameskip = calloc(1, sizeof(*frameskip))) == NULL)
+    return NULL;
+
+  frameskip->skip = skip;
+  frameskip->period = period;
+  return frameskip;
+}
+
+void rdp_frameskip_free(struct rdp_frameskip *frameskip) {
+  if (frameskip == NULL)
+    return;
+
+  printf("RDP frame skip: %llu of %llu fields skipped, "
+    "%llu primitives left out, %llu frame buffer reads.\n",
+    (unsigned long long) frameskip->skipped_fields,
+    (unsigned long long) frameskip->fields,
+    (unsigned long long) frameskip->skipped_commands,
+    (unsigned long long) frameskip->readbacks);
+
+  free(frameskip);
+}
+
+void rdp_frameskip_field(struct rdp_frameskip *frameskip,
+  uint32_t origin, uint32_t size) {
+  struct rdp_frameskip_buffer *buffer;
+
+  if (size) {
+    if ((buffer = rdp_frameskip_find(frameskip,
+      origin, origin + size)) == NULL) {
+      buffer = frameskip->buffers + frameskip->next_buffer;
+      frameskip->next_buffer = (frameskip->next_buffer + 1) %
+        RDP_FRAMESKIP_BUFFERS;
+
+      buffer->skipped = false;
+      buffer->unsafe = false;
+    }
+
+    buffer->start = origin;
+    buffer->end = origin + size;
+  }
+
+  frameskip->active = frameskip->fields++ % frameskip->period <
+    frameskip->skip;
+
+  if (frameskip->active)
+    frameskip->skipped_fields++;
+}
+
+bool rdp_frameskip_draw(struct rdp_frameskip *frameskip,
+  uint32_t address, uint32_t length) {
+  struct rdp_frameskip_buffer *buffer;
+
+  if (!frameskip->active)
+    return false;
+
+  if ((buffer = rdp_frameskip_find(frameskip,
+    address, address + length)) == NULL || buffer->unsafe)
+    return false;
+
+  buffer->skipped = true;
+  frameskip->skipped_commands++;
+  return true;
+}
+
+void rdp_frameskip_load(struct rdp_frameskip *frameskip,
+  uint32_t address, uint32_t length) {
+  struct rdp_frameskip_buffer *buffer;
+
+  if ((buffer = rdp_frameskip_find(frameskip,
+    address, address + length)) == NULL || !buffer->skipped)
+    return;
+
+  if (!buffer->unsafe) {
+    buffer->unsafe = true;
+    frameskip->readbacks++;
+  }
+}
+
@@ -0,0 +1,61 @@
+//
+// rdp/frameskip.h: Skipping rasterization of undisplayed frames.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_frameskip_h__
+#define __rdp_frameskip_h__
+#include "common.h"
+
+// How many of the frame buffers the VI most recently showed are
+// remembered (games double or triple buffer).
+#define RDP_FRAMESKIP_BUFFERS 4
+
+struct rdp_frameskip_buffer {
+  uint32_t start, end;
+
+  // Drawing into the buffer was skipped at some point; and, since a
+  // texture was loaded from it afterwards, it never will be again.
+  bool skipped;
+  bool unsafe;
+};
+
+struct rdp_frameskip {
+  struct rdp_frameskip_buffer buffers[RDP_FRAMESKIP_BUFFERS];
+  unsigned next_buffer;
+
+  // Drawing is skipped during skip out of every period VI fields.
+  unsigned skip, period;
+  bool active;
+
+  uint64_t fields;
+  uint64_t skipped_fields;
+  uint64_t skipped_commands;
+  uint64_t readbacks;
+};
+
+cen64_cold struct rdp_frameskip *rdp_frameskip_alloc(
+  unsigned skip, unsigned period);
+cen64_cold void rdp_frameskip_free(struct rdp_frameskip *frameskip);
+
+// Called by the VI at the start of each field with the part of RDRAM
+// that it's displaying.
+void rdp_frameskip_field(struct rdp_frameskip *frameskip,
+  uint32_t origin, uint32_t size);
+
+// Returns true if a primitive drawn into the given color image can
+// be left out.
+bool rdp_frameskip_draw(struct rdp_frameskip *frameskip,
+  uint32_t address, uint32_t length);
+
+// Called before a texture is loaded from the given part of RDRAM.
+void rdp_frameskip_load(struct rdp_frameskip *frameskip,
+  uint32_t address, uint32_t length);
+
+#endif
+
@@ -0,0 +1,350 @@
+//
+// rdp/gentables.c: Generates the RDP's lookup tables.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Run at build time; writes the tables that n64video.c used to
+// compute in angrylion_rdp_init() out as const, cache-line aligned
+// arrays, so that they live in (shared, read-only) .rodata.
+//
+
+#include "common.h"
+#include "tctables.h"
+
+static uint32_t gamma_table[0x100];
+static uint32_t gamma_dither_table[0x4000];
+static uint16_t z_com_table[0x40000];
+static uint32_t z_complete_dec_table[0x4000];
+static uint8_t replicated_rgba[32];
+static int vi_restore_table[0x400];
+static int32_t maskbits_table[16];
+static uint32_t special_9bit_clamptable[512];
+static int32_t special_9bit_exttable[512];
+static int32_t log2table[256];
+static int32_t tcdiv_table[0x8000];
+static uint8_t bldiv_hwaccurate_table[0x8000];
+static uint16_t deltaz_comparator_lut[0x10000];
+
+static struct {
+  uint8_t cvg;
+  uint8_t cvbit;
+  uint8_t xoff;
+  uint8_t yoff;
+} cvarray[0x100];
+
+static const struct {
+  uint32_t shift;
+  uint32_t add;
+} z_dec_table[8] = {
+  {6, 0x00000},
+  {5, 0x20000},
+  {4, 0x30000},
+  {3, 0x38000},
+  {2, 0x3c000},
+  {1, 0x3e000},
+  {0, 0x3f000},
+  {0, 0x3f800},
+};
+
+static uint32_t vi_integer_sqrt(uint32_t a) {
+  unsigned long op = a, res = 0, one = 1 << 30;
+
+  while (one > op)
+    one >>= 2;
+
+  while (one != 0) {
+    if (op >= res + one) {
+      op -= res + one;
+      res += one << 1;
+    }
+
+    res >>= 1;
+    one >>= 2;
+  }
+
+  return res;
+}
+
+static uint16_t decompress_cvmask_frombyte(uint8_t x) {
+  return (x & 1) | ((x & 2) << 4) | (x & 4) | ((x & 8) << 4) |
+    ((x & 0x10) << 4) | ((x & 0x20) << 8) | ((x & 0x40) << 4) |
+    ((x & 0x80) << 8);
+}
+
+static void build_gamma_tables(void) {
+  int i;
+
+  for (i = 0; i < 0x100; i++)
+    gamma_table[i] = vi_integer_sqrt(i << 6) << 1;
+
+  for (i = 0; i < 0x4000; i++)
+    gamma_dither_table[i] = vi_integer_sqrt(i) << 1;
+}
+
+static void build_z_tables(void) {
+  uint32_t exponent, mantissa;
+  int i, z;
+
+  for (z = 0; z < 0x40000; z++) {
+    unsigned top = (z >> 11) & 0x7f;
+    uint16_t altmem;
+
+    if (top < 0x40)
+      altmem = (z >> 4) & 0x1ffc;
+    else if (top < 0x60)
+      altmem = ((z >> 3) & 0x1ffc) | 0x2000;
+    else if (top < 0x70)
+      altmem = ((z >> 2) & 0x1ffc) | 0x4000;
+    else if (top < 0x78)
+      altmem = ((z >> 1) & 0x1ffc) | 0x6000;
+    else if (top < 0x7c)
+      altmem = (z & 0x1ffc) | 0x8000;
+    else if (top < 0x7e)
+      altmem = ((z << 1) & 0x1ffc) | 0xa000;
+    else if (top == 0x7e)
+      altmem = ((z << 2) & 0x1ffc) | 0xc000;
+    else
+      altmem = ((z << 2) & 0x1ffc) | 0xe000;
+
+    z_com_table[z] = altmem;
+  }
+
+  for (i = 0; i < 0x4000; i++) {
+    exponent = (i >> 11) & 7;
+    mantissa = i & 0x7ff;
+
+    z_complete_dec_table[i] = ((mantissa << z_dec_table[exponent].shift) +
+      z_dec_table[exponent].add) & 0x3ffff;
+  }
+
+  deltaz_comparator_lut[0] = 0;
+
+  for (i = 1; i < 0x10000; i++) {
+    int k;
+
+    for (k = 15; !(i & (1 << k)); k--);
+    deltaz_comparator_lut[i] = 1 << k;
+  }
+}
+
+static void build_cvmask_derivatives(void) {
+  static const uint8_t yarray[16] = {
+    0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
+  static const uint8_t xarray[16] = {
+    0, 3, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0};
+
+  uint16_t mask, maskx, masky;
+  int i, k;
+
+  for (i = 0; i < 0x100; i++) {
+    mask = decompress_cvmask_frombyte(i);
+    cvarray[i].cvbit = (i >> 7) & 1;
+    cvarray[i].cvg = 0;
+
+    for (k = 0; k < 8; k++)
+      cvarray[i].cvg += (i >> k) & 1;
+
+    for (masky = 0, k = 0; k < 4; k++)
+      masky |= ((mask & (0xf000 >> (k << 2))) > 0) << k;
+
+    cvarray[i].yoff = yarray[masky];
+    maskx = (mask & (0xf000 >> (cvarray[i].yoff << 2))) >>
+      ((cvarray[i].yoff ^ 3) << 2);
+    cvarray[i].xoff = xarray[maskx];
+  }
+}
+
+static void build_texture_tables(void) {
+  int i, k;
+
+  log2table[0] = log2table[1] = 0;
+
+  for (i = 2; i < 0x100; i++) {
+    for (k = 7; !((i >> k) & 1); k--);
+    log2table[i] = k;
+  }
+
+  for (i = 0; i < 32; i++)
+    replicated_rgba[i] = (i << 3) | ((i >> 2) & 7);
+
+  maskbits_table[0] = 0x3ff;
+
+  for (i = 1; i < 16; i++)
+    maskbits_table[i] = ((uint16_t) 0xffff >> (16 - i)) & 0x3ff;
+
+  // Perspective divide: normalize, then look up the reciprocal.
+  for (i = 0; i < 0x8000; i++) {
+    int shift, normout, wnorm, temppoint, tempslope, tlu_rcp;
+
+    for (k = 1; k <= 14 && !((i << k) & 0x8000); k++);
+    shift = k - 1;
+    normout = (i << shift) & 0x3fff;
+    wnorm = (normout & 0xff) << 2;
+    normout >>= 8;
+
+    temppoint = norm_point_table[normout];
+    tempslope = norm_slope_table[normout];
+    tempslope = (tempslope | ~0x3ff) + 1;
+
+    tlu_rcp = (((tempslope * wnorm) >> 10) + temppoint) & 0x7fff;
+    tcdiv_table[i] = shift | (tlu_rcp << 4);
+  }
+}
+
+static void build_color_tables(void) {
+  int i, k;
+
+  for (i = 0; i < 0x400; i++) {
+    if (((i >> 5) & 0x1f) < (i & 0x1f))
+      vi_restore_table[i] = 1;
+    else if (((i >> 5) & 0x1f) > (i & 0x1f))
+      vi_restore_table[i] = -1;
+    else
+      vi_restore_table[i] = 0;
+  }
+
+  for (i = 0; i < 0x200; i++) {
+    switch ((i >> 7) & 3) {
+      case 0:
+      case 1:
+        special_9bit_clamptable[i] = i & 0xff;
+        break;
+
+      case 2:
+        special_9bit_clamptable[i] = 0xff;
+        break;
+
+      case 3:
+        special_9bit_clamptable[i] = 0;
+        break;
+    }
+
+    special_9bit_exttable[i] = ((i & 0x180) == 0x180)
+      ? (i | ~0x1ff) : (i & 0x1ff);
+  }
+
+  // The blender's divider, bit for bit.
+  for (i = 0; i < 0x8000; i++) {
+    int d = (i >> 11) & 0xf;
+    int n = i & 0x7ff;
+    int invd = (~d) & 0xf;
+    int res = 0, temp, nbit;
+    int ps[9];
+
+    temp = invd + (n >> 8) + 1;
+    ps[0] = temp & 7;
+
+    for (k = 0; k < 8; k++) {
+      nbit = (n >> (7 - k)) & 1;
+
+      if (res & (0x100 >> k))
+        temp = invd + (ps[k] << 1) + nbit + 1;
+      else
+        temp = d + (ps[k] << 1) + nbit;
+
+      ps[k + 1] = temp & 7;
+
+      if (temp & 0x10)
+        res |= (1 << (7 - k));
+    }
+
+    bldiv_hwaccurate_table[i] = res;
+  }
+}
+
+static void write_table(FILE *f, const char *decl,
+  const char *name, const void *table, size_t size, size_t count) {
+  size_t i;
+
+  fprintf(f, "cen64_align(static const %s %s[0x%lX], CACHE_LINE_SIZE) = {",
+    decl, name, (unsigned long) count);
+
+  for (i = 0; i < count; i++) {
+    long long value;
+
+    if (size == 1)
+      value = ((const uint8_t *) table)[i];
+    else if (size == 2)
+      value = ((const uint16_t *) table)[i];
+    else
+      value = ((const int32_t *) table)[i];
+
+    // Only the signed tables hold negative values.
+    if (strcmp(decl, "uint32_t") == 0)
+      value = (uint32_t) value;
+
+    fprintf(f, "%s%lld,", i % 12 ? " " : "\n  ", value);
+  }
+
+  fprintf(f, "\n};\n\n");
+}
+
+int main(int argc, const char *argv[]) {
+  FILE *f;
+  int i;
+
+  if (argc != 2) {
+    printf("Usage: %s <tables.h>\n", argv[0]);
+    return 1;
+  }
+
+  build_gamma_tables();
+  build_z_tables();
+  build_cvmask_derivatives();
+  build_texture_tables();
+  build_color_tables();
+
+  if ((f = fopen(argv[1], "w")) == NULL) {
+    printf("Can't open %s\n", argv[1]);
+    return 1;
+  }
+
+  fprintf(f, "//\n"
+    "// rdp/tables.h: RDP lookup tables.\n"
+    "//\n"
+    "// Generated by rdp/gentables.c at build time; do not edit.\n"
+    "//\n\n"
+    "#ifndef __rdp_tables_h__\n"
+    "#define __rdp_tables_h__\n\n");
+
+#define WRITE_TABLE(decl, name) write_table(f, decl, #name, \
+  name, sizeof(*name), sizeof(name) / sizeof(*name))
+
+  WRITE_TABLE("uint32_t", gamma_table);
+  WRITE_TABLE("uint32_t", gamma_dither_table);
+  WRITE_TABLE("uint16_t", z_com_table);
+  WRITE_TABLE("uint32_t", z_complete_dec_table);
+  WRITE_TABLE("uint8_t", replicated_rgba);
+  WRITE_TABLE("int", vi_restore_table);
+  WRITE_TABLE("int32_t", maskbits_table);
+  WRITE_TABLE("uint32_t", special_9bit_clamptable);
+  WRITE_TABLE("int32_t", special_9bit_exttable);
+  WRITE_TABLE("int32_t", log2table);
+  WRITE_TABLE("int32_t", tcdiv_table);
+  WRITE_TABLE("uint8_t", bldiv_hwaccurate_table);
+  WRITE_TABLE("uint16_t", deltaz_comparator_lut);
+
+#undef WRITE_TABLE
+
+  fprintf(f, "cen64_align(static const CVtcmaskDERIVATIVE "
+    "cvarray[0x100], CACHE_LINE_SIZE) = {");
+
+  for (i = 0; i < 0x100; i++) {
+    fprintf(f, "%s{%u, %u, %u, %u},", i % 4 ? " " : "\n  ",
+      cvarray[i].cvg, cvarray[i].cvbit, cvarray[i].xoff, cvarray[i].yoff);
+  }
+
+  fprintf(f, "\n};\n\n#endif\n\n");
+
+  if (ferror(f) | fclose(f)) {
+    printf("Failed to write %s\n", argv[1]);
+    return 1;
+  }
+
+  return 0;
+}
+
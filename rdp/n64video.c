@@ -75,12 +75,20 @@ MarathonMan
 #include "common.h"
 #include "bus/controller.h"
 #include "device/device.h"
+#include "rdp/frameskip.h"
+#include "rdp/stats.h"
 #include "ri/controller.h"
-#include "tctables.h"
+#include "vi/soft.h"
 #include "vr4300/interface.h"
 #include <stdint.h>
 #include <string.h>
 
+#ifdef __AVX__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define byteswap_16(x) ((uint16_t) (((uint8_t) (x >> 8)) | ((uint16_t) (x << 8))))
 
 #define SP_INTERRUPT	0x1
@@ -187,10 +195,14 @@ static struct cen64_device *cen64;
 
 FILE *rdp_exec;
 
-uint32_t rdp_cmd_data[0x10000];
+/* commands are parsed in place, straight out of DMEM or RDRAM; only one that
+   wraps around DMEM, or that a list leaves unfinished, is gathered into
+   rdp_cmd_data first. either way the words are kept big-endian. */
+uint32_t rdp_cmd_data[44];
 uint32_t rdp_cmd_ptr = 0;
-uint32_t rdp_cmd_cur = 0;
-uint32_t ptr_onstart = 0;
+static const uint32_t *rdp_cmd_words;
+
+#define RDP_CMD_WORD(n)	(byteswap_32(rdp_cmd_words[(n)]))
 
 extern FILE* zeldainfo;
 
@@ -325,6 +337,7 @@ typedef struct
 	int rgb_alpha_dither;
 	int realblendershiftersneeded;
 	int interpixelblendershiftersneeded;
+	int earlyzreject;
 } MODEDERIVS;
 
 typedef struct
@@ -556,7 +569,6 @@ static inline void tcclamp_cycle(int32_t* S, int32_t* T, int32_t* SFRAC, int32_t
 static inline void tcclamp_cycle_light(int32_t* S, int32_t* T, int32_t maxs, int32_t maxt, int32_t num);
 static inline void tcshift_cycle(int32_t* S, int32_t* T, int32_t* maxs, int32_t* maxt, uint32_t num);
 static inline void tcshift_copy(int32_t* S, int32_t* T, uint32_t num);
-cen64_cold static void precalculate_everything(void);
 static inline int alpha_compare(int32_t comb_alpha);
 static inline int32_t color_combiner_equation(int32_t a, int32_t b, int32_t c, int32_t d);
 static inline int32_t alpha_combiner_equation(int32_t a, int32_t b, int32_t c, int32_t d);
@@ -565,8 +577,7 @@ static inline void blender_equation_cycle0_2(int* r, int* g, int* b);
 static inline void blender_equation_cycle1(int* r, int* g, int* b);
 static inline uint32_t rightcvghex(uint32_t x, uint32_t fmask); 
 static inline uint32_t leftcvghex(uint32_t x, uint32_t fmask);
-static inline void compute_cvg_noflip(int32_t scanline);
-static inline void compute_cvg_flip(int32_t scanline);
+static inline void compute_cvg(int32_t scanline, int flip);
 static void fbwrite_4(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
 static void fbwrite_8(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
 static void fbwrite_16(uint32_t curpixel, uint32_t r, uint32_t g, uint32_t b, uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
@@ -575,6 +586,8 @@ static void fbfill_4(uint32_t curpixel);
 static void fbfill_8(uint32_t curpixel);
 static void fbfill_16(uint32_t curpixel);
 static void fbfill_32(uint32_t curpixel);
+static void fbfill_span(uint32_t curpixel, uint32_t count);
+static void fbwrite_copy_qword(uint32_t addr, uint64_t qword);
 static void fbread_4(uint32_t num, uint32_t* curpixel_memcvg);
 static void fbread_8(uint32_t num, uint32_t* curpixel_memcvg);
 static void fbread_16(uint32_t num, uint32_t* curpixel_memcvg);
@@ -586,12 +599,11 @@ static void fbread2_32(uint32_t num, uint32_t* curpixel_memcvg);
 static inline uint32_t z_decompress(uint32_t rawz);
 static inline uint32_t dz_decompress(uint32_t compresseddz);
 static inline uint32_t dz_compress(uint32_t value);
-cen64_cold static void z_build_com_table(void);
-cen64_cold static void precalc_cvmask_derivatives(void);
-static inline uint16_t decompress_cvmask_frombyte(uint8_t byte);
 static inline void lookup_cvmask_derivatives(uint32_t mask, uint8_t* offx, uint8_t* offy, uint32_t* curpixel_cvg, uint32_t* curpixel_cvbit);
 static inline void z_store(uint32_t zcurpixel, uint32_t z, int dzpixenc);
 static inline uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg);
+static inline uint32_t z_test(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg);
+static int span_z_rejected(int x, int length, int xinc, int z, int dzinc, uint32_t zcurpixel, uint16_t dzpix);
 static inline int finalize_spanalpha(uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg);
 static inline int32_t normalize_dzpix(int32_t sum);
 static inline int32_t CLIP(int32_t value,int32_t min,int32_t max);
@@ -600,7 +612,7 @@ static inline void video_filter32(int* endr, int* endg, int* endb, uint32_t fbof
 static inline void divot_filter(CCVG* final, CCVG centercolor, CCVG leftcolor, CCVG rightcolor);
 static inline void restore_filter16(int* r, int* g, int* b, uint32_t fboffset, uint32_t num, uint32_t hres, uint32_t fetchstate);
 static inline void restore_filter32(int* r, int* g, int* b, uint32_t fboffset, uint32_t num, uint32_t hres, uint32_t fetchstate);
-static inline void gamma_filters(int* r, int* g, int* b, int gamma_and_dither);
+static inline void gamma_filters(int* r, int* g, int* b, int gamma_and_dither, uint32_t* seed);
 static inline void adjust_brightness(int* r, int* g, int* b, int brightcoeff);
 static void clearfb16(uint16_t* fb, uint32_t width,uint32_t height);
 static void tcdiv_persp(int32_t ss, int32_t st, int32_t sw, int32_t* sss, int32_t* sst);
@@ -627,10 +639,10 @@ static void get_dither_noise_complete(int x, int y, int* cdith, int* adith);
 static void get_dither_only(int x, int y, int* cdith, int* adith);
 static void get_dither_nothing(int x, int y, int* cdith, int* adith);
 static inline void vi_vl_lerp(CCVG* up, CCVG down, uint32_t frac);
+static inline int z_correct_clip(int offx, int offy, int sz, uint32_t curpixel_cvg);
 static inline void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, int a, int* z, uint32_t curpixel_cvg);
 static inline void vi_fetch_filter16(CCVG* res, uint32_t fboffset, uint32_t cur_x, uint32_t fsaa, uint32_t dither_filter, uint32_t vres, uint32_t fetchstate);
 static inline void vi_fetch_filter32(CCVG* res, uint32_t fboffset, uint32_t cur_x, uint32_t fsaa, uint32_t dither_filter, uint32_t vres, uint32_t fetchstate);
-cen64_cold static uint32_t vi_integer_sqrt(uint32_t a);
 cen64_cold static void deduce_derivatives(void);
 static inline int32_t irand();
 
@@ -640,16 +652,6 @@ static int32_t lod_frac = 0;
 uint32_t DebugMode = 0, DebugMode2 = 0; int32_t DebugMode3 = 0;
 int debugcolor = 0;
 uint8_t hidden_bits[0x400000];
-struct {uint32_t shift; uint32_t add;} z_dec_table[8] = {
-     {6, 0x00000},
-     {5, 0x20000},
-     {4, 0x30000},
-     {3, 0x38000},
-     {2, 0x3c000},
-     {1, 0x3e000},
-     {0, 0x3f000},
-     {0, 0x3f800},
-};
 
 
 static void (*vi_fetch_filter_func[2])(CCVG*, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t) =
@@ -719,23 +721,12 @@ typedef struct{
 	uint8_t yoff;
 } CVtcmaskDERIVATIVE;
 
-uint32_t gamma_table[0x100];
-uint32_t gamma_dither_table[0x4000];
-uint16_t z_com_table[0x40000];
-uint32_t z_complete_dec_table[0x4000];
-uint8_t replicated_rgba[32];
-int vi_restore_table[0x400];
-int32_t maskbits_table[16];
-uint32_t special_9bit_clamptable[512];
-int32_t special_9bit_exttable[512];
+/* Generated at build time by rdp/gentables.c. */
+#include "rdp/tables.h"
+
 int32_t ge_two_table[128];
-int32_t log2table[256];
-int32_t tcdiv_table[0x8000];
-uint8_t bldiv_hwaccurate_table[0x8000];
-uint16_t deltaz_comparator_lut[0x10000];
 int32_t clamp_t_diff[8];
 int32_t clamp_s_diff[8];
-CVtcmaskDERIVATIVE cvarray[0x100];
 
 #define RDRAM_MASK 0x007fffff
 
@@ -789,6 +780,10 @@ int32_t* PreScale;
 uint32_t tvfadeoutstate[625];
 int rdp_pipeline_crashed = 0;
 
+static struct rdp_stats *stats;
+static uint32_t stats_command;
+static struct rdp_frameskip *frameskip;
+
 
 static inline void tcmask(int32_t* S, int32_t* T, int32_t num);
 static inline void tcmask(int32_t* S, int32_t* T, int32_t num)
@@ -1069,6 +1064,8 @@ static inline void tcclamp_cycle_light(int32_t* S, int32_t* T, int32_t maxs, int
 cen64_cold int angrylion_rdp_init(struct cen64_device *device)
 {
   cen64 = device;
+  stats = device->rdp.stats;
+  frameskip = device->rdp.frameskip;
 
 	if (LOG_RDP_EXECUTION)
 		rdp_exec = fopen("rdp_execute.txt", "wt");
@@ -1117,8 +1114,6 @@ cen64_cold int angrylion_rdp_init(struct cen64_device *device)
 	rdp_pipeline_crashed = 0;
 	memset(&onetimewarnings, 0, sizeof(onetimewarnings));
 
-	precalculate_everything();
-
   // TODO: Set limits based on RDRAM size.
 	plim = 0x7fffff;
 	idxlim16 = 0x3fffff;
@@ -1201,6 +1196,290 @@ static inline void vi_fetch_filter32(CCVG* res, uint32_t fboffset, uint32_t cur_
 }
 
 
+/*
+ * Software VI. For each VI line, the frame buffer line(s) it's resampled
+ * from are fetched through the antialiasing/dedithering filters, the
+ * divot filter runs over the result, and then the output pixels are
+ * bilinearly interpolated and gamma corrected. Nothing here writes to
+ * shared state, so several threads may render disjoint VI lines of the
+ * same frame at once.
+ */
+
+#define VI_MAX_LINE 0xa10
+
+typedef struct
+{
+	int32_t line;
+	uint32_t fetchstate;
+	CCVG raw[VI_MAX_LINE];
+	CCVG divot[VI_MAX_LINE];
+} VI_LINE;
+
+static inline uint32_t vi_irand(uint32_t* seed)
+{
+	*seed = *seed * 0x343fd + 0x269ec3;
+	return (*seed >> 16) & 0x7fff;
+}
+
+#ifdef __SSE2__
+static inline __m128i vi_load16_sse2(int64_t idx)
+{
+	__m128i pix = _mm_loadu_si128((const __m128i*) &rdram_16[idx]);
+	return _mm_or_si128(_mm_slli_epi16(pix, 8), _mm_srli_epi16(pix, 8));
+}
+
+static inline void vi_restore16_sse2(__m128i* dr, __m128i* dg, __m128i* db, __m128i r, __m128i g, __m128i b, int64_t idx)
+{
+	const __m128i fives = _mm_set1_epi16(0x1f);
+	__m128i pix = vi_load16_sse2(idx);
+	__m128i nr = _mm_and_si128(_mm_srli_epi16(pix, 11), fives);
+	__m128i ng = _mm_and_si128(_mm_srli_epi16(pix, 6), fives);
+	__m128i nb = _mm_and_si128(_mm_srli_epi16(pix, 1), fives);
+
+	*dr = _mm_sub_epi16(_mm_add_epi16(*dr, _mm_cmpgt_epi16(r, nr)), _mm_cmpgt_epi16(nr, r));
+	*dg = _mm_sub_epi16(_mm_add_epi16(*dg, _mm_cmpgt_epi16(g, ng)), _mm_cmpgt_epi16(ng, g));
+	*db = _mm_sub_epi16(_mm_add_epi16(*db, _mm_cmpgt_epi16(b, nb)), _mm_cmpgt_epi16(nb, b));
+}
+
+/*
+ * Eight 16-bit pixels at a time, as long as they're all fully covered
+ * (so that only the dither filter can apply) and neither they nor their
+ * neighbours are past the end of RDRAM. Returns the first pixel that
+ * wasn't fetched.
+ */
+static int32_t vi_fetch_line16_sse2(CCVG* line, const struct vi_soft_frame* frame, uint32_t pixels, int32_t lo, int32_t hi, uint32_t fetchstate)
+{
+	const __m128i fives = _mm_set1_epi16(0x1f);
+	const __m128i sevens = _mm_set1_epi16(7);
+	const __m128i cvgfull = _mm_set1_epi16(7 << 8);
+	const __m128i zero = _mm_setzero_si128();
+	int64_t up = -(int64_t) frame->fb_width;
+	int64_t down = (fetchstate == 1) ? 0 : frame->fb_width;
+	int64_t first = frame->dither_filter ? up - 1 : 0;
+	int64_t last = frame->dither_filter ? down + 1 : 0;
+	int32_t x;
+
+	for (x = lo; x + 7 <= hi; x += 8)
+	{
+		int64_t idx = (int64_t) (frame->origin >> 1) + pixels + x;
+		__m128i pix, r, g, b, rg, bc;
+		int i;
+
+		if (idx + first < 0 || idx + 7 + last > idxlim16)
+			goto scalar;
+
+		pix = vi_load16_sse2(idx);
+
+		if (frame->fsaa)
+		{
+			__m128i hval = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*) &hidden_bits[idx]), zero);
+			__m128i cvg = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(pix, _mm_set1_epi16(1)), 2), hval);
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(cvg, sevens)) != 0xffff)
+				goto scalar;
+		}
+
+		r = _mm_and_si128(_mm_srli_epi16(pix, 11), fives);
+		g = _mm_and_si128(_mm_srli_epi16(pix, 6), fives);
+		b = _mm_and_si128(_mm_srli_epi16(pix, 1), fives);
+
+		if (frame->dither_filter)
+		{
+			__m128i dr = zero, dg = zero, db = zero;
+
+			vi_restore16_sse2(&dr, &dg, &db, r, g, b, idx + up - 1);
+			vi_restore16_sse2(&dr, &dg, &db, r, g, b, idx + up);
+			vi_restore16_sse2(&dr, &dg, &db, r, g, b, idx + up + 1);
+			vi_restore16_sse2(&dr, &dg, &db, r, g, b, idx + down - 1);
+			vi_restore16_sse2(&dr, &dg, &db, r, g, b, idx + down);
+			vi_restore16_sse2(&dr, &dg, &db, r, g, b, idx + down + 1);
+			vi_restore16_sse2(&dr, &dg, &db, r, g, b, idx - 1);
+			vi_restore16_sse2(&dr, &dg, &db, r, g, b, idx + 1);
+
+			r = _mm_add_epi16(_mm_slli_epi16(r, 3), dr);
+			g = _mm_add_epi16(_mm_slli_epi16(g, 3), dg);
+			b = _mm_add_epi16(_mm_slli_epi16(b, 3), db);
+		}
+		else
+		{
+			r = _mm_slli_epi16(r, 3);
+			g = _mm_slli_epi16(g, 3);
+			b = _mm_slli_epi16(b, 3);
+		}
+
+		rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+		bc = _mm_or_si128(b, cvgfull);
+		_mm_storeu_si128((__m128i*) &line[x], _mm_unpacklo_epi16(rg, bc));
+		_mm_storeu_si128((__m128i*) &line[x + 4], _mm_unpackhi_epi16(rg, bc));
+		continue;
+
+scalar:
+		for (i = 0; i < 8; i++)
+			vi_fetch_filter16(&line[x + i], frame->origin, pixels + x + i, frame->fsaa, frame->dither_filter, frame->vres, fetchstate);
+	}
+
+	return x;
+}
+
+/*
+ * 32-bit pixels only take the fast path when the dither filter is off:
+ * then fully covered pixels are just their colour bytes.
+ */
+static int32_t vi_fetch_line32_sse2(CCVG* line, const struct vi_soft_frame* frame, uint32_t pixels, int32_t lo, int32_t hi, uint32_t fetchstate)
+{
+	const __m128i cvgmask = _mm_set1_epi32(0xe0000000);
+	const __m128i rgbmask = _mm_set1_epi32(0x00ffffff);
+	const __m128i cvgfull = _mm_set1_epi32(0x07000000);
+	int32_t x;
+
+	if (frame->dither_filter)
+		return lo;
+
+	for (x = lo; x + 3 <= hi; x += 4)
+	{
+		int64_t idx = (int64_t) (frame->origin >> 2) + pixels + x;
+		__m128i pix;
+		int i;
+
+		if (idx >= 0 && idx + 3 <= idxlim32)
+		{
+			pix = _mm_loadu_si128((const __m128i*) &rdram[idx]);
+
+			if (!frame->fsaa || _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(pix, cvgmask), cvgmask)) == 0xffff)
+			{
+				_mm_storeu_si128((__m128i*) &line[x], _mm_or_si128(_mm_and_si128(pix, rgbmask), cvgfull));
+				continue;
+			}
+		}
+
+		for (i = 0; i < 4; i++)
+			vi_fetch_filter32(&line[x + i], frame->origin, pixels + x + i, frame->fsaa, frame->dither_filter, frame->vres, fetchstate);
+	}
+
+	return x;
+}
+#endif
+
+static void vi_fetch_line(VI_LINE* dst, const struct vi_soft_frame* frame, int32_t line, uint32_t fetchstate, int32_t lo, int32_t hi)
+{
+	CCVG* raw = dst->raw + 1;
+	uint32_t pixels = line * frame->fb_width;
+	int32_t x = lo;
+
+#ifdef __SSE2__
+	if (frame->type == 2)
+		x = vi_fetch_line16_sse2(raw, frame, pixels, lo, hi, fetchstate);
+	else
+		x = vi_fetch_line32_sse2(raw, frame, pixels, lo, hi, fetchstate);
+#endif
+
+	for (; x <= hi; x++)
+		vi_fetch_filter_func[frame->type & 1](&raw[x], frame->origin, pixels + x, frame->fsaa, frame->dither_filter, frame->vres, fetchstate);
+
+	if (frame->divot)
+	{
+		for (x = lo + 1; x < hi; x++)
+			divot_filter(&dst->divot[x + 1], raw[x], raw[x - 1], raw[x + 1]);
+	}
+
+	dst->line = line;
+	dst->fetchstate = fetchstate;
+}
+
+static const CCVG* vi_get_line(VI_LINE* cache, const CCVG* keep, const struct vi_soft_frame* frame, int32_t line, uint32_t fetchstate, int32_t lo, int32_t hi)
+{
+	VI_LINE* slot;
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		if (cache[i].line == line && cache[i].fetchstate == fetchstate)
+			return (frame->divot ? cache[i].divot : cache[i].raw) + 1;
+	}
+
+	slot = &cache[0];
+	if (keep == cache[0].raw + 1 || keep == cache[0].divot + 1)
+		slot = &cache[1];
+
+	vi_fetch_line(slot, frame, line, fetchstate, lo, hi);
+	return (frame->divot ? slot->divot : slot->raw) + 1;
+}
+
+void angrylion_vi_render(const struct vi_soft_frame* frame, uint8_t* out, size_t pitch, unsigned first, unsigned last)
+{
+	VI_LINE cache[2];
+	int32_t lo = (frame->x_start >> 10) - 1;
+	int32_t hi = ((frame->x_start + (frame->hres - 1) * frame->x_add) >> 10) + 2;
+	uint32_t xfrac0 = (frame->x_start >> 5) & 0x1f;
+	unsigned y, i;
+
+	cache[0].line = cache[1].line = -1;
+
+	for (y = first; y < last; y++)
+	{
+		uint32_t ypos = frame->y_start + y * frame->y_add;
+		uint32_t yfrac = frame->lerp ? (ypos >> 5) & 0x1f : 0;
+		uint32_t fetchstate = (frame->fetch_bug && !yfrac) ? 1 : 0;
+		uint32_t seed = frame->seed + y * 0x9e3779b9;
+		uint32_t x = frame->x_start;
+		const CCVG* cur;
+		const CCVG* next = NULL;
+		uint8_t* dst = out + y * pitch + frame->out_x * 4;
+
+		cur = vi_get_line(cache, NULL, frame, ypos >> 10, fetchstate, lo, hi);
+
+		if (yfrac)
+			next = vi_get_line(cache, cur, frame, (ypos >> 10) + 1, fetchstate, lo, hi);
+
+		i = 0;
+
+#ifdef __SSE2__
+		if (!frame->gamma_and_dither && frame->x_add == 0x400 && !yfrac && !(frame->lerp && xfrac0))
+		{
+			const __m128i alpha = _mm_set1_epi32(0xff000000);
+			const CCVG* src = cur + (x >> 10);
+
+			for (; i + 4 <= frame->hres; i += 4)
+				_mm_storeu_si128((__m128i*) &dst[i * 4], _mm_or_si128(_mm_loadu_si128((const __m128i*) &src[i]), alpha));
+
+			x += i * frame->x_add;
+		}
+#endif
+
+		for (; i < frame->hres; i++, x += frame->x_add)
+		{
+			uint32_t line_x = x >> 10;
+			uint32_t xfrac = frame->lerp ? (x >> 5) & 0x1f : 0;
+			CCVG color = cur[line_x];
+			int r, g, b;
+
+			if (xfrac || yfrac)
+			{
+				CCVG nextcolor = cur[line_x + 1];
+
+				if (yfrac)
+				{
+					vi_vl_lerp(&color, next[line_x], yfrac);
+					vi_vl_lerp(&nextcolor, next[line_x + 1], yfrac);
+				}
+
+				vi_vl_lerp(&color, nextcolor, xfrac);
+			}
+
+			r = color.r;
+			g = color.g;
+			b = color.b;
+			gamma_filters(&r, &g, &b, frame->gamma_and_dither, &seed);
+
+			dst[i * 4 + 0] = r;
+			dst[i * 4 + 1] = g;
+			dst[i * 4 + 2] = b;
+			dst[i * 4 + 3] = 0xff;
+		}
+	}
+}
+
+
 
 static void SET_SUBA_RGB_INPUT(int32_t **input_r, int32_t **input_g, int32_t **input_b, int code)
 {
@@ -1624,187 +1903,6 @@ static inline void combiner_2cycle(int adseed, uint32_t* curpixel_cvg, int32_t*
 		shade_color.a = 0xff;
 }
 
-static void precalculate_everything(void)
-{
-	int i = 0, k = 0, j = 0;
-
-	
-	
-	for (i = 0; i < 256; i++)
-	{
-		gamma_table[i] = vi_integer_sqrt(i << 6);
-		gamma_table[i] <<= 1;
-	}
-	for (i = 0; i < 0x4000; i++)
-	{
-		gamma_dither_table[i] = vi_integer_sqrt(i);
-		gamma_dither_table[i] <<= 1;
-	}
-
-	
-	
-	
-	
-	z_build_com_table();
-
-	
-	
-	uint32_t exponent;
-	uint32_t mantissa;
-	for (i = 0; i < 0x4000; i++)
-	{
-		exponent = (i >> 11) & 7;
-		mantissa = i & 0x7ff;
-		z_complete_dec_table[i] = ((mantissa << z_dec_table[exponent].shift) + z_dec_table[exponent].add) & 0x3ffff;
-	}
-
-	
-	
-	precalc_cvmask_derivatives();
-
-	
-	
-	i = 0;
-	log2table[0] = log2table[1] = 0;
-	for (i = 2; i < 256; i++)
-	{
-		for (k = 7; k > 0; k--)
-		{
-			if((i >> k) & 1)
-			{
-				log2table[i] = k;
-				break;
-			}
-		}
-	}
-
-	
-	
-	
-	for (i = 0; i < 0x400; i++)
-	{
-		if (((i >> 5) & 0x1f) < (i & 0x1f))
-			vi_restore_table[i] = 1;
-		else if (((i >> 5) & 0x1f) > (i & 0x1f))
-			vi_restore_table[i] = -1;
-		else
-			vi_restore_table[i] = 0;
-	}
-
-	
-	
-	for (i = 0; i < 32; i++)
-		replicated_rgba[i] = (i << 3) | ((i >> 2) & 7); 
-
-	
-	
-	maskbits_table[0] = 0x3ff;
-	for (i = 1; i < 16; i++)
-		maskbits_table[i] = ((uint16_t)(0xffff) >> (16 - i)) & 0x3ff;
-	
-
-	
-	
-	for(i = 0; i < 0x200; i++)
-	{
-		switch((i >> 7) & 3)
-		{
-		case 0:
-		case 1:
-			special_9bit_clamptable[i] = i & 0xff;
-			break;
-		case 2:
-			special_9bit_clamptable[i] = 0xff;
-			break;
-		case 3:
-			special_9bit_clamptable[i] = 0;
-			break;
-		}
-	}
-
-	
-	
-	for(i = 0; i < 0x200; i++)
-	{
-		special_9bit_exttable[i] = ((i & 0x180) == 0x180) ? (i | ~0x1ff) : (i & 0x1ff);
-	}
-
-	
-	
-	
-	
-	
-	
-	int temppoint, tempslope; 
-	int normout;
-	int wnorm;
-	int shift, tlu_rcp;
-
-	for (i = 0; i < 0x8000; i++)
-	{
-		for (k = 1; k <= 14 && !((i << k) & 0x8000); k++) 
-			;
-		shift = k - 1;
-		normout = (i << shift) & 0x3fff;
-		wnorm = (normout & 0xff) << 2;
-		normout >>= 8;
-
-		
-		
-		temppoint = norm_point_table[normout];
-		tempslope = norm_slope_table[normout];
-
-		tempslope = (tempslope | ~0x3ff) + 1;
-		
-		tlu_rcp = (((tempslope * wnorm) >> 10) + temppoint) & 0x7fff;
-		
-		tcdiv_table[i] = shift | (tlu_rcp << 4);
-	}
-
-	
-	int d = 0, n = 0, temp = 0, res = 0, invd = 0, nbit = 0;
-	int ps[9];
-
-	for (i = 0; i < 0x8000; i++)
-	{
-		res = 0;
-		d = (i >> 11) & 0xf;
-		n = i & 0x7ff;
-		invd = (~d) & 0xf;
-		
-
-		temp = invd + (n >> 8) + 1;
-		ps[0] = temp & 7;
-		for (k = 0; k < 8; k++)
-		{
-			nbit = (n >> (7 - k)) & 1;
-			if (res & (0x100 >> k))
-				temp = invd + (ps[k] << 1) + nbit + 1;
-			else
-				temp = d + (ps[k] << 1) + nbit;
-			ps[k + 1] = temp & 7;
-			if (temp & 0x10)
-				res |= (1 << (7 - k));
-		}
-		bldiv_hwaccurate_table[i] = res;
-	}
-
-
-	deltaz_comparator_lut[0] = 0;
-	for (i = 1; i < 0x10000; i++)
-	{
-		for (k = 15; k >= 0; k--)
-		{
-			if (i & (1 << k))
-			{
-				deltaz_comparator_lut[i] = 1 << k;
-				break;
-			}
-		}
-	}
-
-}
-
 static void SET_BLENDER_INPUT(int cycle, int which, int32_t **input_r, int32_t **input_g, int32_t **input_b, int32_t **input_a, int a, int b)
 {
 
@@ -1923,6 +2021,9 @@ static inline int blender_1cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int d
 					
 
 					blender_equation_cycle0(&r, &g, &b);
+
+					if (unlikely(stats != NULL))
+						stats->total.blends++;
 				}
 			}
 			else
@@ -1938,11 +2039,12 @@ static inline int blender_1cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int d
 			*fb = b;
 			return 1;
 		}
-		else 
-			return 0;
-		}
-	else 
-		return 0;
+	}
+
+	if (unlikely(stats != NULL))
+		stats->total.cvg_rejects++;
+
+	return 0;
 }
 
 static inline int blender_2cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int dith, uint32_t blend_en, uint32_t prewrap, uint32_t curpixel_cvg, uint32_t curpixel_cvbit, int32_t acalpha)
@@ -1980,6 +2082,9 @@ static inline int blender_2cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int d
 				{
 					inv_pixel_color.a =  (~(*blender1b_a[1])) & 0xff;
 					blender_equation_cycle1(&r, &g, &b);
+
+					if (unlikely(stats != NULL))
+						stats->total.blends++;
 				}
 			}
 			else
@@ -1996,17 +2101,14 @@ static inline int blender_2cycle(uint32_t* fr, uint32_t* fg, uint32_t* fb, int d
 			*fb = b;
 			return 1;
 		}
-		else
-		{
-			memory_color = pre_memory_color;
-			return 0;
-                }
-	}
-	else
-	{
-		memory_color = pre_memory_color;
-		return 0;
 	}
+
+	memory_color = pre_memory_color;
+
+	if (unlikely(stats != NULL))
+		stats->total.cvg_rejects++;
+
+	return 0;
 }
 
 
@@ -3894,6 +3996,9 @@ static inline void texture_pipeline_cycle(COLOR* TEX, COLOR* prev, int32_t SSS,
 	sss1 = SSS;
 	sst1 = SST;
 
+	if (unlikely(stats != NULL))
+		stats->total.texels += other_modes.sample_type ? 4 : 1;
+
 	tcshift_cycle(&sss1, &sst1, &maxs, &maxt, tilenum);
 
 	sss1 = TRELATIVE(sss1, tile[tilenum].sl);
@@ -4194,6 +4299,10 @@ void render_spans_1cycle_complete(int start, int end, int tilenum, int flip)
 	int x, length, scdiff, lodlength;
 	uint32_t fir, fig, fib;
 					
+	int lastspan = end;
+	while (lastspan > start && !span[lastspan].validline)
+		lastspan--;
+
 	for (i = start; i <= end; i++)
 	{
 		if (span[i].validline)
@@ -4219,13 +4328,13 @@ void render_spans_1cycle_complete(int start, int end, int tilenum, int flip)
 		{
 			length = xendsc - xstart;
 			scdiff = xend - xendsc;
-			compute_cvg_noflip(i);
+			compute_cvg(i, 0);
 		}
 		else
 		{
 			length = xstart - xendsc;
 			scdiff = xendsc - xend;
-			compute_cvg_flip(i);
+			compute_cvg(i, 1);
 		}
 
 
@@ -4253,6 +4362,12 @@ void render_spans_1cycle_complete(int start, int end, int tilenum, int flip)
 
 		sigs.startspan = 1;
 
+		if (other_modes.f.earlyzreject && i != lastspan && span_z_rejected(x, length, xinc, z, dzinc, zbcur, dzpix))
+		{
+			fbread1_ptr(curpixel + xinc * length, &curpixel_memcvg);
+			continue;
+		}
+
 		for (j = 0; j <= length; j++)
 		{
 			sr = r >> 14;
@@ -4403,6 +4518,10 @@ void render_spans_1cycle_notexel1(int start, int end, int tilenum, int flip)
 	int x, length, scdiff, lodlength;
 	uint32_t fir, fig, fib;
 					
+	int lastspan = end;
+	while (lastspan > start && !span[lastspan].validline)
+		lastspan--;
+
 	for (i = start; i <= end; i++)
 	{
 		if (span[i].validline)
@@ -4428,13 +4547,13 @@ void render_spans_1cycle_notexel1(int start, int end, int tilenum, int flip)
 		{
 			length = xendsc - xstart;
 			scdiff = xend - xendsc;
-			compute_cvg_noflip(i);
+			compute_cvg(i, 0);
 		}
 		else
 		{
 			length = xstart - xendsc;
 			scdiff = xendsc - xend;
-			compute_cvg_flip(i);
+			compute_cvg(i, 1);
 		}
 
 
@@ -4457,6 +4576,12 @@ void render_spans_1cycle_notexel1(int start, int end, int tilenum, int flip)
 		sigs.longspan = (lodlength > 7);
 		sigs.midspan = (lodlength == 7);
 
+		if (other_modes.f.earlyzreject && i != lastspan && span_z_rejected(x, length, xinc, z, dzinc, zbcur, dzpix))
+		{
+			fbread1_ptr(curpixel + xinc * length, &curpixel_memcvg);
+			continue;
+		}
+
 		for (j = 0; j <= length; j++)
 		{
 			sr = r >> 14;
@@ -4564,6 +4689,10 @@ void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
 	int x, length, scdiff;
 	uint32_t fir, fig, fib;
 					
+	int lastspan = end;
+	while (lastspan > start && !span[lastspan].validline)
+		lastspan--;
+
 	for (i = start; i <= end; i++)
 	{
 		if (span[i].validline)
@@ -4586,13 +4715,13 @@ void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
 		{
 			length = xendsc - xstart;
 			scdiff = xend - xendsc;
-			compute_cvg_noflip(i);
+			compute_cvg(i, 0);
 		}
 		else
 		{
 			length = xstart - xendsc;
 			scdiff = xendsc - xend;
-			compute_cvg_flip(i);
+			compute_cvg(i, 1);
 		}
 
 		if (scdiff)
@@ -4606,6 +4735,12 @@ void render_spans_1cycle_notex(int start, int end, int tilenum, int flip)
 			z += (dzinc * scdiff);
 		}
 
+		if (other_modes.f.earlyzreject && i != lastspan && span_z_rejected(x, length, xinc, z, dzinc, zbcur, dzpix))
+		{
+			fbread1_ptr(curpixel + xinc * length, &curpixel_memcvg);
+			continue;
+		}
+
 		for (j = 0; j <= length; j++)
 		{
 			sr = r >> 14;
@@ -4716,6 +4851,10 @@ void render_spans_2cycle_complete(int start, int end, int tilenum, int flip)
 	int x, length, scdiff;
 	uint32_t fir, fig, fib;
 				
+	int lastspan = end;
+	while (lastspan > start && !span[lastspan].validline)
+		lastspan--;
+
 	for (i = start; i <= end; i++)
 	{
 		if (span[i].validline)
@@ -4741,13 +4880,13 @@ void render_spans_2cycle_complete(int start, int end, int tilenum, int flip)
 		{
 			length = xendsc - xstart;
 			scdiff = xend - xendsc;
-			compute_cvg_noflip(i);
+			compute_cvg(i, 0);
 		}
 		else
 		{
 			length = xstart - xendsc;
 			scdiff = xendsc - xend;
-			compute_cvg_flip(i);
+			compute_cvg(i, 1);
 		}
 
 		
@@ -4773,6 +4912,13 @@ void render_spans_2cycle_complete(int start, int end, int tilenum, int flip)
 		}
 		sigs.startspan = 1;
 
+		if (other_modes.f.earlyzreject && i != lastspan && span_z_rejected(x, length, xinc, z, dzinc, zbcur, dzpix))
+		{
+			fbread2_ptr(curpixel + xinc * length, &curpixel_memcvg);
+			memory_color = pre_memory_color;
+			continue;
+		}
+
 		for (j = 0; j <= length; j++)
 		{
 			sr = r >> 14;
@@ -4925,6 +5071,10 @@ void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int flip)
 	int x, length, scdiff;
 	uint32_t fir, fig, fib;
 				
+	int lastspan = end;
+	while (lastspan > start && !span[lastspan].validline)
+		lastspan--;
+
 	for (i = start; i <= end; i++)
 	{
 		if (span[i].validline)
@@ -4950,13 +5100,13 @@ void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int flip)
 		{
 			length = xendsc - xstart;
 			scdiff = xend - xendsc;
-			compute_cvg_noflip(i);
+			compute_cvg(i, 0);
 		}
 		else
 		{
 			length = xstart - xendsc;
 			scdiff = xendsc - xend;
-			compute_cvg_flip(i);
+			compute_cvg(i, 1);
 		}
 
 		if (scdiff)
@@ -4973,6 +5123,13 @@ void render_spans_2cycle_notexelnext(int start, int end, int tilenum, int flip)
 			w += (dwinc * scdiff);
 		}
 
+		if (other_modes.f.earlyzreject && i != lastspan && span_z_rejected(x, length, xinc, z, dzinc, zbcur, dzpix))
+		{
+			fbread2_ptr(curpixel + xinc * length, &curpixel_memcvg);
+			memory_color = pre_memory_color;
+			continue;
+		}
+
 		for (j = 0; j <= length; j++)
 		{
 			sr = r >> 14;
@@ -5093,6 +5250,10 @@ void render_spans_2cycle_notexel1(int start, int end, int tilenum, int flip)
 	int x, length, scdiff;
 	uint32_t fir, fig, fib;
 				
+	int lastspan = end;
+	while (lastspan > start && !span[lastspan].validline)
+		lastspan--;
+
 	for (i = start; i <= end; i++)
 	{
 		if (span[i].validline)
@@ -5118,13 +5279,13 @@ void render_spans_2cycle_notexel1(int start, int end, int tilenum, int flip)
 		{
 			length = xendsc - xstart;
 			scdiff = xend - xendsc;
-			compute_cvg_noflip(i);
+			compute_cvg(i, 0);
 		}
 		else
 		{
 			length = xstart - xendsc;
 			scdiff = xendsc - xend;
-			compute_cvg_flip(i);
+			compute_cvg(i, 1);
 		}
 
 		if (scdiff)
@@ -5141,6 +5302,13 @@ void render_spans_2cycle_notexel1(int start, int end, int tilenum, int flip)
 			w += (dwinc * scdiff);
 		}
 
+		if (other_modes.f.earlyzreject && i != lastspan && span_z_rejected(x, length, xinc, z, dzinc, zbcur, dzpix))
+		{
+			fbread2_ptr(curpixel + xinc * length, &curpixel_memcvg);
+			memory_color = pre_memory_color;
+			continue;
+		}
+
 		for (j = 0; j <= length; j++)
 		{
 			sr = r >> 14;
@@ -5249,6 +5417,10 @@ void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
 	int x, length, scdiff;
 	uint32_t fir, fig, fib;
 				
+	int lastspan = end;
+	while (lastspan > start && !span[lastspan].validline)
+		lastspan--;
+
 	for (i = start; i <= end; i++)
 	{
 		if (span[i].validline)
@@ -5271,13 +5443,13 @@ void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
 		{
 			length = xendsc - xstart;
 			scdiff = xend - xendsc;
-			compute_cvg_noflip(i);
+			compute_cvg(i, 0);
 		}
 		else
 		{
 			length = xstart - xendsc;
 			scdiff = xendsc - xend;
-			compute_cvg_flip(i);
+			compute_cvg(i, 1);
 		}
 
 		if (scdiff)
@@ -5291,6 +5463,13 @@ void render_spans_2cycle_notex(int start, int end, int tilenum, int flip)
 			z += (dzinc * scdiff);
 		}
 
+		if (other_modes.f.earlyzreject && i != lastspan && span_z_rejected(x, length, xinc, z, dzinc, zbcur, dzpix))
+		{
+			fbread2_ptr(curpixel + xinc * length, &curpixel_memcvg);
+			memory_color = pre_memory_color;
+			continue;
+		}
+
 		for (j = 0; j <= length; j++)
 		{
 			sr = r >> 14;
@@ -5381,11 +5560,19 @@ void render_spans_fill(int start, int end, int flip)
 			
 			
 			
-			for (j = 0; j <= length; j++)
+			if (fb_size != PIXEL_SIZE_8BIT)
+			{
+				if (length >= 0)
+					fbfill_span(flip ? curpixel : curpixel - length, length + 1);
+			}
+			else
 			{
-				fbfill_ptr(curpixel);
-				x += xinc;
-				curpixel += xinc;
+				for (j = 0; j <= length; j++)
+				{
+					fbfill_ptr(curpixel);
+					x += xinc;
+					curpixel += xinc;
+				}
 			}
 
 			if (unlikely(slowkillbits && length >= 0))
@@ -5532,18 +5719,26 @@ void render_spans_copy(int start, int end, int tilenum, int flip)
 			
 			if (copywmask > 8) 
 				copywmask = 8;
-			tempdword = fbptr;
-			k = 7;
-			while(copywmask > 0)
+
+			if (flip && copywmask == 8 && alphamask == 0xff && (fbptr & RDRAM_MASK) + 7 <= plim)
 			{
-				tempbyte = (uint32_t)((copyqword >> (k << 3)) & 0xff);
-				if (alphamask & (1 << k))
+				fbwrite_copy_qword(fbptr & RDRAM_MASK, copyqword);
+			}
+			else
+			{
+				tempdword = fbptr;
+				k = 7;
+				while(copywmask > 0)
 				{
-					PAIRWRITE8(tempdword, tempbyte, (tempbyte & 1) ? 3 : 0);
+					tempbyte = (uint32_t)((copyqword >> (k << 3)) & 0xff);
+					if (alphamask & (1 << k))
+					{
+						PAIRWRITE8(tempdword, tempbyte, (tempbyte & 1) ? 3 : 0);
+					}
+					k--;
+					tempdword += xinc;
+					copywmask--;
 				}
-				k--;
-				tempdword += xinc;
-				copywmask--;
 			}
 			
 			s += dsinc;
@@ -5809,6 +6004,56 @@ void loading_pipeline(int start, int end, int tilenum, int coord_quad, int ltlut
 	}
 }
 
+/*
+ * Flags the scanlines of the color (and Z) image that a primitive can
+ * touch, so that the VI only has to pick up what changed in RDRAM. The
+ * capture's bit is left clear: a replay makes these writes itself.
+ */
+static void mark_spans_dirty(int start, int end)
+{
+	uint32_t pitch = (fb_width << fb_size) >> 1;
+	uint32_t width = (clip.xl >> 2) + 1;
+
+	if (start > end)
+		return;
+
+	/*
+	 * Rows are fb_width pixels apart, but the scissor can be wider
+	 * than that; the last row then runs on to the scissor's edge.
+	 */
+	if (width < (uint32_t) fb_width)
+		width = fb_width;
+
+	ri_mark_dirty_bits(&cen64->ri, fb_address + start * pitch, (end - start) * pitch + ((width << fb_size) >> 1), (uint8_t) ~RDP_CAPTURE_DIRTY_BIT);
+
+	if (other_modes.z_update_en)
+		ri_mark_dirty_bits(&cen64->ri, zb_address + start * fb_width * 2, ((end - start) * fb_width + width) * 2, (uint8_t) ~RDP_CAPTURE_DIRTY_BIT);
+}
+
+static void count_span_pixels(int start, int end, int flip)
+{
+	uint64_t pixels = 0;
+	int i, length;
+
+	for (i = start; i <= end; i++)
+	{
+		if (!span[i].validline)
+			continue;
+
+		length = flip ? (span[i].lx - span[i].rx) : (span[i].rx - span[i].lx);
+
+		if (length >= 0)
+			pixels += length + 1;
+	}
+
+	stats->total.command_pixels[stats_command] += pixels;
+	stats->total.cycle_pixels[other_modes.cycle_type] += pixels;
+
+	/* copy mode moves one texel per pixel. */
+	if (other_modes.cycle_type == CYCLE_TYPE_COPY)
+		stats->total.texels += pixels;
+}
+
 static void edgewalker_for_prims(int32_t* ewdata)
 {
 	int j = 0;
@@ -6254,6 +6499,11 @@ static void edgewalker_for_prims(int32_t* ewdata)
 	
 	
 
+	mark_spans_dirty(yhlimit >> 2, yllimit >> 2);
+
+	if (unlikely(stats != NULL))
+		count_span_pixels(yhlimit >> 2, yllimit >> 2, flip);
+
 	switch(other_modes.cycle_type)
 	{
 		case CYCLE_TYPE_1: render_spans_1cycle_ptr(yhlimit >> 2, yllimit >> 2, tilenum, flip); break;
@@ -6522,15 +6772,15 @@ static int rdp_dasm(char *buffer)
 	uint32_t length;
 	uint32_t command;
 
-	length = rdp_cmd_ptr * 4;
+	length = rdp_command_length[(RDP_CMD_WORD(0) >> 24) & 0x3f];
 	if (length < 8)
 	{
 		sprintf(buffer, "ERROR: length = %d\n", length);
 		return 0;
 	}
 
-	cmd[0] = rdp_cmd_data[rdp_cmd_cur+0];
-	cmd[1] = rdp_cmd_data[rdp_cmd_cur+1];
+	cmd[0] = RDP_CMD_WORD(0);
+	cmd[1] = RDP_CMD_WORD(1);
 
 	tile = (cmd[1] >> 24) & 0x7;
 	sprintf(sl, "%4.2f", (float)((cmd[0] >> 12) & 0xfff) / 4.0f);
@@ -6577,12 +6827,12 @@ static int rdp_dasm(char *buffer)
 				return 0;
 			}
 
-			cmd[2] = rdp_cmd_data[rdp_cmd_cur+2];
-			cmd[3] = rdp_cmd_data[rdp_cmd_cur+3];
-			cmd[4] = rdp_cmd_data[rdp_cmd_cur+4];
-			cmd[5] = rdp_cmd_data[rdp_cmd_cur+5];
-			cmd[6] = rdp_cmd_data[rdp_cmd_cur+6];
-			cmd[7] = rdp_cmd_data[rdp_cmd_cur+7];
+			cmd[2] = RDP_CMD_WORD(2);
+			cmd[3] = RDP_CMD_WORD(3);
+			cmd[4] = RDP_CMD_WORD(4);
+			cmd[5] = RDP_CMD_WORD(5);
+			cmd[6] = RDP_CMD_WORD(6);
+			cmd[7] = RDP_CMD_WORD(7);
 
 			sprintf(yl,		"%4.4f", (float)((cmd[0] >>  0) & 0x1fff) / 4.0f);
 			sprintf(ym,		"%4.4f", (float)((cmd[1] >> 16) & 0x1fff) / 4.0f);
@@ -6609,7 +6859,7 @@ static int rdp_dasm(char *buffer)
 
 			for (i=2; i < 24; i++)
 			{
-				cmd[i] = rdp_cmd_data[rdp_cmd_cur+i];
+				cmd[i] = RDP_CMD_WORD(i);
 			}
 
 			sprintf(yl,		"%4.4f", (float)((cmd[0] >>  0) & 0x1fff) / 4.0f);
@@ -6659,7 +6909,7 @@ static int rdp_dasm(char *buffer)
 
 			for (i=2; i < 24; i++)
 			{
-				cmd[i] = rdp_cmd_data[i];
+				cmd[i] = RDP_CMD_WORD(i);
 			}
 
 			sprintf(yl,		"%4.4f", (float)((cmd[0] >>  0) & 0x1fff) / 4.0f);
@@ -6711,7 +6961,7 @@ static int rdp_dasm(char *buffer)
 
 			for (i=2; i < 40; i++)
 			{
-				cmd[i] = rdp_cmd_data[rdp_cmd_cur+i];
+				cmd[i] = RDP_CMD_WORD(i);
 			}
 
 			sprintf(yl,		"%4.4f", (float)((cmd[0] >>  0) & 0x1fff) / 4.0f);
@@ -6783,8 +7033,8 @@ static int rdp_dasm(char *buffer)
 				sprintf(buffer, "ERROR: Texture_Rectangle length = %d\n", length);
 				return 0;
 			}
-			cmd[2] = rdp_cmd_data[rdp_cmd_cur+2];
-			cmd[3] = rdp_cmd_data[rdp_cmd_cur+3];
+			cmd[2] = RDP_CMD_WORD(2);
+			cmd[3] = RDP_CMD_WORD(3);
 			sprintf(s,    "%4.4f", (float)(int16_t)((cmd[2] >> 16) & 0xffff) / 32.0f);
 			sprintf(t,    "%4.4f", (float)(int16_t)((cmd[2] >>  0) & 0xffff) / 32.0f);
 			sprintf(dsdx, "%4.4f", (float)(int16_t)((cmd[3] >> 16) & 0xffff) / 1024.0f);
@@ -6842,10 +7092,17 @@ static void rdp_noop(uint32_t w1, uint32_t w2)
 {
 }
 
+static inline void rdp_cmd_copy(int32_t *dst, int first, int count)
+{
+	int i;
+	for (i = 0; i < count; i++)
+		dst[i] = RDP_CMD_WORD(first + i);
+}
+
 static void rdp_tri_noshade(uint32_t w1, uint32_t w2)
 {
 	int32_t ewdata[44];
-	memcpy(&ewdata[0], &rdp_cmd_data[rdp_cmd_cur], 8 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[0], 0, 8);
 	memset(&ewdata[8], 0, 36 * sizeof(int32_t));
 	edgewalker_for_prims(ewdata);
 }
@@ -6853,18 +7110,18 @@ static void rdp_tri_noshade(uint32_t w1, uint32_t w2)
 static void rdp_tri_noshade_z(uint32_t w1, uint32_t w2)
 {
 	int32_t ewdata[44];
-	memcpy(&ewdata[0], &rdp_cmd_data[rdp_cmd_cur], 8 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[0], 0, 8);
 	memset(&ewdata[8], 0, 32 * sizeof(int32_t));
-	memcpy(&ewdata[40], &rdp_cmd_data[rdp_cmd_cur + 8], 4 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[40], 8, 4);
 	edgewalker_for_prims(ewdata);
 }
 
 static void rdp_tri_tex(uint32_t w1, uint32_t w2)
 {
 	int32_t ewdata[44];
-	memcpy(&ewdata[0], &rdp_cmd_data[rdp_cmd_cur], 8 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[0], 0, 8);
 	memset(&ewdata[8], 0, 16 * sizeof(int32_t));
-	memcpy(&ewdata[24], &rdp_cmd_data[rdp_cmd_cur + 8], 16 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[24], 8, 16);
 	memset(&ewdata[40], 0, 4 * sizeof(int32_t));
 	edgewalker_for_prims(ewdata);
 }
@@ -6872,17 +7129,17 @@ static void rdp_tri_tex(uint32_t w1, uint32_t w2)
 static void rdp_tri_tex_z(uint32_t w1, uint32_t w2)
 {
 	int32_t ewdata[44];
-	memcpy(&ewdata[0], &rdp_cmd_data[rdp_cmd_cur], 8 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[0], 0, 8);
 	memset(&ewdata[8], 0, 16 * sizeof(int32_t));
-	memcpy(&ewdata[24], &rdp_cmd_data[rdp_cmd_cur + 8], 16 * sizeof(int32_t));
-	memcpy(&ewdata[40], &rdp_cmd_data[rdp_cmd_cur + 24], 4 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[24], 8, 16);
+	rdp_cmd_copy(&ewdata[40], 24, 4);
 	edgewalker_for_prims(ewdata);
 }
 
 static void rdp_tri_shade(uint32_t w1, uint32_t w2)
 {
 	int32_t ewdata[44];
-	memcpy(&ewdata[0], &rdp_cmd_data[rdp_cmd_cur], 24 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[0], 0, 24);
 	memset(&ewdata[24], 0, 20 * sizeof(int32_t));
 	edgewalker_for_prims(ewdata);
 }
@@ -6890,16 +7147,16 @@ static void rdp_tri_shade(uint32_t w1, uint32_t w2)
 static void rdp_tri_shade_z(uint32_t w1, uint32_t w2)
 {
 	int32_t ewdata[44];
-	memcpy(&ewdata[0], &rdp_cmd_data[rdp_cmd_cur], 24 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[0], 0, 24);
 	memset(&ewdata[24], 0, 16 * sizeof(int32_t));
-	memcpy(&ewdata[40], &rdp_cmd_data[rdp_cmd_cur + 24], 4 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[40], 24, 4);
 	edgewalker_for_prims(ewdata);
 }
 
 static void rdp_tri_texshade(uint32_t w1, uint32_t w2)
 {
 	int32_t ewdata[44];
-	memcpy(&ewdata[0], &rdp_cmd_data[rdp_cmd_cur], 40 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[0], 0, 40);
 	memset(&ewdata[40], 0, 4 * sizeof(int32_t));
 	edgewalker_for_prims(ewdata);
 }
@@ -6907,14 +7164,14 @@ static void rdp_tri_texshade(uint32_t w1, uint32_t w2)
 static void rdp_tri_texshade_z(uint32_t w1, uint32_t w2)
 {
 	int32_t ewdata[44];
-	memcpy(&ewdata[0], &rdp_cmd_data[rdp_cmd_cur], 44 * sizeof(int32_t));
+	rdp_cmd_copy(&ewdata[0], 0, 44);
 	edgewalker_for_prims(ewdata);
 }
 
 static void rdp_tex_rect(uint32_t w1, uint32_t w2)
 {
-	uint32_t w3 = rdp_cmd_data[rdp_cmd_cur + 2];
-	uint32_t w4 = rdp_cmd_data[rdp_cmd_cur + 3];
+	uint32_t w3 = RDP_CMD_WORD(2);
+	uint32_t w4 = RDP_CMD_WORD(3);
 
 	
 	uint32_t tilenum	= (w2 >> 24) & 0x7;
@@ -6973,8 +7230,8 @@ static void rdp_tex_rect(uint32_t w1, uint32_t w2)
 
 static void rdp_tex_rect_flip(uint32_t w1, uint32_t w2)
 {
-	uint32_t w3 = rdp_cmd_data[rdp_cmd_cur+2];
-	uint32_t w4 = rdp_cmd_data[rdp_cmd_cur+3];
+	uint32_t w3 = RDP_CMD_WORD(2);
+	uint32_t w4 = RDP_CMD_WORD(3);
 	
 	
 	uint32_t tilenum	= (w2 >> 24) & 0x7;
@@ -7074,6 +7331,9 @@ static void rdp_sync_full(uint32_t w1, uint32_t w2)
 
 	z64gl_command = 0;
 
+	if (unlikely(stats != NULL))
+		rdp_stats_sync_full(stats);
+
   signal_rcp_interrupt(cen64->bus.vr4300, MI_INTR_DP);
 }
 
@@ -7265,6 +7525,27 @@ void deduce_derivatives()
 		get_dither_noise_ptr = get_dither_noise_func[2];
 
 	other_modes.f.dolod = other_modes.tex_lod_en || lodfracused;
+
+	/* A span whose pixels all fail the depth test only leaves state behind
+	   for the next one. Spans restart texturing, so as long as nothing
+	   draws from irand() or reads the previous pixel's combined color, the
+	   renderers can skip them (see span_z_rejected). The last span is always
+	   drawn, so later primitives see the same leftovers either way. */
+	int combined_used = 0;
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (combiner_rgbsub_a_r[i] == &combined_color.r || combiner_rgbsub_a_r[i] == &combined_color.a || \
+			combiner_rgbsub_b_r[i] == &combined_color.r || combiner_rgbsub_b_r[i] == &combined_color.a || \
+			combiner_rgbmul_r[i] == &combined_color.r || combiner_rgbmul_r[i] == &combined_color.a || \
+			combiner_rgbadd_r[i] == &combined_color.r || combiner_rgbadd_r[i] == &combined_color.a || \
+			combiner_alphasub_a[i] == &combined_color.a || combiner_alphasub_b[i] == &combined_color.a || \
+			combiner_alphamul[i] == &combined_color.a || combiner_alphaadd[i] == &combined_color.a)
+			combined_used = 1;
+	}
+
+	other_modes.f.earlyzreject = other_modes.z_compare_en && !combined_used && \
+		get_dither_noise_ptr != get_dither_noise_func[0] && other_modes.rgb_dither_sel != 2;
 }
 
 static inline int32_t irand()
@@ -7545,11 +7826,97 @@ static void (*const rdp_command_table[64])(uint32_t w1, uint32_t w2) =
 	rdp_set_combine,	rdp_set_texture_image,	rdp_set_mask_image,		rdp_set_color_image
 };
 
+void rdp_get_color_image(uint32_t *address, uint32_t *length)
+{
+	uint32_t height = (clip.yl + 3) >> 2;
+
+	*address = fb_address & RDRAM_MASK;
+	*length = PIXELS_TO_BYTES(fb_width * height, fb_size);
+
+	if (*length > RDRAM_MASK + 1 - *address)
+		*length = RDRAM_MASK + 1 - *address;
+}
+
+/* returns nonzero if the current command can be left out because it draws
+   into a frame that won't be looked at; notes textures loaded from frame
+   buffers. see rdp/frameskip.c. */
+static inline int rdp_frameskip_filter(uint32_t cmd)
+{
+	uint32_t w1 = RDP_CMD_WORD(0), w2 = RDP_CMD_WORD(1);
+	uint32_t address, length, sl, tl, sh, th;
+
+	switch (cmd)
+	{
+		case 0x08: case 0x09: case 0x0a: case 0x0b:
+		case 0x0c: case 0x0d: case 0x0e: case 0x0f:
+		case 0x24: case 0x25: case 0x36:
+			rdp_get_color_image(&address, &length);
+			return rdp_frameskip_draw(frameskip, address, length);
+
+		case 0x30: case 0x34:
+			tl = (w1 >> 2) & 0x3ff;
+			th = (w2 >> 2) & 0x3ff;
+			address = ti_address + PIXELS_TO_BYTES(tl * ti_width, ti_size);
+			length = PIXELS_TO_BYTES(((th >= tl ? th - tl : 0) + 1) * ti_width, ti_size);
+			rdp_frameskip_load(frameskip, address & RDRAM_MASK, length);
+			break;
+
+		case 0x33:
+			sl = (w1 >> 12) & 0xfff;
+			tl = w1 & 0xfff;
+			sh = (w2 >> 12) & 0xfff;
+			address = ti_address + PIXELS_TO_BYTES(tl * ti_width + sl, ti_size);
+			length = PIXELS_TO_BYTES((sh >= sl ? sh - sl : 0) + 1, ti_size);
+			rdp_frameskip_load(frameskip, address & RDRAM_MASK, length);
+			break;
+	}
+
+	return 0;
+}
+
+/* returns where the next count words of the list sit, if they are contiguous
+   and can be parsed in place. */
+static inline const uint32_t *rdp_cmd_in_place(uint32_t idx, uint32_t count)
+{
+	if (dp_status & DP_STATUS_XBUS_DMA)
+	{
+		idx &= 0x3ff;
+		return (idx + count <= 0x400) ? &rsp_dmem[idx] : NULL;
+	}
+
+	idx &= (RDRAM_MASK >> 2);
+	return (idx + count <= idxlim32 + 1) ? &rdram[idx] : NULL;
+}
+
+/* appends the next count words of the list to rdp_cmd_data. */
+static void rdp_cmd_gather(uint32_t *dp_current_al, uint32_t count)
+{
+	uint32_t idx = *dp_current_al;
+	uint32_t i;
+
+	if (dp_status & DP_STATUS_XBUS_DMA)
+	{
+		for (i = 0; i < count; i++, idx++)
+			rdp_cmd_data[rdp_cmd_ptr++] = rsp_dmem[idx & 0x3ff];
+	}
+	else
+	{
+		for (i = 0; i < count; i++, idx++)
+		{
+			idx &= (RDRAM_MASK >> 2);
+			rdp_cmd_data[rdp_cmd_ptr++] = (idx <= idxlim32) ? rdram[idx] : 0;
+		}
+	}
+
+	*dp_current_al = idx;
+}
+
 void rdp_process_list(void)
 {
-	int i, length;
-	uint32_t cmd, cmd_length;
+	uint32_t cmd, cmd_length, toload;
 	uint32_t dp_current_al = dp_current & ~7, dp_end_al = dp_end & ~7; 
+	struct rdp_capture *capture = cen64->rdp.capture;
+	const uint32_t *words;
 
 	dp_status &= ~DP_STATUS_FREEZE;
 	
@@ -7570,68 +7937,64 @@ void rdp_process_list(void)
 		return;
 	}
 
-	length = (dp_end_al - dp_current_al) >> 2;
+	uint32_t remaining_length = (dp_end_al - dp_current_al) >> 2;
 
-	ptr_onstart = rdp_cmd_ptr;
-
-
-
-	uint32_t remaining_length = length;
+	if (unlikely(capture != NULL))
+		rdp_capture_begin(capture, &cen64->ri);
 
 
 	dp_current_al >>= 2;
 
-	while (remaining_length)
+	while (remaining_length && !rdp_pipeline_crashed)
 	{
+		rdp_cmd_words = NULL;
 
-	int toload = remaining_length > 0x10000 ? 0x10000 : remaining_length;
-
-
-	if (dp_status & DP_STATUS_XBUS_DMA)
-	{
-		for (i = 0; i < toload; i ++)
-		{
-			rdp_cmd_data[rdp_cmd_ptr] = byteswap_32(rsp_dmem[dp_current_al & 0x3ff]);
-			rdp_cmd_ptr++;
-			dp_current_al++;
-		}
-	}
-	else
-	{
-		for (i = 0; i < toload; i ++)
+		if (!rdp_cmd_ptr && (words = rdp_cmd_in_place(dp_current_al, 1)) != NULL)
 		{
-			RREADIDX32(rdp_cmd_data[rdp_cmd_ptr], dp_current_al);
-			rdp_cmd_ptr++;
-			dp_current_al++;
-		}
-	}
-
-	remaining_length -= toload;
+			cmd_length = rdp_command_length[(byteswap_32(words[0]) >> 24) & 0x3f] >> 2;
 
-	while (rdp_cmd_cur < rdp_cmd_ptr && !rdp_pipeline_crashed)
-	{
-		cmd = (rdp_cmd_data[rdp_cmd_cur] >> 24) & 0x3f;
-		cmd_length = rdp_command_length[cmd] >> 2;
+			if (cmd_length <= remaining_length && rdp_cmd_in_place(dp_current_al, cmd_length))
+			{
+				rdp_cmd_words = words;
+				dp_current_al += cmd_length;
+				remaining_length -= cmd_length;
+			}
+		}
 
 		
 		
-		if ((rdp_cmd_ptr - rdp_cmd_cur) < cmd_length)
+		if (!rdp_cmd_words)
 		{
+			if (!rdp_cmd_ptr)
+			{
+				rdp_cmd_gather(&dp_current_al, 1);
+				remaining_length--;
+			}
+
+			cmd_length = rdp_command_length[(byteswap_32(rdp_cmd_data[0]) >> 24) & 0x3f] >> 2;
+			toload = cmd_length - rdp_cmd_ptr;
+			if (toload > remaining_length)
+				toload = remaining_length;
+
+			rdp_cmd_gather(&dp_current_al, toload);
+			remaining_length -= toload;
 
-			if (!remaining_length)
+			if (rdp_cmd_ptr < cmd_length)
 			{
+				if (unlikely(capture != NULL))
+					rdp_capture_end(capture);
+
 				dp_start &= 0x00FFFFFF;
 				dp_end &= 0x00FFFFFF;
 				dp_current = dp_end;
 				return;
 			}
-			else
-			{
-				dp_current_al -= (rdp_cmd_ptr - rdp_cmd_cur);
-				remaining_length += (rdp_cmd_ptr - rdp_cmd_cur);
-				break;
-			}
+
+			rdp_cmd_words = rdp_cmd_data;
+			rdp_cmd_ptr = 0;
 		}
+
+		cmd = (RDP_CMD_WORD(0) >> 24) & 0x3f;
 		
 		if (LOG_RDP_EXECUTION)
 		{
@@ -7642,23 +8005,30 @@ void rdp_process_list(void)
 
 
 			rdp_dasm(string);
-			fprintf(rdp_exec, "%08X: %08X %08X   %s\n", command_counter, rdp_cmd_data[rdp_cmd_cur+0], rdp_cmd_data[rdp_cmd_cur+1], string);
+			fprintf(rdp_exec, "%08X: %08X %08X   %s\n", command_counter, RDP_CMD_WORD(0), RDP_CMD_WORD(1), string);
 			}
 			command_counter++;
 		}
 
-		
-		
-		
+		if (unlikely(capture != NULL))
+			rdp_capture_commands(capture, rdp_cmd_words, cmd_length);
 
-		
-		rdp_command_table[cmd](rdp_cmd_data[rdp_cmd_cur+0], rdp_cmd_data[rdp_cmd_cur + 1]);
-		
-		rdp_cmd_cur += cmd_length;
+		if (unlikely(stats != NULL))
+		{
+			stats->total.commands[cmd]++;
+			stats_command = cmd;
+		}
+
+		if (unlikely(frameskip != NULL) && rdp_frameskip_filter(cmd))
+			continue;
+
+		rdp_command_table[cmd](RDP_CMD_WORD(0), RDP_CMD_WORD(1));
 	};
+
 	rdp_cmd_ptr = 0;
-	rdp_cmd_cur = 0;
-	};
+
+	if (unlikely(capture != NULL))
+		rdp_capture_end(capture);
 
 	dp_start &= 0x00FFFFFF;
 	dp_end &= 0x00FFFFFF;
@@ -7828,116 +8198,116 @@ static inline uint32_t leftcvghex(uint32_t x, uint32_t fmask)
 	return (covered & fmask);
 }
 
-static inline void compute_cvg_flip(int32_t scanline)
+/*
+ * Each subscanline keeps its two coverage bits in the pixels strictly
+ * between the integer parts of its edges; the edge pixels themselves get
+ * partial coverage. Coverage bytes are built from the four subscanlines
+ * at once, 16 pixels per step with SSE2, and the (at most eight) edge
+ * pixels are patched up afterwards.
+ */
+static inline void compute_cvg(int32_t scanline, int flip)
 {
 	int32_t purgestart, purgeend;
-	int i, length, fmask, maskshift, fmaskshifted;
-	int32_t minorcur, majorcur, minorcurint, majorcurint, samecvg;
+	int32_t lox[4], hix[4], lo[4], hi[4];
+	uint8_t clearmask[4];
+	int i, k, fmask, maskshift;
 
-	purgestart = span[scanline].rx;
-	purgeend = span[scanline].lx;
-	length = purgeend - purgestart;
-	if (length >= 0)
+	if (flip)
 	{
+		purgestart = span[scanline].rx;
+		purgeend = span[scanline].lx;
+	}
+	else
+	{
+		purgestart = span[scanline].lx;
+		purgeend = span[scanline].rx;
+	}
 
-		memset(&cvgbuf[purgestart], 0xff, length + 1);
-		for(i = 0; i < 4; i++)
-		{
-				fmask = 0xa >> (i & 1);
-
-
-				maskshift = (i - 2) & 4;
-				fmaskshifted = fmask << maskshift;
-
-				if (!span[scanline].invalyscan[i])
-				{
-					minorcur = span[scanline].minorx[i];
-					majorcur = span[scanline].majorx[i];
-					minorcurint = minorcur >> 3;
-					majorcurint = majorcur >> 3;
+	if (purgeend < purgestart)
+		return;
 
-					for (int k = purgestart; k <= majorcurint; k++)
-						cvgbuf[k] &= ~fmaskshifted;
-					for (int k = minorcurint; k <= purgeend; k++)
-						cvgbuf[k] &= ~fmaskshifted;
+	for (i = 0; i < 4; i++)
+	{
+		fmask = 0xa >> (i & 1);
+		maskshift = (i - 2) & 4;
+		clearmask[i] = ~(fmask << maskshift);
 
+		if (span[scanline].invalyscan[i])
+		{
+			lox[i] = hix[i] = 0;
+			lo[i] = hi[i] = 0;
+			continue;
+		}
 
+		lox[i] = flip ? span[scanline].majorx[i] : span[scanline].minorx[i];
+		hix[i] = flip ? span[scanline].minorx[i] : span[scanline].majorx[i];
+		lo[i] = lox[i] >> 3;
+		hi[i] = hix[i] >> 3;
+	}
 
+	k = purgestart;
 
+#ifdef __SSE2__
+	if (purgeend - purgestart >= 15)
+	{
+		__m128i lo128[4], hi128[4], clear128[4];
+		__m128i step = _mm_set1_epi16(8);
+		__m128i x0 = _mm_add_epi16(_mm_set1_epi16(k), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+		__m128i x1 = _mm_add_epi16(x0, step);
 
+		for (i = 0; i < 4; i++)
+		{
+			lo128[i] = _mm_set1_epi16(lo[i]);
+			hi128[i] = _mm_set1_epi16(hi[i]);
+			clear128[i] = _mm_set1_epi16(clearmask[i]);
+		}
 
+		for (; k + 15 <= purgeend; k += 16)
+		{
+			__m128i cvg0 = _mm_set1_epi16(0xff);
+			__m128i cvg1 = cvg0;
 
-					if (minorcurint > majorcurint)
-					{
-						cvgbuf[minorcurint] |= (rightcvghex(minorcur, fmask) << maskshift);
-						cvgbuf[majorcurint] |= (leftcvghex(majorcur, fmask) << maskshift);
-					}
-					else if (minorcurint == majorcurint)
-					{
-						samecvg = rightcvghex(minorcur, fmask) & leftcvghex(majorcur, fmask);
-						cvgbuf[majorcurint] |= (samecvg << maskshift);
-					}
-				}
-				else
-				{
-					for (int k = purgestart; k <= purgeend; k++)
-						cvgbuf[k] &= ~fmaskshifted;
-				}
+			for (i = 0; i < 4; i++)
+			{
+				__m128i in0 = _mm_and_si128(_mm_cmpgt_epi16(x0, lo128[i]), _mm_cmpgt_epi16(hi128[i], x0));
+				__m128i in1 = _mm_and_si128(_mm_cmpgt_epi16(x1, lo128[i]), _mm_cmpgt_epi16(hi128[i], x1));
+				cvg0 = _mm_and_si128(cvg0, _mm_or_si128(in0, clear128[i]));
+				cvg1 = _mm_and_si128(cvg1, _mm_or_si128(in1, clear128[i]));
+			}
 
+			_mm_storeu_si128((__m128i*)&cvgbuf[k], _mm_packus_epi16(cvg0, cvg1));
+			x0 = _mm_add_epi16(x1, step);
+			x1 = _mm_add_epi16(x0, step);
 		}
 	}
-}
-
-static inline void compute_cvg_noflip(int32_t scanline)
-{
-	int32_t purgestart, purgeend;
-	int i, length, fmask, maskshift, fmaskshifted;
-	int32_t minorcur, majorcur, minorcurint, majorcurint, samecvg;
-
-	purgestart = span[scanline].lx;
-	purgeend = span[scanline].rx;
-	length = purgeend - purgestart;
+#endif
 
-	if (length >= 0)
+	for (; k <= purgeend; k++)
 	{
-		memset(&cvgbuf[purgestart], 0xff, length + 1);
+		uint8_t cvg = 0xff;
 
-		for(i = 0; i < 4; i++)
-		{
-			fmask = 0xa >> (i & 1);
-			maskshift = (i - 2) & 4;
-			fmaskshifted = fmask << maskshift;
+		for (i = 0; i < 4; i++)
+			if (k <= lo[i] || k >= hi[i])
+				cvg &= clearmask[i];
 
-			if (!span[scanline].invalyscan[i])
-			{
-				minorcur = span[scanline].minorx[i];
-				majorcur = span[scanline].majorx[i];
-				minorcurint = minorcur >> 3;
-				majorcurint = majorcur >> 3;
+		cvgbuf[k] = cvg;
+	}
 
-				for (int k = purgestart; k <= minorcurint; k++)
-					cvgbuf[k] &= ~fmaskshifted;
-				for (int k = majorcurint; k <= purgeend; k++)
-					cvgbuf[k] &= ~fmaskshifted;
+	for (i = 0; i < 4; i++)
+	{
+		if (span[scanline].invalyscan[i])
+			continue;
 
-				if (majorcurint > minorcurint)
-				{
-					cvgbuf[minorcurint] |= (leftcvghex(minorcur, fmask) << maskshift);
-					cvgbuf[majorcurint] |= (rightcvghex(majorcur, fmask) << maskshift);
-				}
-				else if (minorcurint == majorcurint)
-				{
-					samecvg = leftcvghex(minorcur, fmask) & rightcvghex(majorcur, fmask);
-					cvgbuf[majorcurint] |= (samecvg << maskshift);
-				}
-			}
-			else
-			{
-				for (int k = purgestart; k <= purgeend; k++)
-					cvgbuf[k] &= ~fmaskshifted;
-			}
+		fmask = 0xa >> (i & 1);
+		maskshift = (i - 2) & 4;
 
+		if (hi[i] > lo[i])
+		{
+			cvgbuf[lo[i]] |= (leftcvghex(lox[i], fmask) << maskshift);
+			cvgbuf[hi[i]] |= (rightcvghex(hix[i], fmask) << maskshift);
 		}
+		else if (hi[i] == lo[i])
+			cvgbuf[hi[i]] |= ((leftcvghex(lox[i], fmask) & rightcvghex(hix[i], fmask)) << maskshift);
 	}
 }
 
@@ -8035,6 +8405,111 @@ static void fbfill_32(uint32_t curpixel)
 	PAIRWRITE32(fb, fill_color, (fill_color & 0x10000) ? 3 : 0, (fill_color & 0x1) ? 3 : 0);
 }
 
+/*
+Stores a repeating 4-byte pattern; word holds the pattern bytes in memory order.
+*/
+static inline void fill_bytes_pattern(uint8_t* dst, uint32_t count, uint32_t word)
+{
+	uint8_t bytes[4];
+	uint32_t i;
+
+#ifdef __AVX__
+	__m256i pattern256 = _mm256_set1_epi32(word);
+	for (; count >= 32; count -= 32, dst += 32)
+		_mm256_storeu_si256((__m256i*)dst, pattern256);
+#endif
+#ifdef __SSE2__
+	__m128i pattern128 = _mm_set1_epi32(word);
+	for (; count >= 16; count -= 16, dst += 16)
+		_mm_storeu_si128((__m128i*)dst, pattern128);
+#endif
+	for (; count >= 4; count -= 4, dst += 4)
+		memcpy(dst, &word, 4);
+
+	memcpy(bytes, &word, 4);
+	for (i = 0; i < count; i++)
+		dst[i] = bytes[i];
+}
+
+/*
+Equivalent to calling fbfill_16/fbfill_32 on count consecutive pixels, starting with curpixel.
+Both sizes store fill_color big-endian over the span, and alternate the hidden bits of its
+two halves, so the whole span is done with two pattern fills. Spans that would wrap around
+the end of RDRAM go through the per-pixel path.
+*/
+static void fbfill_span(uint32_t curpixel, uint32_t count)
+{
+	uint32_t idx, addr, bytes, hidx, hcount, i;
+	uint8_t color[4], pattern[4], hval[2];
+	uint32_t be_color = byteswap_32(fill_color);
+	uint32_t word;
+
+	if (fb_size == PIXEL_SIZE_16BIT)
+	{
+		idx = ((fb_address >> 1) + curpixel) & (RDRAM_MASK >> 1);
+		if (unlikely(idx + count - 1 > idxlim16))
+		{
+			for (i = 0; i < count; i++)
+				fbfill_16(curpixel + i);
+			return;
+		}
+
+		addr = idx << 1;
+		bytes = count << 1;
+		hidx = idx;
+		hcount = count;
+	}
+	else
+	{
+		idx = ((fb_address >> 2) + curpixel) & (RDRAM_MASK >> 2);
+		if (unlikely(idx + count - 1 > idxlim32))
+		{
+			for (i = 0; i < count; i++)
+				fbfill_32(curpixel + i);
+			return;
+		}
+
+		addr = idx << 2;
+		bytes = count << 2;
+		hidx = idx << 1;
+		hcount = count << 1;
+	}
+
+	memcpy(color, &be_color, 4);
+	for (i = 0; i < 4; i++)
+		pattern[i] = color[(addr + i) & 3];
+	memcpy(&word, pattern, 4);
+	fill_bytes_pattern(&rdram_8[addr], bytes, word);
+
+	hval[0] = (fill_color & 0x10000) ? 3 : 0;
+	hval[1] = (fill_color & 0x1) ? 3 : 0;
+	for (i = 0; i < 4; i++)
+		pattern[i] = hval[(hidx + i) & 1];
+	memcpy(&word, pattern, 4);
+	fill_bytes_pattern(&hidden_bits[hidx], hcount, word);
+}
+
+/*
+Equivalent to the PAIRWRITE8 loop in render_spans_copy for a whole, unmasked qword written
+in increasing address order: the qword is stored big-endian, and each odd byte sets the hidden
+bits of its 16-bit word. addr must not wrap around the end of RDRAM.
+*/
+static void fbwrite_copy_qword(uint32_t addr, uint64_t qword)
+{
+	uint32_t words[2];
+	uint32_t hidx = addr >> 1;
+	int shift = (addr & 1) ? 8 : 0;
+
+	words[0] = byteswap_32((uint32_t)(qword >> 32));
+	words[1] = byteswap_32((uint32_t)qword);
+	memcpy(&rdram_8[addr], words, 8);
+
+	hidden_bits[hidx + 0] = ((qword >> (48 + shift)) & 1) ? 3 : 0;
+	hidden_bits[hidx + 1] = ((qword >> (32 + shift)) & 1) ? 3 : 0;
+	hidden_bits[hidx + 2] = ((qword >> (16 + shift)) & 1) ? 3 : 0;
+	hidden_bits[hidx + 3] = ((qword >> shift) & 1) ? 3 : 0;
+}
+
 static void fbread_4(uint32_t curpixel, uint32_t* curpixel_memcvg)
 {
 	memory_color.r = memory_color.g = memory_color.b = 0;
@@ -8208,209 +8683,6 @@ static inline uint32_t z_decompress(uint32_t zb)
 	return z_complete_dec_table[(zb >> 2) & 0x3fff];
 }
 
-static void z_build_com_table(void)
-{
-
-	uint16_t altmem = 0;
-	for(int z = 0; z < 0x40000; z++)
-	{
-	switch((z >> 11) & 0x7f)
-	{
-	case 0x00:
-	case 0x01:
-	case 0x02:
-	case 0x03:
-	case 0x04:
-	case 0x05:
-	case 0x06:
-	case 0x07:
-	case 0x08:
-	case 0x09:
-	case 0x0a:
-	case 0x0b:
-	case 0x0c:
-	case 0x0d:
-	case 0x0e:
-	case 0x0f:
-	case 0x10:
-	case 0x11:
-	case 0x12:
-	case 0x13:
-	case 0x14:
-	case 0x15:
-	case 0x16:
-	case 0x17:
-	case 0x18:
-	case 0x19:
-	case 0x1a:
-	case 0x1b:
-	case 0x1c:
-	case 0x1d:
-	case 0x1e:
-	case 0x1f:
-	case 0x20:
-	case 0x21:
-	case 0x22:
-	case 0x23:
-	case 0x24:
-	case 0x25:
-	case 0x26:
-	case 0x27:
-	case 0x28:
-	case 0x29:
-	case 0x2a:
-	case 0x2b:
-	case 0x2c:
-	case 0x2d:
-	case 0x2e:
-	case 0x2f:
-	case 0x30:
-	case 0x31:
-	case 0x32:
-	case 0x33:
-	case 0x34:
-	case 0x35:
-	case 0x36:
-	case 0x37:
-	case 0x38:
-	case 0x39:
-	case 0x3a:
-	case 0x3b:
-	case 0x3c:
-	case 0x3d:
-	case 0x3e:
-	case 0x3f:
-		altmem = (z >> 4) & 0x1ffc;
-		break;
-	case 0x40:
-	case 0x41:
-	case 0x42:
-	case 0x43:
-	case 0x44:
-	case 0x45:
-	case 0x46:
-	case 0x47:
-	case 0x48:
-	case 0x49:
-	case 0x4a:
-	case 0x4b:
-	case 0x4c:
-	case 0x4d:
-	case 0x4e:
-	case 0x4f:
-	case 0x50:
-	case 0x51:
-	case 0x52:
-	case 0x53:
-	case 0x54:
-	case 0x55:
-	case 0x56:
-	case 0x57:
-	case 0x58:
-	case 0x59:
-	case 0x5a:
-	case 0x5b:
-	case 0x5c:
-	case 0x5d:
-	case 0x5e:
-	case 0x5f:
-		altmem = ((z >> 3) & 0x1ffc) | 0x2000;
-		break;
-	case 0x60:
-	case 0x61:
-	case 0x62:
-	case 0x63:
-	case 0x64:
-	case 0x65:
-	case 0x66:
-	case 0x67:
-	case 0x68:
-	case 0x69:
-	case 0x6a:
-	case 0x6b:
-	case 0x6c:
-	case 0x6d:
-	case 0x6e:
-	case 0x6f:
-		altmem = ((z >> 2) & 0x1ffc) | 0x4000;
-		break;
-	case 0x70:
-	case 0x71:
-	case 0x72:
-	case 0x73:
-	case 0x74:
-	case 0x75:
-	case 0x76:
-	case 0x77:
-		altmem = ((z >> 1) & 0x1ffc) | 0x6000;
-		break;
-	case 0x78:
-	case 0x79:
-	case 0x7a:
-	case 0x7b:
-		altmem = (z & 0x1ffc) | 0x8000;
-		break;
-	case 0x7c:
-	case 0x7d:
-		altmem = ((z << 1) & 0x1ffc) | 0xa000;
-		break;
-	case 0x7e:
-		altmem = ((z << 2) & 0x1ffc) | 0xc000;
-		break;
-	case 0x7f:
-		altmem = ((z << 2) & 0x1ffc) | 0xe000;
-		break;
-	default:
-		debug("z_build_com_table failed");
-		break;
-	}
-
-    z_com_table[z] = altmem;
-
-    }
-}
-
-static void precalc_cvmask_derivatives(void)
-{
-	int i = 0, k = 0;
-	uint16_t mask = 0, maskx = 0, masky = 0;
-	uint8_t offx = 0, offy = 0;
-	const uint8_t yarray[16] = {0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
-	const uint8_t xarray[16] = {0, 3, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0};
-
-	
-	for (; i < 0x100; i++)
-	{
-		mask = decompress_cvmask_frombyte(i);
-		cvarray[i].cvg = cvarray[i].cvbit = 0;
-		cvarray[i].cvbit = (i >> 7) & 1;
-		for (k = 0; k < 8; k++)
-			cvarray[i].cvg += ((i >> k) & 1);
-
-		
-		masky = maskx = offx = offy = 0;
-		for (k = 0; k < 4; k++)
-			masky |= ((mask & (0xf000 >> (k << 2))) > 0) << k;
-
-		offy = yarray[masky];
-		
-		maskx = (mask & (0xf000 >> (offy << 2))) >> ((offy ^ 3) << 2);
-		
-		
-		offx = xarray[maskx];
-		
-		cvarray[i].xoff = offx;
-		cvarray[i].yoff = offy;
-	}
-}
-
-static inline uint16_t decompress_cvmask_frombyte(uint8_t x)
-{
-	uint16_t y = (x & 1) | ((x & 2) << 4) | (x & 4) | ((x & 8) << 4) |
-		((x & 0x10) << 4) | ((x & 0x20) << 8) | ((x & 0x40) << 4) | ((x & 0x80) << 8);
-	return y;
-}
-
 static inline void lookup_cvmask_derivatives(uint32_t mask, uint8_t* offx, uint8_t* offy, uint32_t* curpixel_cvg, uint32_t* curpixel_cvbit)
 {
 	CVtcmaskDERIVATIVE temp = cvarray[mask];
@@ -8446,7 +8718,7 @@ static inline uint32_t dz_compress(uint32_t value)
 	return j;
 }
 
-static inline uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg)
+static inline uint32_t z_test(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg)
 {
 
 
@@ -8600,6 +8872,74 @@ static inline uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix
 	}
 }
 
+static inline uint32_t z_compare(uint32_t zcurpixel, uint32_t sz, uint16_t dzpix, int dzpixenc, uint32_t* blend_en, uint32_t* prewrap, uint32_t* curpixel_cvg, uint32_t curpixel_memcvg)
+{
+	uint32_t pass = z_test(zcurpixel, sz, dzpix, dzpixenc, blend_en, prewrap, curpixel_cvg, curpixel_memcvg);
+
+	if (unlikely(stats != NULL) && other_modes.z_compare_en)
+	{
+		if (pass)
+			stats->total.z_pass++;
+		else
+			stats->total.z_fail++;
+	}
+
+	return pass;
+}
+
+/* True if z_compare cannot pass for any pixel of a span, whatever the
+   z_mode and coverage overflow: the pixel must be neither at max depth
+   nor coplanar, and behind the stored depth by more than its delta. */
+static int span_z_rejected(int x, int length, int xinc, int z, int dzinc, uint32_t zcurpixel, uint16_t dzpix)
+{
+	uint32_t zval, hval, oz, dzmem, dznew, zaddr, curpixel_cvg, curpixel_cvbit;
+	int32_t rawdzmem = 0, sz;
+	uint8_t offx, offy;
+	int j;
+
+	for (j = 0; j <= length; j++)
+	{
+		lookup_cvmask_derivatives(cvgbuf[x], &offx, &offy, &curpixel_cvg, &curpixel_cvbit);
+		sz = z_correct_clip(offx, offy, (z >> 10) & 0x3fffff, curpixel_cvg);
+
+		zaddr = zcurpixel;
+		PAIRREAD16(zval, hval, zaddr);
+		oz = z_decompress(zval);
+		rawdzmem = ((zval & 3) << 2) | hval;
+		dzmem = dz_decompress(rawdzmem);
+
+		if (oz == 0x3ffff)
+			return 0;
+
+		if (((zval >> 13) & 0xf) < 3)
+		{
+			if (dzmem == 0x8000)
+				return 0;
+
+			dzmem <<= 1;
+			if (dzmem < (16U >> ((zval >> 13) & 0xf)))
+				dzmem = 16 >> ((zval >> 13) & 0xf);
+		}
+
+		dznew = (uint32_t)deltaz_comparator_lut[dzpix | dzmem] << 3;
+
+		if (sz - (int32_t)dznew <= (int32_t)oz)
+			return 0;
+
+		z += dzinc;
+		x += xinc;
+		zcurpixel += xinc;
+	}
+
+	/* z_compare would have left the last pixel's delta behind. */
+	pastrawdzmem = rawdzmem;
+
+	if (unlikely(stats != NULL))
+		stats->total.z_fail += length + 1;
+
+	return 1;
+}
+
 static inline int finalize_spanalpha(uint32_t blend_en, uint32_t curpixel_cvg, uint32_t curpixel_memcvg)
 {
 	int finalcvg;
@@ -9053,7 +9393,7 @@ static inline void restore_filter32(int* r, int* g, int* b, uint32_t fboffset, u
 	*b = bend;
 }
 
-static inline void gamma_filters(int* r, int* g, int* b, int gamma_and_dither)
+static inline void gamma_filters(int* r, int* g, int* b, int gamma_and_dither, uint32_t* seed)
 {
 	int cdith, dith;
 	
@@ -9065,7 +9405,7 @@ static inline void gamma_filters(int* r, int* g, int* b, int gamma_and_dither)
 		return;
 		break;
 	case 1:
-		cdith = irand();
+		cdith = vi_irand(seed);
 		dith = cdith & 1;
 		if (*r < 255)
 			*r += dith;
@@ -9082,7 +9422,7 @@ static inline void gamma_filters(int* r, int* g, int* b, int gamma_and_dither)
 		*b = gamma_table[*b];
 		break;
 	case 3:
-		cdith = irand();
+		cdith = vi_irand(seed);
 		dith = cdith & 0x3f;
 		*r = gamma_dither_table[((*r) << 6)|dith];
 		dith = (cdith >> 6) & 0x3f;
@@ -9437,12 +9777,29 @@ static inline void vi_vl_lerp(CCVG* up, CCVG down, uint32_t frac)
 
 }
 
+static inline int z_correct_clip(int offx, int offy, int sz, uint32_t curpixel_cvg)
+{
+	int zanded;
+
+	if (curpixel_cvg == 8)
+		sz = sz >> 3;
+	else
+		sz = ((sz << 2) + offx * spans_cdz + offy * spans_dzdy) >> 5;
+
+	zanded = (sz & 0x60000) >> 17;
+
+	switch(zanded)
+	{
+		case 0: return sz & 0x3ffff;
+		case 1:	return sz & 0x3ffff;
+		case 2: return 0x3ffff;
+		default: return 0;
+	}
+}
+
 static inline void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, int a, int* z, uint32_t curpixel_cvg)
 {
 	int summand_r, summand_b, summand_g, summand_a;
-	int summand_z;
-	int sz = *z;
-	int zanded;
 
 
 
@@ -9453,7 +9810,6 @@ static inline void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, i
 		g >>= 2;
 		b >>= 2;
 		a >>= 2;
-		sz = sz >> 3;
 	}
 	else
 	{
@@ -9461,13 +9817,11 @@ static inline void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, i
 		summand_g = offx * spans_cdg + offy * spans_dgdy;
 		summand_b = offx * spans_cdb + offy * spans_dbdy;
 		summand_a = offx * spans_cda + offy * spans_dady;
-		summand_z = offx * spans_cdz + offy * spans_dzdy;
 
 		r = ((r << 2) + summand_r) >> 4;
 		g = ((g << 2) + summand_g) >> 4;
 		b = ((b << 2) + summand_b) >> 4;
 		a = ((a << 2) + summand_a) >> 4;
-		sz = ((sz << 2) + summand_z) >> 5;
 	}
 
 	
@@ -9476,38 +9830,7 @@ static inline void rgbaz_correct_clip(int offx, int offy, int r, int g, int b, i
 	shade_color.b = special_9bit_clamptable[b & 0x1ff];
 	shade_color.a = special_9bit_clamptable[a & 0x1ff];
 	
-	
-	
-	zanded = (sz & 0x60000) >> 17;
-
-	
-	switch(zanded)
-	{
-		case 0: *z = sz & 0x3ffff;						break;
-		case 1:	*z = sz & 0x3ffff;						break;
-		case 2: *z = 0x3ffff;							break;
-		case 3: *z = 0;									break;
-	}
-}
-
-uint32_t vi_integer_sqrt(uint32_t a)
-{
-	unsigned long op = a, res = 0, one = 1 << 30;
-
-    while (one > op) 
-		one >>= 2;
-
-    while (one != 0) 
-	{
-        if (op >= res + one) 
-		{
-            op -= res + one;
-            res += one << 1;
-        }
-        res >>= 1;
-        one >>= 2;
-    }
-    return res;
+	*z = z_correct_clip(offx, offy, *z, curpixel_cvg);
 }
 
 static void clearfb16(uint16_t* fb, uint32_t width,uint32_t height)
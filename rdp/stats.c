@@ -0,0 +1,148 @@
+//
+// rdp/stats.c: RDP workload statistics.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rdp/stats.h"
+
+static const char *rdp_stats_command_names[RDP_STATS_NUM_COMMANDS] = {
+  "NOOP", NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+  "TRI_NOSHADE", "TRI_NOSHADE_Z", "TRI_TEX", "TRI_TEX_Z",
+  "TRI_SHADE", "TRI_SHADE_Z", "TRI_TEXSHADE", "TRI_TEXSHADE_Z",
+  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+  NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+  NULL, NULL, NULL, NULL,
+  "TEX_RECT", "TEX_RECT_FLIP", "SYNC_LOAD", "SYNC_PIPE",
+  "SYNC_TILE", "SYNC_FULL", "SET_KEY_GB", "SET_KEY_R",
+  "SET_CONVERT", "SET_SCISSOR", "SET_PRIM_DEPTH", "SET_OTHER_MODES",
+  "LOAD_TLUT", NULL, "SET_TILE_SIZE", "LOAD_BLOCK",
+  "LOAD_TILE", "SET_TILE", "FILL_RECT", "SET_FILL_COLOR",
+  "SET_FOG_COLOR", "SET_BLEND_COLOR", "SET_PRIM_COLOR", "SET_ENV_COLOR",
+  "SET_COMBINE", "SET_TEXTURE_IMAGE", "SET_MASK_IMAGE", "SET_COLOR_IMAGE",
+};
+
+static const char *rdp_stats_cycle_names[NUM_RDP_STATS_CYCLE_TYPES] = {
+  "1-cycle", "2-cycle", "copy", "fill",
+};
+
+// Computes the counters accumulated between two snapshots.
+static void rdp_stats_delta(struct rdp_stats_counters *delta,
+  const struct rdp_stats_counters *to,
+  const struct rdp_stats_counters *from) {
+  const uint64_t *t = (const uint64_t *) to;
+  const uint64_t *f = (const uint64_t *) from;
+  uint64_t *d = (uint64_t *) delta;
+  size_t i;
+
+  for (i = 0; i < sizeof(*delta) / sizeof(uint64_t); i++)
+    d[i] = t[i] - f[i];
+}
+
+static void rdp_stats_dump_row(FILE *f, const char *name,
+  uint64_t frame, uint64_t sync_full, uint64_t total) {
+  fprintf(f, "  %-20s %14llu %14llu %16llu\n", name,
+    (unsigned long long) frame, (unsigned long long) sync_full,
+    (unsigned long long) total);
+}
+
+// Allocates a zeroed set of counters.
+struct rdp_stats *rdp_stats_alloc(void) {
+  return calloc(1, sizeof(struct rdp_stats));
+}
+
+// Releases memory acquired for the counters.
+void rdp_stats_free(struct rdp_stats *stats) {
+  free(stats);
+}
+
+// Writes out the last VI frame, the last SYNC_FULL-to-SYNC_FULL
+// interval and the totals side by side.
+void rdp_stats_dump(const struct rdp_stats *stats, FILE *f) {
+  struct rdp_stats_counters frame, sync_full;
+  char name[32];
+  unsigned i;
+
+  rdp_stats_delta(&frame, stats->frame + 1, stats->frame + 0);
+  rdp_stats_delta(&sync_full, stats->sync_full + 1, stats->sync_full + 0);
+
+  fprintf(f, "# RDP statistics: %llu VI frames, %llu SYNC_FULLs\n",
+    (unsigned long long) stats->frames,
+    (unsigned long long) stats->sync_fulls);
+
+  fprintf(f, "# %-20s %14s %14s %16s\n",
+    "counter", "last frame", "last sync", "total");
+
+  for (i = 0; i < NUM_RDP_STATS_CYCLE_TYPES; i++) {
+    snprintf(name, sizeof(name), "pixels (%s)", rdp_stats_cycle_names[i]);
+    rdp_stats_dump_row(f, name, frame.cycle_pixels[i],
+      sync_full.cycle_pixels[i], stats->total.cycle_pixels[i]);
+  }
+
+  rdp_stats_dump_row(f, "texels", frame.texels,
+    sync_full.texels, stats->total.texels);
+  rdp_stats_dump_row(f, "z pass", frame.z_pass,
+    sync_full.z_pass, stats->total.z_pass);
+  rdp_stats_dump_row(f, "z fail", frame.z_fail,
+    sync_full.z_fail, stats->total.z_fail);
+  rdp_stats_dump_row(f, "blends", frame.blends,
+    sync_full.blends, stats->total.blends);
+  rdp_stats_dump_row(f, "cvg/alpha rejects", frame.cvg_rejects,
+    sync_full.cvg_rejects, stats->total.cvg_rejects);
+
+  fprintf(f, "\n# %-20s %14s %14s %16s\n",
+    "command", "last frame", "last sync", "total");
+
+  for (i = 0; i < RDP_STATS_NUM_COMMANDS; i++) {
+    const char *mnemonic = rdp_stats_command_names[i];
+
+    if (stats->total.commands[i] == 0)
+      continue;
+
+    if (mnemonic == NULL) {
+      snprintf(name, sizeof(name), "INVALID_%.2X", i);
+      mnemonic = name;
+    }
+
+    rdp_stats_dump_row(f, mnemonic, frame.commands[i],
+      sync_full.commands[i], stats->total.commands[i]);
+  }
+
+  fprintf(f, "\n# %-20s %14s %14s %16s\n",
+    "pixels by command", "last frame", "last sync", "total");
+
+  for (i = 0; i < RDP_STATS_NUM_COMMANDS; i++) {
+    if (stats->total.command_pixels[i] == 0)
+      continue;
+
+    rdp_stats_dump_row(f, rdp_stats_command_names[i],
+      frame.command_pixels[i], sync_full.command_pixels[i],
+      stats->total.command_pixels[i]);
+  }
+}
+
+// Called when the RDP executes a SYNC_FULL.
+void rdp_stats_sync_full(struct rdp_stats *stats) {
+  stats->sync_full[0] = stats->sync_full[1];
+  stats->sync_full[1] = stats->total;
+  stats->sync_fulls++;
+}
+
+// Called when the VI starts scanning out a frame.
+void rdp_stats_frame(struct rdp_stats *stats) {
+  stats->frame[0] = stats->frame[1];
+  stats->frame[1] = stats->total;
+  stats->frames++;
+
+  if (unlikely(stats->dump_requested)) {
+    stats->dump_requested = 0;
+    rdp_stats_dump(stats, stdout);
+    fflush(stdout);
+  }
+}
+
@@ -0,0 +1,75 @@
+//
+// rdp/stats.h: RDP workload statistics.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rdp_stats_h__
+#define __rdp_stats_h__
+#include "common.h"
+#include <signal.h>
+
+#define RDP_STATS_NUM_COMMANDS 64
+
+// Same order as the cycle_type field of SET_OTHER_MODES.
+enum rdp_stats_cycle_type {
+  RDP_STATS_CYCLE_1,
+  RDP_STATS_CYCLE_2,
+  RDP_STATS_CYCLE_COPY,
+  RDP_STATS_CYCLE_FILL,
+  NUM_RDP_STATS_CYCLE_TYPES
+};
+
+struct rdp_stats_counters {
+  uint64_t commands[RDP_STATS_NUM_COMMANDS];
+  uint64_t command_pixels[RDP_STATS_NUM_COMMANDS];
+  uint64_t cycle_pixels[NUM_RDP_STATS_CYCLE_TYPES];
+
+  uint64_t texels;
+  uint64_t z_pass;
+  uint64_t z_fail;
+  uint64_t blends;
+  uint64_t cvg_rejects;
+};
+
+// Only the running totals are counted into; the intervals
+// between SYNC_FULLs and VI frames are differences between
+// snapshots of them.
+struct rdp_stats {
+  struct rdp_stats_counters total;
+
+  struct rdp_stats_counters sync_full[2];
+  struct rdp_stats_counters frame[2];
+  uint64_t sync_fulls;
+  uint64_t frames;
+
+  volatile sig_atomic_t dump_requested;
+};
+
+cen64_cold struct rdp_stats *rdp_stats_alloc(void);
+cen64_cold void rdp_stats_free(struct rdp_stats *stats);
+cen64_cold void rdp_stats_dump(const struct rdp_stats *stats, FILE *f);
+
+void rdp_stats_sync_full(struct rdp_stats *stats);
+void rdp_stats_frame(struct rdp_stats *stats);
+
+// Safe to call from a signal handler: the report is
+// written at the end of the next VI frame.
+static inline void rdp_stats_request_dump(struct rdp_stats *stats) {
+  stats->dump_requested = 1;
+}
+
+static inline uint64_t rdp_stats_pixels(
+  const struct rdp_stats_counters *counters) {
+  return counters->cycle_pixels[RDP_STATS_CYCLE_1] +
+    counters->cycle_pixels[RDP_STATS_CYCLE_2] +
+    counters->cycle_pixels[RDP_STATS_CYCLE_COPY] +
+    counters->cycle_pixels[RDP_STATS_CYCLE_FILL];
+}
+
+#endif
+
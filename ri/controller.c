@@ -84,6 +84,8 @@ int write_rdram(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
   orig_word = byteswap_32(orig_word) & ~dqm;
   word = byteswap_32(orig_word | word);
   memcpy(ri->ram + offset, &word, sizeof(word));
+
+  ri->dirty[offset >> RDRAM_DIRTY_BLOCK_SHIFT] = 0xFF;
   return 0;
 }
 
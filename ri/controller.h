@@ -15,6 +15,12 @@
 #define MAX_RDRAM_SIZE 0x800000U
 #define MAX_RDRAM_SIZE_MASK (MAX_RDRAM_SIZE - 1U)
 
+// RDRAM is tracked for modifications in blocks of this size
+// (a bit over one 320-pixel, 16-bit scanline each).
+#define RDRAM_DIRTY_BLOCK_SHIFT 10
+#define RDRAM_DIRTY_BLOCK_SIZE (1U << RDRAM_DIRTY_BLOCK_SHIFT)
+#define NUM_RDRAM_DIRTY_BLOCKS (MAX_RDRAM_SIZE >> RDRAM_DIRTY_BLOCK_SHIFT)
+
 enum rdram_register {
 #define X(reg) reg,
 #include "ri/rdram_registers.md"
@@ -43,6 +49,12 @@ struct ri_controller {
   uint32_t rdram_regs[NUM_RDRAM_REGISTERS];
   uint32_t regs[NUM_RI_REGISTERS];
 
+  // Every block that something (the CPU, a DMA, the RDP) writes to
+  // gets all bits set. Each copy of RDRAM kept elsewhere (the VI's
+  // frames, the RDP capture) owns a bit, and clears it as it picks
+  // up the changes.
+  uint8_t dirty[NUM_RDRAM_DIRTY_BLOCKS];
+
   uint64_t force_ram_alignment;
   uint8_t ram[MAX_RDRAM_SIZE];
 };
@@ -58,5 +70,46 @@ cen64_cold int read_ri_regs(void *opaque, uint32_t address, uint32_t *word);
 cen64_cold int write_rdram_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm);
 cen64_cold int write_ri_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm);
 
+// Flags [address, address + length) of RDRAM as modified.
+static inline void ri_mark_dirty(struct ri_controller *ri,
+  uint32_t address, uint32_t length) {
+  uint32_t first, last;
+
+  if (length == 0)
+    return;
+
+  first = (address & MAX_RDRAM_SIZE_MASK) >> RDRAM_DIRTY_BLOCK_SHIFT;
+  last = ((address + length - 1) & MAX_RDRAM_SIZE_MASK) >> RDRAM_DIRTY_BLOCK_SHIFT;
+
+  // Transfers that run off the end of RDRAM wrap around.
+  if (unlikely(last < first || length > MAX_RDRAM_SIZE)) {
+    memset(ri->dirty, 0xFF, sizeof(ri->dirty));
+    return;
+  }
+
+  memset(ri->dirty + first, 0xFF, last - first + 1);
+}
+
+// Like ri_mark_dirty, but only sets bits; lets a writer leave
+// out a copy that already sees its writes another way.
+static inline void ri_mark_dirty_bits(struct ri_controller *ri,
+  uint32_t address, uint32_t length, uint8_t bits) {
+  uint32_t first, last, block;
+
+  if (length == 0)
+    return;
+
+  first = (address & MAX_RDRAM_SIZE_MASK) >> RDRAM_DIRTY_BLOCK_SHIFT;
+  last = ((address + length - 1) & MAX_RDRAM_SIZE_MASK) >> RDRAM_DIRTY_BLOCK_SHIFT;
+
+  if (unlikely(last < first || length > MAX_RDRAM_SIZE)) {
+    first = 0;
+    last = NUM_RDRAM_DIRTY_BLOCKS - 1;
+  }
+
+  for (block = first; block <= last; block++)
+    ri->dirty[block] |= bits;
+}
+
 #endif
 
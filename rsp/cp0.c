@@ -15,7 +15,10 @@
 #include "rsp/cp0.h"
 #include "rsp/cpu.h"
 #include "rsp/decoder.h"
+#include "rsp/hle.h"
 #include "rsp/interface.h"
+#include "rsp/profile.h"
+#include "rsp/task.h"
 #include "vr4300/interface.h"
 #ifdef _WIN32
   #include <windows.h>
@@ -179,6 +182,20 @@ void rsp_status_write(struct rsp *rsp, uint32_t rt) {
     &rsp->regs[RSP_CP0_REGISTER_SP_STATUS],
     prev_status, status));
 #endif
+
+  // The CPU just kicked off a new task.
+  if (unlikely(rsp->profile != NULL || rsp->hle != NULL) &&
+    (prev_status & SP_STATUS_HALT) && !(status & SP_STATUS_HALT)) {
+    struct rsp_task task;
+
+    rsp_task_read(rsp, &task);
+
+    if (rsp->profile)
+      rsp_profile_task_start(rsp->profile, &task);
+
+    if (rsp->hle)
+      rsp_hle_try_task(rsp, &task);
+  }
 }
 
 // Writes a value to the control processor.
@@ -27,16 +27,42 @@ static void rsp_connect_bus(struct rsp *rsp, struct bus_controller *bus) {
 
 // Releases memory acquired for the RSP component.
 void rsp_destroy(struct rsp *rsp) {
+  rsp_profile_free(rsp->profile);
+  rsp->profile = NULL;
+
+  rsp_hle_free(rsp->hle);
+  rsp->hle = NULL;
+
   arch_rsp_destroy(rsp);
 }
 
 // Initializes the RSP component.
-int rsp_init(struct rsp *rsp, struct bus_controller *bus) {
+int rsp_init(struct rsp *rsp, struct bus_controller *bus,
+  bool profiling, bool hle_audio) {
   rsp_connect_bus(rsp, bus);
 
+  if (profiling) {
+    if ((rsp->profile = rsp_profile_alloc()) == NULL)
+      return 1;
+  }
+
+  else
+    rsp->profile = NULL;
+
+  if (hle_audio) {
+    if ((rsp->hle = rsp_hle_alloc()) == NULL)
+      return 1;
+  }
+
+  else
+    rsp->hle = NULL;
+
   rsp_cp0_init(rsp);
   rsp_pipeline_init(&rsp->pipeline);
 
+  // Nothing in IMEM has been decoded yet.
+  memset(rsp->imem_dirty, 0xFF, sizeof(rsp->imem_dirty));
+
   return arch_rsp_init(rsp);
 }
 
@@ -14,7 +14,9 @@
 #include "os/dynarec.h"
 #include "rsp/cp0.h"
 #include "rsp/cp2.h"
+#include "rsp/hle.h"
 #include "rsp/pipeline.h"
+#include "rsp/profile.h"
 
 enum rsp_register {
   RSP_REGISTER_R0, RSP_REGISTER_AT, RSP_REGISTER_V0,
@@ -60,14 +62,24 @@ struct rsp {
 
   // Instead of redecoding the instructions (there's only 256 words)
   // every cycle, we maintain a 256-word decoded instruction cache.
+  // Writes to IMEM only flag words as dirty; they're decoded when
+  // (and if) they are fetched.
   struct rsp_opcode opcode_cache[0x1000 / 4];
+  uint32_t imem_dirty[0x1000 / 4 / 32];
 
   // TODO: Only for IA32/x86_64 SSE2; sloppy?
   struct dynarec_slab vload_dynarec;
   struct dynarec_slab vstore_dynarec;
+
+  // Only allocated when running with -rsp-profile.
+  struct rsp_profile *profile;
+
+  // Only allocated when running with -hle-audio.
+  struct rsp_hle *hle;
 };
 
-cen64_cold int rsp_init(struct rsp *rsp, struct bus_controller *bus);
+cen64_cold int rsp_init(struct rsp *rsp, struct bus_controller *bus,
+  bool profiling, bool hle_audio);
 cen64_cold void rsp_late_init(struct rsp *rsp);
 cen64_cold void rsp_destroy(struct rsp *rsp);
 
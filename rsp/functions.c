@@ -398,8 +398,13 @@ void RSP_LBDLSV_SBDLSV(struct rsp *rsp,
 
   exdf_latch->request.addr = rs + (sign_extend_6(iw) << shift_and_idx);
 
-  __m128i vdqm = _mm_loadl_epi64((__m128i *) (rsp_bdls_lut[op][shift_and_idx]));
-  _mm_store_si128((__m128i *) exdf_latch->request.packet.p_vect.vdqm.e, vdqm);
+  memcpy(exdf_latch->request.packet.p_vect.vdqm.e,
+    rsp_bdls_lut[op][shift_and_idx],
+    sizeof(rsp_bdls_lut[op][shift_and_idx]));
+
+  memset(exdf_latch->request.packet.p_vect.vdqm.e + 4, 0,
+    sizeof(exdf_latch->request.packet.p_vect.vdqm.e) -
+    sizeof(rsp_bdls_lut[op][shift_and_idx]));
 
   exdf_latch->request.packet.p_vect.element = GET_EL(iw);
   exdf_latch->request.type = RSP_MEM_REQUEST_VECTOR;
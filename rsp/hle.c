@@ -0,0 +1,104 @@
+//
+// rsp/hle.c: RSP high-level emulation (audio tasks).
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/controller.h"
+#include "ri/controller.h"
+#include "rsp/cp0.h"
+#include "rsp/cpu.h"
+#include "rsp/hle.h"
+#include "rsp/task.h"
+#include "vr4300/interface.h"
+
+// Audio microcodes are told apart by a few words of their data
+// section, which hold the command dispatch table. Only the common
+// ABI (aspMain, as shipped with most SDK releases) is handled; any
+// other microcode falls through to the LLE core.
+struct rsp_hle_ucode_signature {
+  uint32_t magic;       // ucode_data + 0x00
+  uint32_t dispatch;    // ucode_data + 0x28
+  uint32_t marker;      // ucode_data + 0x30
+  const char *name;
+};
+
+static const struct rsp_hle_ucode_signature rsp_hle_audio_ucodes[] = {
+  {0x00000001, 0x1E24138C, 0xF0000F00, "aspMain (ABI 1)"},
+};
+
+// Reads a big-endian word from RDRAM.
+static uint32_t rsp_hle_rdram_word(const struct rsp *rsp, uint32_t addr) {
+  uint32_t word;
+
+  memcpy(&word, rsp->bus->ri->ram + (addr & 0x7FFFFC), sizeof(word));
+  return byteswap_32(word);
+}
+
+// Allocates HLE state.
+struct rsp_hle *rsp_hle_alloc(void) {
+  return calloc(1, sizeof(struct rsp_hle));
+}
+
+// Releases HLE state.
+void rsp_hle_free(struct rsp_hle *hle) {
+  free(hle);
+}
+
+// Matches the task's microcode against the known audio ABIs.
+static const struct rsp_hle_ucode_signature *rsp_hle_identify_audio(
+  const struct rsp *rsp, const struct rsp_task *task) {
+  uint32_t data = task->ucode_data & 0x7FFFF8;
+  unsigned i;
+
+  if (data == 0 || data + 0x34 > MAX_RDRAM_SIZE)
+    return NULL;
+
+  for (i = 0; i < sizeof(rsp_hle_audio_ucodes) /
+    sizeof(*rsp_hle_audio_ucodes); i++) {
+    const struct rsp_hle_ucode_signature *sig = rsp_hle_audio_ucodes + i;
+
+    if (rsp_hle_rdram_word(rsp, data + 0x00) == sig->magic &&
+      rsp_hle_rdram_word(rsp, data + 0x28) == sig->dispatch &&
+      rsp_hle_rdram_word(rsp, data + 0x30) == sig->marker)
+      return sig;
+  }
+
+  return NULL;
+}
+
+// Does what the microcode does on exit: flag the task as done
+// and break, raising an interrupt if the CPU asked for one.
+static void rsp_hle_task_done(struct rsp *rsp) {
+  rsp_status_write(rsp, SP_SET_HALT | SP_SET_BROKE | SP_SET_SIG2);
+
+  if (rsp->regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_INTR_BREAK)
+    signal_rcp_interrupt(rsp->bus->vr4300, MI_INTR_SP);
+}
+
+// Runs a task natively if it's one we know how to handle.
+// Returns true if the task was completed (and the RSP halted).
+bool rsp_hle_try_task(struct rsp *rsp, const struct rsp_task *task) {
+  const struct rsp_hle_ucode_signature *sig;
+
+  if (task->type != RSP_TASK_AUDIO)
+    return false;
+
+  if ((sig = rsp_hle_identify_audio(rsp, task)) == NULL) {
+    rsp->hle->skipped_tasks++;
+    return false;
+  }
+
+  if (rsp->hle->audio_tasks++ == 0)
+    printf("RSP: Using HLE for audio microcode: %s.\n", sig->name);
+
+  rsp_hle_process_audio(rsp, task);
+  rsp_hle_task_done(rsp);
+  return true;
+}
+
@@ -0,0 +1,53 @@
+//
+// rsp/hle.h: RSP high-level emulation (audio tasks).
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rsp_hle_h__
+#define __rsp_hle_h__
+#include "common.h"
+#include "rsp/task.h"
+
+struct rsp;
+
+// State kept by the (ABI 1) audio command list interpreter.
+// Mirrors what the microcode keeps in DMEM across commands.
+struct rsp_hle_audio {
+  uint32_t segments[16];
+  uint32_t loop;
+
+  uint16_t in, out, count;
+  uint16_t dry_right, wet_left, wet_right;
+
+  int16_t dry, wet;
+  int16_t vol[2];
+  int16_t target[2];
+  int32_t rate[2];
+
+  // ADPCM codebook; doubles as POLEF coefficients.
+  int16_t table[16 * 8];
+
+  // Samples are kept in host order here, unlike DMEM.
+  cen64_align(int16_t buffer[0x1000 / 2], 16);
+};
+
+struct rsp_hle {
+  struct rsp_hle_audio audio;
+
+  uint64_t audio_tasks;
+  uint64_t skipped_tasks;
+};
+
+cen64_cold struct rsp_hle *rsp_hle_alloc(void);
+cen64_cold void rsp_hle_free(struct rsp_hle *hle);
+
+bool rsp_hle_try_task(struct rsp *rsp, const struct rsp_task *task);
+void rsp_hle_process_audio(struct rsp *rsp, const struct rsp_task *task);
+
+#endif
+
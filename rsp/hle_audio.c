@@ -0,0 +1,753 @@
+//
+// rsp/hle_audio.c: RSP high-level emulation (audio command lists).
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/controller.h"
+#include "ri/controller.h"
+#include "rsp/cpu.h"
+#include "rsp/hle.h"
+#include "rsp/rsp.h"
+#include "rsp/task.h"
+
+// The microcode's sample buffers start here in DMEM.
+#define AUDIO_DMEM_BASE 0x5C0
+
+// Command flags.
+#define A_INIT   0x01
+#define A_LOOP   0x02
+#define A_LEFT   0x02
+#define A_VOL    0x04
+#define A_AUX    0x08
+
+// Samples are stored in host order, so the
+// ADPCM nibble stream has to be read swizzled.
+#ifdef BIG_ENDIAN_HOST
+#define BUFFER_BYTE_XOR 0
+#else
+#define BUFFER_BYTE_XOR 1
+#endif
+
+// One side's ENVMIXER volume: it follows an exponential curve towards
+// the target, linearly interpolated over each group of 8 samples.
+struct envelope {
+  int64_t value;
+  int64_t step;
+  int64_t target;
+
+  int32_t curve;
+  int32_t rate;
+};
+
+// ENVMIXER state that the microcode spills to RDRAM between tasks.
+// The layout is private to us; the game only provides the storage.
+struct envmix_state {
+  int16_t wet, dry;
+  int32_t target[2];
+  int32_t rate[2];
+  int32_t curve[2];
+  int32_t value[2];
+};
+
+typedef void (*audio_command)(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2);
+
+static int16_t resample_lut[64 * 4];
+static bool resample_lut_ready;
+
+static inline int16_t clamp_s16(int32_t x) {
+  return x < -32768 ? -32768 : (x > 32767 ? 32767 : x);
+}
+
+static inline uint16_t align_up(uint16_t x, uint16_t n) {
+  return (x + (n - 1)) & ~(n - 1);
+}
+
+// Returns a pointer into the sample buffer at a DMEM address.
+static inline int16_t *buffer_s16(struct rsp_hle_audio *audio,
+  uint16_t dmem) {
+  return audio->buffer + ((dmem & 0xFFF) >> 1);
+}
+
+static inline uint8_t buffer_u8(const struct rsp_hle_audio *audio,
+  uint16_t dmem) {
+  const uint8_t *bytes = (const uint8_t *) audio->buffer;
+  return bytes[(dmem & 0xFFF) ^ BUFFER_BYTE_XOR];
+}
+
+// Clamps a byte count so that it stays within the buffer.
+static inline uint32_t buffer_span(uint16_t dmem, uint32_t count) {
+  uint32_t avail = 0x1000 - (dmem & 0xFFE);
+  return count < avail ? count : avail;
+}
+
+// Resolves a segmented address; bad segments map to segment 0.
+static inline uint32_t segment_address(const struct rsp_hle_audio *audio,
+  uint32_t so) {
+  return (audio->segments[(so >> 24) & 0xF] + (so & 0xFFFFFF)) &
+    MAX_RDRAM_SIZE_MASK;
+}
+
+static inline bool rdram_span_ok(uint32_t addr, uint32_t length) {
+  return addr + length <= MAX_RDRAM_SIZE;
+}
+
+static inline int16_t rdram_s16(const struct rsp *rsp, uint32_t addr) {
+  uint16_t hword;
+
+  memcpy(&hword, rsp->bus->ri->ram + (addr & 0x7FFFFE), sizeof(hword));
+  return (int16_t) byteswap_16(hword);
+}
+
+static inline void rdram_store_s16(struct rsp *rsp,
+  uint32_t addr, int16_t value) {
+  uint16_t hword = byteswap_16((uint16_t) value);
+
+  memcpy(rsp->bus->ri->ram + (addr & 0x7FFFFE), &hword, sizeof(hword));
+  ri_mark_dirty(rsp->bus->ri, addr & 0x7FFFFE, sizeof(hword));
+}
+
+// Copies big-endian samples from RDRAM into the buffer.
+static void load_samples(struct rsp *rsp, int16_t *dest,
+  uint32_t addr, uint32_t count) {
+  const uint8_t *src = rsp->bus->ri->ram + addr;
+  uint32_t i;
+
+  if (!rdram_span_ok(addr, count * 2))
+    return;
+
+  for (i = 0; i < count; i++) {
+    uint16_t hword;
+
+    memcpy(&hword, src + i * 2, sizeof(hword));
+    dest[i] = (int16_t) byteswap_16(hword);
+  }
+}
+
+// Copies samples from the buffer out to RDRAM (as big-endian).
+static void store_samples(struct rsp *rsp, uint32_t addr,
+  const int16_t *src, uint32_t count) {
+  uint8_t *dest = rsp->bus->ri->ram + addr;
+  uint32_t i;
+
+  if (!rdram_span_ok(addr, count * 2))
+    return;
+
+  for (i = 0; i < count; i++) {
+    uint16_t hword = byteswap_16((uint16_t) src[i]);
+    memcpy(dest + i * 2, &hword, sizeof(hword));
+  }
+
+  ri_mark_dirty(rsp->bus->ri, addr, count * 2);
+}
+
+//
+// Mixing kernels: dst = clamp(dst + (src * gain) >> 15).
+//
+#ifdef __SSE2__
+static inline __m128i mix_8(__m128i dst, __m128i src, __m128i gain) {
+  __m128i lo = _mm_mullo_epi16(src, gain);
+  __m128i hi = _mm_mulhi_epi16(src, gain);
+  __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+  __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+  __m128i d0 = _mm_srai_epi32(_mm_unpacklo_epi16(dst, dst), 16);
+  __m128i d1 = _mm_srai_epi32(_mm_unpackhi_epi16(dst, dst), 16);
+
+  return _mm_packs_epi32(_mm_add_epi32(d0, p0), _mm_add_epi32(d1, p1));
+}
+#endif
+
+// Mixes 8 samples, each with its own gain.
+static inline void mix_8_gains(int16_t *dst,
+  const int16_t *src, const int16_t *gains) {
+#ifdef __SSE2__
+  __m128i d = _mm_loadu_si128((const __m128i *) dst);
+  __m128i s = _mm_loadu_si128((const __m128i *) src);
+  __m128i g = _mm_loadu_si128((const __m128i *) gains);
+
+  _mm_storeu_si128((__m128i *) dst, mix_8(d, s, g));
+#else
+  unsigned i;
+
+  for (i = 0; i < 8; i++)
+    dst[i] = clamp_s16(dst[i] + ((src[i] * gains[i]) >> 15));
+#endif
+}
+
+// Mixes count samples with a constant gain.
+static void mix_samples(int16_t *dst, const int16_t *src,
+  uint32_t count, int16_t gain) {
+  uint32_t i = 0;
+
+#ifdef __SSE2__
+  __m128i g = _mm_set1_epi16(gain);
+
+  for (; i + 8 <= count; i += 8) {
+    __m128i d = _mm_loadu_si128((const __m128i *) (dst + i));
+    __m128i s = _mm_loadu_si128((const __m128i *) (src + i));
+
+    _mm_storeu_si128((__m128i *) (dst + i), mix_8(d, s, g));
+  }
+#endif
+
+  for (; i < count; i++)
+    dst[i] = clamp_s16(dst[i] + ((src[i] * gain) >> 15));
+}
+
+// Builds the 4-tap interpolation table used by RESAMPLE. The
+// microcode's own table is a windowed kernel in the same format;
+// a Catmull-Rom kernel is close enough for throughput runs.
+static void build_resample_lut(void) {
+  unsigned i, j;
+
+  for (i = 0; i < 64; i++) {
+    double t = i / 64.0;
+    double t2 = t * t, t3 = t2 * t;
+    double w[4];
+
+    w[0] = (-t3 + 2 * t2 - t) / 2;
+    w[1] = (3 * t3 - 5 * t2 + 2) / 2;
+    w[2] = (-3 * t3 + 4 * t2 + t) / 2;
+    w[3] = (t3 - t2) / 2;
+
+    for (j = 0; j < 4; j++) {
+      double q = w[j] * 32768.0;
+      resample_lut[i * 4 + j] = clamp_s16((int32_t) (q + (q < 0 ? -0.5 : 0.5)));
+    }
+  }
+
+  resample_lut_ready = true;
+}
+
+//
+// Second-order prediction, shared by ADPCM and POLEF.
+//
+// Samples go through 8 at a time. Each output is the input scaled by
+// gain, plus the two outputs before the group weighted by per-position
+// taps, plus the earlier inputs of the same group weighted by one tap
+// per sample of distance. The sum is then shifted down and clamped.
+//
+struct predictor {
+  const int16_t *older_taps;
+  const int16_t *newer_taps;
+  const int16_t *input_taps;
+  int32_t gain;
+  unsigned shift;
+};
+
+static void predict_8(const struct predictor *p, int16_t *out,
+  const int16_t *in, int16_t older, int16_t newer) {
+  int32_t sums[8];
+  unsigned n, d;
+
+  for (n = 0; n < 8; n++) {
+    sums[n] = in[n] * p->gain + p->older_taps[n] * older +
+      p->newer_taps[n] * newer;
+  }
+
+  for (d = 1; d < 8; d++) {
+    for (n = d; n < 8; n++)
+      sums[n] += p->input_taps[d - 1] * in[n - d];
+  }
+
+  for (n = 0; n < 8; n++)
+    out[n] = clamp_s16(sums[n] >> p->shift);
+}
+
+// Sign-extends a 4-bit residual into the top of a sample, then
+// scales it back down by the frame's shift.
+static inline int16_t adpcm_residual(unsigned nibble, unsigned shift) {
+  return (int16_t) (uint16_t) (nibble << 12) >> shift;
+}
+
+//
+// Audio commands.
+//
+static void audio_spnoop(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+}
+
+// Decodes ADPCM frames: a header byte (the scale in the high nibble,
+// the codebook entry in the low one), then 16 residuals, high nibble
+// first. The output is preceded by the last 16 samples of the previous
+// task, which are also what's saved for the next one.
+static void audio_adpcm(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint8_t flags = w1 >> 16;
+  uint32_t address = segment_address(audio, w2);
+  uint32_t history_address = (flags & A_LOOP) ? audio->loop : address;
+  uint16_t in = audio->in;
+  uint16_t out = audio->out;
+  uint32_t count = align_up(audio->count, 32);
+  struct predictor predictor;
+  int16_t samples[16];
+  unsigned i;
+
+  if (buffer_span(out, 32) < 32)
+    return;
+
+  count = buffer_span(out + 32, count) & ~0x1FU;
+  memset(samples, 0, sizeof(samples));
+
+  if (!(flags & A_INIT))
+    load_samples(rsp, samples, history_address, 16);
+
+  memcpy(buffer_s16(audio, out), samples, sizeof(samples));
+  out += 32;
+
+  predictor.gain = 1 << 11;
+  predictor.shift = 11;
+
+  for (; count != 0; count -= 32) {
+    uint8_t header = buffer_u8(audio, in++);
+    unsigned scale = header >> 4;
+    unsigned shift = scale < 12 ? 12 - scale : 0;
+    int16_t residuals[16];
+
+    for (i = 0; i < 16; i += 2) {
+      uint8_t byte = buffer_u8(audio, in++);
+
+      residuals[i + 0] = adpcm_residual(byte >> 4, shift);
+      residuals[i + 1] = adpcm_residual(byte & 0xF, shift);
+    }
+
+    // Each codebook entry is two sets of 8 taps.
+    predictor.older_taps = audio->table + (header & 0xF) * 16;
+    predictor.newer_taps = predictor.older_taps + 8;
+    predictor.input_taps = predictor.newer_taps;
+
+    predict_8(&predictor, samples + 0, residuals + 0, samples[14], samples[15]);
+    predict_8(&predictor, samples + 8, residuals + 8, samples[6], samples[7]);
+
+    memcpy(buffer_s16(audio, out), samples, sizeof(samples));
+    out += 32;
+  }
+
+  store_samples(rsp, address, samples, 16);
+}
+
+static void audio_clearbuff(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint16_t dmem = w1 + AUDIO_DMEM_BASE;
+  uint16_t count = w2 & 0xFFF;
+
+  if (count == 0)
+    return;
+
+  memset(buffer_s16(audio, dmem), 0,
+    buffer_span(dmem, align_up(count, 16)));
+}
+
+// Points the next 8 samples' interpolation at the next point of the
+// curve; an envelope that has reached its target stays there.
+static void envelope_aim(struct envelope *env) {
+  if (env->step == 0)
+    return;
+
+  env->curve = ((int64_t) env->curve * env->rate) >> 16;
+  env->step = (env->curve - env->value) >> 3;
+}
+
+// Returns the volume for the next sample, stopping at the target.
+static int16_t envelope_next(struct envelope *env) {
+  int64_t value = env->value + env->step;
+  bool done = env->step > 0
+    ? value >= env->target
+    : value <= env->target;
+
+  if (done) {
+    env->value = env->target;
+    env->step = 0;
+  }
+
+  else
+    env->value = value;
+
+  return (int16_t) (env->value >> 16);
+}
+
+static void audio_envmixer(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint8_t flags = w1 >> 16;
+  uint32_t address = segment_address(audio, w2);
+  unsigned num_buffers = (flags & A_AUX) ? 4 : 2;
+  int16_t dry = audio->dry, wet = audio->wet;
+  struct envmix_state state;
+  struct envelope env[2];
+  int16_t *buffers[4];
+  const int16_t *in;
+  uint32_t count, y;
+  unsigned i, x;
+
+  in = buffer_s16(audio, audio->in);
+  buffers[0] = buffer_s16(audio, audio->out);
+  buffers[1] = buffer_s16(audio, audio->dry_right);
+  buffers[2] = buffer_s16(audio, audio->wet_left);
+  buffers[3] = buffer_s16(audio, audio->wet_right);
+
+  count = buffer_span(audio->in, audio->count);
+  count = buffer_span(audio->out, count);
+  count = buffer_span(audio->dry_right, count);
+
+  if (num_buffers == 4) {
+    count = buffer_span(audio->wet_left, count);
+    count = buffer_span(audio->wet_right, count);
+  }
+
+  if (!rdram_span_ok(address, sizeof(state)))
+    return;
+
+  if (flags & A_INIT) {
+    for (i = 0; i < 2; i++) {
+      env[i].value = (int32_t) audio->vol[i] << 16;
+      env[i].target = (int32_t) audio->target[i] << 16;
+      env[i].curve = audio->vol[i] * audio->rate[i];
+      env[i].rate = audio->rate[i];
+    }
+  }
+
+  else {
+    memcpy(&state, rsp->bus->ri->ram + address, sizeof(state));
+    wet = state.wet;
+    dry = state.dry;
+
+    for (i = 0; i < 2; i++) {
+      env[i].value = state.value[i];
+      env[i].target = state.target[i];
+      env[i].curve = state.curve[i];
+      env[i].rate = state.rate[i];
+    }
+  }
+
+  // Anything nonzero will do, so long as it's
+  // zero only once the target is reached.
+  for (i = 0; i < 2; i++)
+    env[i].step = env[i].target - env[i].value;
+
+  for (y = 0; y + 16 <= count; y += 16) {
+    cen64_align(int16_t gains[4][8], 16);
+
+    envelope_aim(env + 0);
+    envelope_aim(env + 1);
+
+    // The envelope is stepped per sample; the
+    // mixing itself is done 8 samples at a time.
+    for (x = 0; x < 8; x++) {
+      int16_t l_vol = envelope_next(env + 0);
+      int16_t r_vol = envelope_next(env + 1);
+
+      gains[0][x] = clamp_s16((l_vol * dry + 0x4000) >> 15);
+      gains[1][x] = clamp_s16((r_vol * dry + 0x4000) >> 15);
+      gains[2][x] = clamp_s16((l_vol * wet + 0x4000) >> 15);
+      gains[3][x] = clamp_s16((r_vol * wet + 0x4000) >> 15);
+    }
+
+    for (i = 0; i < num_buffers; i++)
+      mix_8_gains(buffers[i] + (y >> 1), in + (y >> 1), gains[i]);
+  }
+
+  state.wet = wet;
+  state.dry = dry;
+
+  for (i = 0; i < 2; i++) {
+    state.target[i] = (int32_t) env[i].target;
+    state.value[i] = (int32_t) env[i].value;
+    state.rate[i] = env[i].rate;
+    state.curve[i] = env[i].curve;
+  }
+
+  memcpy(rsp->bus->ri->ram + address, &state, sizeof(state));
+  ri_mark_dirty(rsp->bus->ri, address, sizeof(state));
+}
+
+static void audio_loadbuff(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint32_t address = segment_address(audio, w2);
+  uint32_t count = buffer_span(audio->in, audio->count);
+
+  if (count == 0)
+    return;
+
+  load_samples(rsp, buffer_s16(audio, audio->in), address & ~0x1U, count >> 1);
+}
+
+// Resamples by a 16.16 step (the command holds half of it), running a
+// 4-tap filter over the input. The 4 input samples the filter has yet
+// to move past, and the fractional position, are saved for the next
+// task; they're put back just ahead of the input.
+static void audio_resample(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint8_t flags = w1 >> 16;
+  uint32_t step = (w1 & 0xFFFF) << 1;
+  uint32_t address = segment_address(audio, w2);
+  uint16_t in = (audio->in >> 1) - 4;
+  uint16_t out = audio->out >> 1;
+  uint32_t count = align_up(audio->count, 16) >> 1;
+  int16_t *samples = audio->buffer;
+  uint32_t fraction, n;
+  unsigned k;
+
+  if (!rdram_span_ok(address, 10))
+    return;
+
+  for (k = 0; k < 4; k++) {
+    samples[(in + k) & 0x7FF] = (flags & A_INIT)
+      ? 0 : rdram_s16(rsp, address + 2 * k);
+  }
+
+  fraction = (flags & A_INIT) ? 0 : (uint16_t) rdram_s16(rsp, address + 8);
+
+  for (n = 0; n < count; n++) {
+    const int16_t *weights = resample_lut + (fraction >> 10) * 4;
+    int32_t sum = 0;
+
+    for (k = 0; k < 4; k++)
+      sum += samples[(in + k) & 0x7FF] * weights[k];
+
+    samples[(out + n) & 0x7FF] = clamp_s16(sum >> 15);
+
+    fraction += step;
+    in += fraction >> 16;
+    fraction &= 0xFFFF;
+  }
+
+  for (k = 0; k < 4; k++)
+    rdram_store_s16(rsp, address + 2 * k, samples[(in + k) & 0x7FF]);
+
+  rdram_store_s16(rsp, address + 8, (int16_t) fraction);
+}
+
+static void audio_savebuff(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint32_t address = segment_address(audio, w2);
+  uint32_t count = buffer_span(audio->out, audio->count);
+
+  if (count == 0)
+    return;
+
+  store_samples(rsp, address & ~0x1U, buffer_s16(audio, audio->out), count >> 1);
+}
+
+static void audio_segment(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  audio->segments[(w2 >> 24) & 0xF] = w2 & 0xFFFFFF;
+}
+
+static void audio_setbuff(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint8_t flags = w1 >> 16;
+
+  if (flags & A_AUX) {
+    audio->dry_right = w1 + AUDIO_DMEM_BASE;
+    audio->wet_left = (w2 >> 16) + AUDIO_DMEM_BASE;
+    audio->wet_right = w2 + AUDIO_DMEM_BASE;
+  }
+
+  else {
+    audio->in = w1 + AUDIO_DMEM_BASE;
+    audio->out = (w2 >> 16) + AUDIO_DMEM_BASE;
+    audio->count = w2;
+  }
+}
+
+static void audio_setvol(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint8_t flags = w1 >> 16;
+
+  if (flags & A_AUX) {
+    audio->dry = w1;
+    audio->wet = w2;
+  }
+
+  else {
+    unsigned lr = (flags & A_LEFT) ? 0 : 1;
+
+    if (flags & A_VOL)
+      audio->vol[lr] = w1;
+
+    else {
+      audio->target[lr] = w1;
+      audio->rate[lr] = w2;
+    }
+  }
+}
+
+static void audio_dmemmove(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint16_t from = w1 + AUDIO_DMEM_BASE;
+  uint16_t to = (w2 >> 16) + AUDIO_DMEM_BASE;
+  uint32_t count = align_up(w2, 16);
+
+  if ((w2 & 0xFFFF) == 0)
+    return;
+
+  count = buffer_span(from, count);
+  count = buffer_span(to, count);
+
+  memmove(buffer_s16(audio, to), buffer_s16(audio, from), count);
+}
+
+static void audio_loadadpcm(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint32_t count = align_up(w1, 8) >> 1;
+  uint32_t address = segment_address(audio, w2);
+
+  if (count > sizeof(audio->table) / sizeof(*audio->table))
+    count = sizeof(audio->table) / sizeof(*audio->table);
+
+  load_samples(rsp, audio->table, address & ~0x1U, count);
+}
+
+static void audio_mixer(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  int16_t gain = w1;
+  uint16_t from = (w2 >> 16) + AUDIO_DMEM_BASE;
+  uint16_t to = w2 + AUDIO_DMEM_BASE;
+  uint32_t count = align_up(audio->count, 32);
+
+  if (audio->count == 0)
+    return;
+
+  count = buffer_span(from, count);
+  count = buffer_span(to, count);
+
+  mix_samples(buffer_s16(audio, to),
+    buffer_s16(audio, from), count >> 1, gain);
+}
+
+static void audio_interleave(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint16_t left = (w2 >> 16) + AUDIO_DMEM_BASE;
+  uint16_t right = w2 + AUDIO_DMEM_BASE;
+  uint32_t count = align_up(audio->count, 16);
+  int16_t l[0x800], r[0x800];
+  int16_t *dst;
+  uint32_t i;
+
+  if (audio->count == 0)
+    return;
+
+  count = buffer_span(left, count);
+  count = buffer_span(right, count);
+  count = buffer_span(audio->out, count * 2) >> 1;
+
+  // The output can overlap either input.
+  memcpy(l, buffer_s16(audio, left), count);
+  memcpy(r, buffer_s16(audio, right), count);
+  dst = buffer_s16(audio, audio->out);
+
+  for (i = 0; i < count >> 1; i++) {
+    dst[i * 2 + 0] = l[i];
+    dst[i * 2 + 1] = r[i];
+  }
+}
+
+// Filters the input buffer into the output with two poles, taking
+// the taps from the ADPCM table: the first 8 entries weigh the older
+// of the previous two outputs, the next 8 the newer one. The microcode
+// scales that second set by the gain in place to weigh inputs within
+// a group, so the table is left that way. The last 4 outputs are kept
+// in RDRAM for the next task.
+static void audio_polef(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  uint8_t flags = w1 >> 16;
+  int16_t gain = w1;
+  uint32_t address = segment_address(audio, w2);
+  uint16_t src = audio->in;
+  uint32_t count = align_up(audio->count, 16);
+  int16_t *taps = audio->table + 8;
+  int16_t newer_taps[8];
+  struct predictor predictor;
+  int16_t history[8];
+  int16_t *dst;
+  unsigned i;
+
+  if (audio->count == 0 || !rdram_span_ok(address, 8))
+    return;
+
+  count = buffer_span(audio->in, count);
+  count = buffer_span(audio->out, count) & ~0xFU;
+
+  if (count == 0)
+    return;
+
+  memset(history, 0, sizeof(history));
+
+  if (!(flags & A_INIT)) {
+    for (i = 0; i < 4; i++)
+      history[4 + i] = rdram_s16(rsp, address + 2 * i);
+  }
+
+  memcpy(newer_taps, taps, sizeof(newer_taps));
+
+  for (i = 0; i < 8; i++)
+    taps[i] = ((int32_t) taps[i] * gain) >> 14;
+
+  predictor.older_taps = audio->table;
+  predictor.newer_taps = newer_taps;
+  predictor.input_taps = taps;
+  predictor.gain = gain;
+  predictor.shift = 14;
+
+  for (dst = buffer_s16(audio, audio->out); count != 0; count -= 16) {
+    int16_t in[8];
+
+    // The output may well be the input.
+    memcpy(in, buffer_s16(audio, src), sizeof(in));
+    src += 16;
+
+    predict_8(&predictor, history, in, history[6], history[7]);
+    memcpy(dst, history, sizeof(history));
+    dst += 8;
+  }
+
+  for (i = 0; i < 4; i++)
+    rdram_store_s16(rsp, address + 2 * i, history[4 + i]);
+}
+
+static void audio_setloop(struct rsp *rsp,
+  struct rsp_hle_audio *audio, uint32_t w1, uint32_t w2) {
+  audio->loop = segment_address(audio, w2);
+}
+
+static const audio_command audio_abi1_commands[0x10] = {
+  audio_spnoop,     audio_adpcm,      audio_clearbuff,  audio_envmixer,
+  audio_loadbuff,   audio_resample,   audio_savebuff,   audio_segment,
+  audio_setbuff,    audio_setvol,     audio_dmemmove,   audio_loadadpcm,
+  audio_mixer,      audio_interleave, audio_polef,      audio_setloop,
+};
+
+// Walks an audio command list, as an ABI 1 microcode would.
+void rsp_hle_process_audio(struct rsp *rsp, const struct rsp_task *task) {
+  struct rsp_hle_audio *audio = &rsp->hle->audio;
+  uint32_t alist = task->data_ptr & 0x7FFFF8;
+  uint32_t length = task->data_size & ~0x7U;
+  uint32_t i;
+
+  if (unlikely(!resample_lut_ready))
+    build_resample_lut();
+
+  if (!rdram_span_ok(alist, length))
+    return;
+
+  memset(audio->segments, 0, sizeof(audio->segments));
+
+  for (i = 0; i < length; i += 8) {
+    uint32_t w1, w2;
+
+    memcpy(&w1, rsp->bus->ri->ram + alist + i + 0, sizeof(w1));
+    memcpy(&w2, rsp->bus->ri->ram + alist + i + 4, sizeof(w2));
+    w1 = byteswap_32(w1);
+    w2 = byteswap_32(w2);
+
+    if (((w1 >> 24) & 0x7F) < 0x10)
+      audio_abi1_commands[(w1 >> 24) & 0x7F](rsp, audio, w1, w2);
+  }
+}
+
@@ -9,17 +9,31 @@
 //
 
 #include "common.h"
+#include "common/byteswap.h"
 #include "bus/address.h"
 #include "bus/controller.h"
+#include "ri/controller.h"
 #include "rsp/cp0.h"
 #include "rsp/cpu.h"
 #include "rsp/interface.h"
+#include "rsp/profile.h"
+#include "rsp/rsp.h"
+
+// Flags IMEM words so that they get redecoded on the next fetch.
+static void rsp_invalidate_imem(struct rsp *rsp,
+  uint32_t offset, uint32_t length) {
+  unsigned i, first = offset >> 2, last = (offset + length) >> 2;
+
+  for (i = first; i < last; i++)
+    rsp->imem_dirty[i >> 5] |= 1U << (i & 0x1F);
+}
 
 // DMA into the RSP's memory space.
 void rsp_dma_read(struct rsp *rsp) {
   uint32_t length = (rsp->regs[RSP_CP0_REGISTER_DMA_READ_LENGTH] & 0xFFF) + 1;
   uint32_t skip = rsp->regs[RSP_CP0_REGISTER_DMA_READ_LENGTH] >> 20 & 0xFFF;
   unsigned count = rsp->regs[RSP_CP0_REGISTER_DMA_READ_LENGTH] >> 12 & 0xFF;
+  const uint8_t *ram = rsp->bus->ri->ram;
   unsigned j, i = 0;
 
   // Force alignment.
@@ -31,28 +45,40 @@ void rsp_dma_read(struct rsp *rsp) {
   if (((rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0xFFF) + length) > 0x1000)
     length = 0x1000 - (rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0xFFF);
 
+  // Only count transfers issued by the task itself.
+  if (unlikely(rsp->profile != NULL) &&
+    !(rsp->regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_HALT))
+    rsp_profile_dma(rsp->profile, length * (count + 1), false);
+
   do {
     uint32_t source = rsp->regs[RSP_CP0_REGISTER_DMA_DRAM] & 0x7FFFFC;
     uint32_t dest = rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0x1FFC;
     j = 0;
 
+    // Copy the row in as few pieces as possible; a piece
+    // ends where RDRAM or the destination memory wraps.
     do {
       uint32_t source_addr = (source + j) & 0x7FFFFC;
       uint32_t dest_addr = (dest + j) & 0x1FFC;
-      uint32_t word;
+      uint32_t chunk = length - j;
+
+      if (chunk > 0x1000 - (dest_addr & 0xFFF))
+        chunk = 0x1000 - (dest_addr & 0xFFF);
 
-      bus_read_word(rsp->bus, source_addr, &word);
+      if (chunk > MAX_RDRAM_SIZE - source_addr)
+        chunk = MAX_RDRAM_SIZE - source_addr;
 
-      // Update opcode cache.
+      // IMEM holds instruction words in host order, whereas
+      // RDRAM (and DMEM) are big-endian.
       if (dest_addr & 0x1000) {
-        rsp->opcode_cache[(dest_addr - 0x1000) >> 2] =
-          *rsp_decode_instruction(word);
-      } else {
-        word = byteswap_32(word);
+        byteswap_copy_32(rsp->mem + dest_addr, ram + source_addr, chunk);
+        rsp_invalidate_imem(rsp, dest_addr - 0x1000, chunk);
       }
 
-      memcpy(rsp->mem + dest_addr, &word, sizeof(word));
-      j += 4;
+      else
+        memcpy(rsp->mem + dest_addr, ram + source_addr, chunk);
+
+      j += chunk;
     } while (j < length);
 
     rsp->regs[RSP_CP0_REGISTER_DMA_DRAM] += length + skip;
@@ -65,6 +91,7 @@ void rsp_dma_write(struct rsp *rsp) {
   uint32_t length = (rsp->regs[RSP_CP0_REGISTER_DMA_WRITE_LENGTH] & 0xFFF) + 1;
   uint32_t skip = rsp->regs[RSP_CP0_REGISTER_DMA_WRITE_LENGTH] >> 20 & 0xFFF;
   unsigned count = rsp->regs[RSP_CP0_REGISTER_DMA_WRITE_LENGTH] >> 12 & 0xFF;
+  uint8_t *ram = rsp->bus->ri->ram;
   unsigned j, i = 0;
 
   // Force alignment.
@@ -76,6 +103,10 @@ void rsp_dma_write(struct rsp *rsp) {
   if (((rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0xFFF) + length) > 0x1000)
     length = 0x1000 - (rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0xFFF);
 
+  if (unlikely(rsp->profile != NULL) &&
+    !(rsp->regs[RSP_CP0_REGISTER_SP_STATUS] & SP_STATUS_HALT))
+    rsp_profile_dma(rsp->profile, length * (count + 1), true);
+
   do {
     uint32_t dest = rsp->regs[RSP_CP0_REGISTER_DMA_DRAM] & 0x7FFFFC;
     uint32_t source = rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] & 0x1FFC;
@@ -84,15 +115,22 @@ void rsp_dma_write(struct rsp *rsp) {
     do {
       uint32_t source_addr = (source + j) & 0x1FFC;
       uint32_t dest_addr = (dest + j) & 0x7FFFFC;
-      uint32_t word;
+      uint32_t chunk = length - j;
+
+      if (chunk > 0x1000 - (source_addr & 0xFFF))
+        chunk = 0x1000 - (source_addr & 0xFFF);
+
+      if (chunk > MAX_RDRAM_SIZE - dest_addr)
+        chunk = MAX_RDRAM_SIZE - dest_addr;
 
-      memcpy(&word, rsp->mem + source_addr, sizeof(word));
+      if (source_addr & 0x1000)
+        byteswap_copy_32(ram + dest_addr, rsp->mem + source_addr, chunk);
 
-      if (!(source_addr & 0x1000))
-        word = byteswap_32(word);
+      else
+        memcpy(ram + dest_addr, rsp->mem + source_addr, chunk);
 
-      bus_write_word(rsp->bus, dest_addr, word, ~0U);
-      j += 4;
+      ri_mark_dirty(rsp->bus->ri, dest_addr, chunk);
+      j += chunk;
     } while (j < length);
 
     rsp->regs[RSP_CP0_REGISTER_DMA_CACHE] += length;
@@ -146,11 +184,10 @@ int write_sp_mem(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
   unsigned offset = address & 0x1FFC;
 
   // Update opcode cache.
-  if (offset & 0x1000) {
-    rsp->opcode_cache[(offset - 0x1000) >> 2] = *rsp_decode_instruction(word);
-  } else {
+  if (offset & 0x1000)
+    rsp_invalidate_imem(rsp, offset - 0x1000, sizeof(word));
+  else
     word = byteswap_32(word);
-  }
 
   memcpy(rsp->mem + offset, &word, sizeof(word));
   return 0;
@@ -15,6 +15,7 @@
 #include "rsp/decoder.h"
 #include "rsp/opcodes.h"
 #include "rsp/pipeline.h"
+#include "rsp/profile.h"
 #include "rsp/rsp.h"
 
 // Prints out instructions and their address as they are executed.
@@ -33,6 +34,11 @@ static inline void rsp_if_stage(struct rsp *rsp) {
 
   memcpy(&iw, rsp->mem + 0x1000 + pc, sizeof(iw));
 
+  if (unlikely(rsp->imem_dirty[pc >> 7] & (1U << (pc >> 2 & 0x1F)))) {
+    rsp->opcode_cache[pc >> 2] = *rsp_decode_instruction(iw);
+    rsp->imem_dirty[pc >> 7] &= ~(1U << (pc >> 2 & 0x1F));
+  }
+
   ifrd_latch->common.pc = pc;
   ifrd_latch->opcode = rsp->opcode_cache[pc >> 2];
   ifrd_latch->iw = iw;
@@ -219,6 +225,9 @@ static inline bool rsp_wb_stage(struct rsp *rsp) {
 
 // Advances the processor pipeline by one clock.
 void rsp_cycle_(struct rsp *rsp) {
+  if (unlikely(rsp->profile != NULL))
+    rsp_profile_sample(rsp->profile, rsp->pipeline.rdex_latch.common.pc);
+
   if (unlikely(!rsp_wb_stage(rsp)))
     return;
   rsp_df_stage(rsp);
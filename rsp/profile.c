@@ -0,0 +1,105 @@
+//
+// rsp/profile.c: RSP task profiler.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "rsp/profile.h"
+#include "rsp/task.h"
+
+// Allocates a zeroed profile.
+struct rsp_profile *rsp_profile_alloc(void) {
+  return calloc(1, sizeof(struct rsp_profile));
+}
+
+// Releases memory acquired for the profile.
+void rsp_profile_free(struct rsp_profile *profile) {
+  free(profile);
+}
+
+// Looks up (or creates) the entry for a task; called on each SP start.
+void rsp_profile_task_start(struct rsp_profile *profile,
+  const struct rsp_task *task) {
+  struct rsp_profile_entry *entry;
+  unsigned i;
+
+  for (i = 0; i < profile->num_entries; i++) {
+    entry = profile->entries + i;
+
+    if (entry->ucode_hash == task->ucode_hash &&
+      entry->task_type == task->type)
+      break;
+  }
+
+  if (i == profile->num_entries) {
+    if (profile->num_entries == RSP_PROFILE_MAX_ENTRIES) {
+      profile->current = NULL;
+      profile->dropped_tasks++;
+      return;
+    }
+
+    entry = profile->entries + profile->num_entries++;
+    entry->ucode_hash = task->ucode_hash;
+    entry->task_type = task->type;
+    entry->ucode = task->ucode;
+  }
+
+  entry->tasks++;
+  profile->current = entry;
+}
+
+// Writes out a summary followed by the per-PC hit counts.
+void rsp_profile_dump(const struct rsp_profile *profile, FILE *f) {
+  uint64_t total_cycles = 0;
+  unsigned i, j;
+
+  for (i = 0; i < profile->num_entries; i++)
+    total_cycles += profile->entries[i].cycles;
+
+  fprintf(f, "# RSP task profile\n");
+  fprintf(f, "# %-16s %-7s %-8s %10s %14s %10s %6s %12s %12s\n",
+    "ucode_hash", "type", "ucode", "tasks", "cycles", "cyc/task",
+    "share", "dma_rd", "dma_wr");
+
+  for (i = 0; i < profile->num_entries; i++) {
+    const struct rsp_profile_entry *entry = profile->entries + i;
+    double share = total_cycles
+      ? 100.0 * entry->cycles / total_cycles : 0.0;
+
+    fprintf(f, "  %.16llX %-7s %.8X %10llu %14llu %10llu %5.1f%% %12llu %12llu\n",
+      (unsigned long long) entry->ucode_hash,
+      rsp_task_type_name(entry->task_type), entry->ucode,
+      (unsigned long long) entry->tasks,
+      (unsigned long long) entry->cycles,
+      (unsigned long long) (entry->tasks ? entry->cycles / entry->tasks : 0),
+      share,
+      (unsigned long long) entry->dma_read_bytes,
+      (unsigned long long) entry->dma_write_bytes);
+  }
+
+  if (profile->dropped_tasks)
+    fprintf(f, "# %llu tasks not profiled (too many distinct microcodes)\n",
+      (unsigned long long) profile->dropped_tasks);
+
+  for (i = 0; i < profile->num_entries; i++) {
+    const struct rsp_profile_entry *entry = profile->entries + i;
+
+    fprintf(f, "\n# %.16llX %s: pc hits\n",
+      (unsigned long long) entry->ucode_hash,
+      rsp_task_type_name(entry->task_type));
+
+    for (j = 0; j < sizeof(entry->pc_hits) / sizeof(*entry->pc_hits); j++) {
+      if (entry->pc_hits[j] == 0)
+        continue;
+
+      fprintf(f, "%.3X %llu\n", j << 2,
+        (unsigned long long) entry->pc_hits[j]);
+    }
+  }
+}
+
@@ -0,0 +1,76 @@
+//
+// rsp/profile.h: RSP task profiler.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rsp_profile_h__
+#define __rsp_profile_h__
+#include "common.h"
+#include "rsp/task.h"
+
+#define RSP_PROFILE_MAX_ENTRIES 64
+
+struct rsp;
+
+// Counters for one (microcode, task type) pair.
+struct rsp_profile_entry {
+  uint64_t ucode_hash;
+  uint32_t task_type;
+  uint32_t ucode;
+
+  uint64_t tasks;
+  uint64_t cycles;
+  uint64_t dma_read_bytes;
+  uint64_t dma_write_bytes;
+
+  // One counter per IMEM word.
+  uint64_t pc_hits[0x1000 / 4];
+};
+
+struct rsp_profile {
+  struct rsp_profile_entry *current;
+  uint64_t dropped_tasks;
+
+  unsigned num_entries;
+  struct rsp_profile_entry entries[RSP_PROFILE_MAX_ENTRIES];
+};
+
+cen64_cold struct rsp_profile *rsp_profile_alloc(void);
+cen64_cold void rsp_profile_free(struct rsp_profile *profile);
+cen64_cold void rsp_profile_dump(const struct rsp_profile *profile, FILE *f);
+
+void rsp_profile_task_start(struct rsp_profile *profile,
+  const struct rsp_task *task);
+
+// Called once per (unhalted) RSP cycle.
+static inline void rsp_profile_sample(struct rsp_profile *profile,
+  uint32_t pc) {
+  struct rsp_profile_entry *entry = profile->current;
+
+  if (likely(entry != NULL)) {
+    entry->pc_hits[(pc & 0xFFC) >> 2]++;
+    entry->cycles++;
+  }
+}
+
+// Called for each RSP DMA with the number of bytes moved.
+static inline void rsp_profile_dma(struct rsp_profile *profile,
+  uint32_t bytes, bool to_rdram) {
+  struct rsp_profile_entry *entry = profile->current;
+
+  if (entry == NULL)
+    return;
+
+  if (to_rdram)
+    entry->dma_write_bytes += bytes;
+  else
+    entry->dma_read_bytes += bytes;
+}
+
+#endif
+
@@ -0,0 +1,103 @@
+//
+// rsp/task.c: RSP task (OSTask) identification.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#include "common.h"
+#include "bus/controller.h"
+#include "ri/controller.h"
+#include "rsp/cpu.h"
+#include "rsp/task.h"
+
+#define FNV64_OFFSET_BASIS 0xCBF29CE484222325ULL
+#define FNV64_PRIME 0x00000100000001B3ULL
+
+static const char *rsp_task_type_names[NUM_RSP_TASK_TYPES] = {
+  "unknown", "gfx", "audio", "video",
+  "njpeg", "type5", "type6", "type7",
+};
+
+// Reads a (big-endian) word from DMEM.
+static uint32_t rsp_dmem_word(const struct rsp *rsp, uint32_t offset) {
+  uint32_t word;
+
+  memcpy(&word, rsp->mem + (offset & 0xFFC), sizeof(word));
+  return byteswap_32(word);
+}
+
+// Hashes the text that the boot microcode will copy into IMEM.
+// Words are folded in by value, so the hash is host-independent.
+static uint64_t rsp_hash_rdram_text(const uint8_t *ram,
+  uint32_t addr, uint32_t size) {
+  uint64_t hash = FNV64_OFFSET_BASIS;
+  uint32_t i;
+
+  for (i = 0; i < size; i += 4) {
+    uint32_t word;
+
+    memcpy(&word, ram + addr + i, sizeof(word));
+    hash = (hash ^ byteswap_32(word)) * FNV64_PRIME;
+  }
+
+  return hash;
+}
+
+// Hashes IMEM as-is (opcodes are kept in host order).
+static uint64_t rsp_hash_imem(const struct rsp *rsp) {
+  uint64_t hash = FNV64_OFFSET_BASIS;
+  uint32_t i;
+
+  for (i = 0; i < 0x1000; i += 4) {
+    uint32_t word;
+
+    memcpy(&word, rsp->mem + 0x1000 + i, sizeof(word));
+    hash = (hash ^ word) * FNV64_PRIME;
+  }
+
+  return hash;
+}
+
+// Reads the OSTask header out of DMEM and identifies the microcode.
+// Tasks that weren't set up by libultra fall back to an IMEM hash.
+void rsp_task_read(const struct rsp *rsp, struct rsp_task *task) {
+  const uint8_t *ram = rsp->bus->ri->ram;
+  uint32_t size;
+
+  task->type = rsp_dmem_word(rsp, RSP_OSTASK_OFFSET + RSP_OSTASK_TYPE);
+  task->flags = rsp_dmem_word(rsp, RSP_OSTASK_OFFSET + RSP_OSTASK_FLAGS);
+  task->ucode = rsp_dmem_word(rsp, RSP_OSTASK_OFFSET + RSP_OSTASK_UCODE);
+  task->ucode_size = rsp_dmem_word(rsp, RSP_OSTASK_OFFSET + RSP_OSTASK_UCODE_SIZE);
+  task->ucode_data = rsp_dmem_word(rsp, RSP_OSTASK_OFFSET + RSP_OSTASK_UCODE_DATA);
+  task->data_ptr = rsp_dmem_word(rsp, RSP_OSTASK_OFFSET + RSP_OSTASK_DATA_PTR);
+  task->data_size = rsp_dmem_word(rsp, RSP_OSTASK_OFFSET + RSP_OSTASK_DATA_SIZE);
+
+  size = task->ucode_size;
+
+  if (size == 0 || size > RSP_UCODE_TEXT_MAX_SIZE)
+    size = RSP_UCODE_TEXT_MAX_SIZE;
+
+  task->ucode &= 0x7FFFF8;
+  size &= ~0x3U;
+
+  if (task->type == RSP_TASK_UNKNOWN || task->type >= NUM_RSP_TASK_TYPES ||
+    task->ucode == 0 || task->ucode + size > MAX_RDRAM_SIZE) {
+    task->type = RSP_TASK_UNKNOWN;
+    task->ucode_hash = rsp_hash_imem(rsp);
+  }
+
+  else
+    task->ucode_hash = rsp_hash_rdram_text(ram, task->ucode, size);
+}
+
+// Returns a printable name for an OSTask type.
+const char *rsp_task_type_name(uint32_t type) {
+  return type < NUM_RSP_TASK_TYPES
+    ? rsp_task_type_names[type]
+    : rsp_task_type_names[RSP_TASK_UNKNOWN];
+}
+
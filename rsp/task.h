@@ -0,0 +1,57 @@
+//
+// rsp/task.h: RSP task (OSTask) identification.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef __rsp_task_h__
+#define __rsp_task_h__
+#include "common.h"
+
+// libultra leaves an OSTask structure at the end of DMEM before
+// it starts the RSP; the boot microcode uses it to fetch the task.
+#define RSP_OSTASK_OFFSET         0xFC0
+#define RSP_OSTASK_TYPE           0x00
+#define RSP_OSTASK_FLAGS          0x04
+#define RSP_OSTASK_UCODE_BOOT     0x08
+#define RSP_OSTASK_UCODE          0x10
+#define RSP_OSTASK_UCODE_SIZE     0x14
+#define RSP_OSTASK_UCODE_DATA     0x18
+#define RSP_OSTASK_DATA_PTR       0x30
+#define RSP_OSTASK_DATA_SIZE      0x34
+
+// The boot microcode copies the task's text to IMEM+0x80.
+#define RSP_UCODE_TEXT_MAX_SIZE   0xF80
+
+enum rsp_task_type {
+  RSP_TASK_UNKNOWN = 0,
+  RSP_TASK_GFX = 1,
+  RSP_TASK_AUDIO = 2,
+  RSP_TASK_VIDEO = 3,
+  RSP_TASK_NJPEG = 4,
+  NUM_RSP_TASK_TYPES = 8
+};
+
+struct rsp;
+
+struct rsp_task {
+  uint64_t ucode_hash;
+
+  uint32_t type;
+  uint32_t flags;
+  uint32_t ucode;
+  uint32_t ucode_size;
+  uint32_t ucode_data;
+  uint32_t data_ptr;
+  uint32_t data_size;
+};
+
+void rsp_task_read(const struct rsp *rsp, struct rsp_task *task);
+const char *rsp_task_type_name(uint32_t type);
+
+#endif
+
@@ -382,6 +382,7 @@ int write_si_regs(void *opaque, uint32_t address, uint32_t word, uint32_t dqm) {
     pif_process(si);
     memcpy(si->bus->ri->ram + offset,
       si->ram, sizeof(si->ram));
+    ri_mark_dirty(si->bus->ri, offset, sizeof(si->ram));
 
     signal_rcp_interrupt(si->bus->vr4300, MI_INTR_SI);
     si->regs[SI_STATUS_REG] |= 0x1000;
@@ -0,0 +1,272 @@
+//
+// cen64-rdp-replay: Replays RDP traces recorded with -rdp-capture.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Runs the command lists of a trace through the RDP, without the
+// VR4300 or the RSP, and reports how fast they were rasterized.
+// The hashes of the final color image and of RDRAM identify the
+// output, so two builds of the RDP can be compared on a trace.
+// With -stats, the RDP's workload counters are printed as well.
+//
+
+#include "common.h"
+#include "device/device.h"
+#include "rdp/capture.h"
+#include "rdp/cpu.h"
+#include "rdp/stats.h"
+#include "timer.h"
+#include "vr4300/interface.h"
+
+#define DP_STATUS_XBUS_DMA 0x1
+
+cen64_cold int angrylion_rdp_init(struct cen64_device *device);
+void rdp_get_color_image(uint32_t *address, uint32_t *length);
+void rdp_process_list(void);
+
+// The RDP raises DP interrupts on SYNC_FULL; there's no CPU to take them.
+void signal_rcp_interrupt(struct vr4300 *vr4300, enum rcp_interrupt_mask mask) {
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+  uint32_t word;
+
+  memcpy(&word, p, sizeof(word));
+  return byteswap_32(word);
+}
+
+static uint64_t hash_bytes(const uint8_t *bytes, size_t length) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  size_t i;
+
+  for (i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ULL;
+  }
+
+  return hash;
+}
+
+// Reads the whole trace, so that I/O isn't part of the timings.
+static uint8_t *load_trace(const char *path, size_t *size) {
+  uint8_t *data;
+  long length;
+  FILE *f;
+
+  if ((f = fopen(path, "rb")) == NULL) {
+    printf("Can't open %s\n", path);
+    return NULL;
+  }
+
+  if (fseek(f, 0, SEEK_END) || (length = ftell(f)) < 0 ||
+    fseek(f, 0, SEEK_SET)) {
+    printf("Can't determine the size of %s\n", path);
+    fclose(f);
+    return NULL;
+  }
+
+  if ((data = malloc(length ? length : 1)) == NULL) {
+    printf("Failed to allocate memory for %s\n", path);
+    fclose(f);
+    return NULL;
+  }
+
+  if (fread(data, 1, length, f) != (size_t) length) {
+    printf("Failed to read %s\n", path);
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+
+  fclose(f);
+  *size = length;
+  return data;
+}
+
+// Hands words to the RDP the way the RSP does: through DMEM.
+static void run_commands(struct cen64_device *device,
+  const uint8_t *words, uint32_t count) {
+  while (count) {
+    uint32_t chunk = count > 0x400 ? 0x400 : count;
+
+    memcpy(device->rsp.mem, words, chunk * 4);
+    device->rdp.regs[DPC_STATUS_REG] |= DP_STATUS_XBUS_DMA;
+    device->rdp.regs[DPC_START_REG] = 0;
+    device->rdp.regs[DPC_CURRENT_REG] = 0;
+    device->rdp.regs[DPC_END_REG] = chunk * 4;
+    rdp_process_list();
+
+    words += chunk * 4;
+    count -= chunk;
+  }
+}
+
+static void print_usage(const char *argv0) {
+  printf("Usage: %s [-hashes] [-stats] <trace>\n\n"
+    "  -hashes     : Only print hashes (for diffing two builds).\n"
+    "  -stats      : Also print the RDP workload counters.\n",
+    argv0);
+}
+
+int main(int argc, const char *argv[]) {
+  const char *path = NULL;
+  bool hashes_only = false;
+  bool print_stats = false;
+  bool corrupt = false;
+
+  struct cen64_device *device;
+  uint64_t lists = 0, words = 0, pages = 0;
+  unsigned long long ns = 0;
+  uint32_t fb_address, fb_length;
+  size_t size, offset;
+  uint8_t *trace;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-hashes"))
+      hashes_only = true;
+
+    else if (!strcmp(argv[i], "-stats"))
+      print_stats = true;
+
+    else if (path == NULL && argv[i][0] != '-')
+      path = argv[i];
+
+    else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (path == NULL) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  if ((trace = load_trace(path, &size)) == NULL)
+    return 1;
+
+  if (size < sizeof(struct rdp_capture_header) ||
+    read_be32(trace + 0) != RDP_CAPTURE_MAGIC ||
+    read_be32(trace + 4) != RDP_CAPTURE_VERSION ||
+    read_be32(trace + 8) != MAX_RDRAM_SIZE ||
+    read_be32(trace + 12) != RDP_CAPTURE_PAGE_SIZE) {
+    printf("%s is not a (supported) RDP trace.\n", path);
+    free(trace);
+    return 1;
+  }
+
+  if ((device = calloc(1, sizeof(*device))) == NULL) {
+    printf("Failed to allocate memory for a device.\n");
+    free(trace);
+    return 1;
+  }
+
+  // The pixel counts come from the statistics, so they're always on.
+  if ((device->rdp.stats = rdp_stats_alloc()) == NULL) {
+    printf("Failed to allocate memory for the RDP statistics.\n");
+    free(device);
+    free(trace);
+    return 1;
+  }
+
+  angrylion_rdp_init(device);
+
+  offset = sizeof(struct rdp_capture_header);
+
+  while (!corrupt && offset + sizeof(struct rdp_capture_record) <= size) {
+    uint32_t type = read_be32(trace + offset);
+    uint32_t arg = read_be32(trace + offset + 4);
+    offset += sizeof(struct rdp_capture_record);
+
+    switch (type) {
+      case RDP_CAPTURE_RECORD_PAGE:
+        if (size - offset < RDP_CAPTURE_PAGE_SIZE ||
+          arg > MAX_RDRAM_SIZE - RDP_CAPTURE_PAGE_SIZE) {
+          corrupt = true;
+          break;
+        }
+
+        memcpy(device->ri.ram + arg, trace + offset, RDP_CAPTURE_PAGE_SIZE);
+        offset += RDP_CAPTURE_PAGE_SIZE;
+        pages++;
+        break;
+
+      case RDP_CAPTURE_RECORD_COMMANDS: {
+        cen64_time start, end;
+
+        if ((size - offset) / 4 < arg) {
+          corrupt = true;
+          break;
+        }
+
+        get_time(&start);
+        run_commands(device, trace + offset, arg);
+        get_time(&end);
+
+        ns += compute_time_difference(&end, &start);
+        offset += (size_t) arg * 4;
+        words += arg;
+        break;
+      }
+
+      case RDP_CAPTURE_RECORD_END:
+        lists++;
+        break;
+
+      default:
+        corrupt = true;
+        break;
+    }
+  }
+
+  if (offset != size)
+    corrupt = true;
+
+  if (corrupt)
+    printf("%s: Trace is truncated or corrupt; stopped after %llu lists.\n",
+      path, (unsigned long long) lists);
+
+  rdp_get_color_image(&fb_address, &fb_length);
+
+  if (!hashes_only) {
+    uint64_t pixels = rdp_stats_pixels(&device->rdp.stats->total);
+
+    printf("%s\n\n"
+      "  Lists         : %llu\n"
+      "  Command words : %llu\n"
+      "  RDRAM pages   : %llu\n"
+      "  SYNC_FULLs    : %llu\n"
+      "  Pixels        : %llu\n"
+      "  Time (ms)     : %.3f\n"
+      "  Mpixels/s     : %.3f\n\n",
+      path,
+      (unsigned long long) lists,
+      (unsigned long long) words,
+      (unsigned long long) pages,
+      (unsigned long long) device->rdp.stats->sync_fulls,
+      (unsigned long long) pixels,
+      ns / 1e6,
+      ns ? pixels * 1e3 / ns : 0.0);
+
+    if (print_stats) {
+      rdp_stats_dump(device->rdp.stats, stdout);
+      printf("\n");
+    }
+  }
+
+  printf("framebuffer %08X+%X %016llX\n", fb_address, fb_length,
+    (unsigned long long) hash_bytes(device->ri.ram + fb_address, fb_length));
+  printf("rdram %016llX\n", (unsigned long long)
+    hash_bytes(device->ri.ram, MAX_RDRAM_SIZE));
+
+  rdp_stats_free(device->rdp.stats);
+  free(device);
+  free(trace);
+  return corrupt ? 1 : 0;
+}
+
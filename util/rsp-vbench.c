@@ -0,0 +1,214 @@
+//
+// cen64-rsp-vbench: RSP vector kernel benchmark and differential harness.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Drives every entry of rsp_vector_function_table with randomized
+// vector registers, accumulator and flags. For each opcode it prints
+// a hash of everything the kernel left behind, plus the time taken
+// per instruction. Two builds of the kernels (e.g., SSE2 and AVX,
+// or x86_64 and ARM) are equivalent iff their hashes match.
+//
+
+#include "common.h"
+#include "rsp/cpu.h"
+#include "rsp/decoder.h"
+#include "rsp/opcodes.h"
+#include "rsp/rsp.h"
+#include "timer.h"
+
+#define RSP_VBENCH_VARIANTS 64
+
+static struct rsp rsp;
+static uint64_t rng_state;
+
+void cen64_return(struct bus_controller *bus) {
+  abort();
+}
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return (uint32_t) rng_state;
+}
+
+// Biased towards the values that tend to break clamping.
+static uint16_t rng_element(void) {
+  static const uint16_t edges[8] = {
+    0x0000, 0x0001, 0x7FFE, 0x7FFF, 0x8000, 0x8001, 0xFFFE, 0xFFFF
+  };
+
+  uint32_t r = rng();
+  return (r & 0x3) ? (uint16_t) (r >> 16) : edges[r >> 2 & 0x7];
+}
+
+// Fills the vector unit with random state. Flags are always
+// either all-set or all-clear per lane, as the hardware keeps them.
+static void randomize_cp2(void) {
+  unsigned i, j;
+
+  for (i = 0; i < 32; i++) {
+    for (j = 0; j < 8; j++)
+      rsp.cp2.regs[i].e[j] = rng_element();
+  }
+
+  for (i = 0; i < 24; i++)
+    rsp.cp2.acc.e[i] = rng_element();
+
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 16; j++)
+      rsp.cp2.flags[i].e[j] = (rng() & 0x1) ? 0xFFFF : 0x0000;
+  }
+
+  rsp.cp2.div_in = rng_element();
+  rsp.cp2.div_out = rng_element();
+  rsp.cp2.dp_flag = rng() & 0x1;
+}
+
+static uint64_t hash_cp2(uint64_t hash) {
+  const uint8_t *bytes[6] = {
+    (const uint8_t *) rsp.cp2.regs,
+    (const uint8_t *) rsp.cp2.acc.e,
+    (const uint8_t *) rsp.cp2.flags,
+    (const uint8_t *) &rsp.cp2.div_out,
+    (const uint8_t *) &rsp.cp2.div_in,
+    (const uint8_t *) &rsp.cp2.dp_flag,
+  };
+
+  size_t sizes[6] = {
+    sizeof(rsp.cp2.regs),
+    sizeof(rsp.cp2.acc.e),
+    sizeof(rsp.cp2.flags),
+    sizeof(rsp.cp2.div_out),
+    sizeof(rsp.cp2.div_in),
+    sizeof(rsp.cp2.dp_flag),
+  };
+
+  unsigned i;
+  size_t j;
+
+  for (i = 0; i < 6; i++) {
+    for (j = 0; j < sizes[i]; j++) {
+      hash ^= bytes[i][j];
+      hash *= 0x100000001B3ULL;
+    }
+  }
+
+  return hash;
+}
+
+// Does what the pipeline's EX stage does for a vector instruction.
+static inline void execute(uint32_t iw, rsp_vector_function function) {
+  rsp_vect_t vs_reg, vt_shuf_reg, vd_reg;
+
+  vs_reg = rsp_vect_load_unshuffled_operand(rsp.cp2.regs[GET_VS(iw)].e);
+  vt_shuf_reg = rsp_vect_load_and_shuffle_operand(
+    rsp.cp2.regs[GET_VT(iw)].e, GET_E(iw));
+
+  vd_reg = function(&rsp, iw, vt_shuf_reg, vs_reg, rsp_vzero());
+  rsp_vect_write_operand(rsp.cp2.regs[GET_VD(iw)].e, vd_reg);
+}
+
+// Returns an encoding of the opcode with random operands.
+static uint32_t random_iw(uint32_t funct) {
+  return 0x4A000000U | (rng() & 0x01FFFFC0U) | funct;
+}
+
+static void print_usage(const char *argv0) {
+  printf("Usage: %s [-hashes] [-iterations <n>] [-seed <n>]\n\n"
+    "  -hashes     : Only print hashes (for diffing two builds).\n"
+    "  -iterations : Randomized runs per opcode (default: 20000).\n"
+    "  -seed       : Seed for the operand generator.\n",
+    argv0);
+}
+
+int main(int argc, const char *argv[]) {
+  unsigned long long seed = 0x9E3779B97F4A7C15ULL;
+  unsigned long iterations = 20000;
+  bool hashes_only = false;
+
+  bool seen[NUM_RSP_VECTOR_OPCODES];
+  uint32_t funct;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-hashes"))
+      hashes_only = true;
+
+    else if (!strcmp(argv[i], "-iterations") && i + 1 < argc)
+      iterations = strtoul(argv[++i], NULL, 0);
+
+    else if (!strcmp(argv[i], "-seed") && i + 1 < argc)
+      seed = strtoull(argv[++i], NULL, 0);
+
+    else {
+      print_usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (!hashes_only)
+    printf("RSP vector kernels (%s, " CEN64_COMPILER ")\n\n"
+      "%-8s %-16s %s\n", CEN64_ARCH_DIR, "opcode", "hash", "ns/op");
+
+  memset(seen, 0, sizeof(seen));
+
+  // Every function table entry is reachable through some
+  // value of the funct field; walk them in encoding order.
+  for (funct = 0; funct < 0x40; funct++) {
+    const struct rsp_opcode *opcode = rsp_decode_instruction(0x4A000000U | funct);
+    rsp_vector_function function = rsp_vector_function_table[opcode->id];
+    uint32_t iws[RSP_VBENCH_VARIANTS];
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    unsigned long j;
+
+    if (!(opcode->flags & OPCODE_INFO_VECTOR) || seen[opcode->id] ||
+      !strcmp(rsp_vector_opcode_mnemonics[opcode->id], "VINVALID"))
+      continue;
+
+    seen[opcode->id] = true;
+    rng_state = seed ^ ((uint64_t) funct << 32);
+
+    // Differential part: fresh state every run.
+    for (j = 0; j < iterations; j++) {
+      uint32_t iw = random_iw(funct);
+
+      randomize_cp2();
+      execute(iw, function);
+      hash = hash_cp2(hash ^ iw);
+    }
+
+    printf("%-8s %016llX", rsp_vector_opcode_mnemonics[opcode->id],
+      (unsigned long long) hash);
+
+    // Timed part: let results feed back into the
+    // operands, as they would in a real microcode.
+    if (!hashes_only) {
+      cen64_time start, end;
+      unsigned long long ns;
+
+      for (j = 0; j < RSP_VBENCH_VARIANTS; j++)
+        iws[j] = random_iw(funct);
+
+      randomize_cp2();
+      get_time(&start);
+
+      for (j = 0; j < iterations * 16; j++)
+        execute(iws[j & (RSP_VBENCH_VARIANTS - 1)], function);
+
+      get_time(&end);
+      ns = compute_time_difference(&end, &start);
+      printf(" %8.3f", (double) ns / (iterations * 16));
+    }
+
+    printf("\n");
+  }
+
+  return 0;
+}
+
@@ -9,12 +9,14 @@
 //
 
 #include "common.h"
+#include "common/byteswap.h"
 #include "context.h"
 #include "bus/address.h"
 #include "bus/controller.h"
 #include "device/device.h"
 #include "os/main.h"
 #include "timer.h"
+#include "rdp/cpu.h"
 #include "ri/controller.h"
 #include "vi/controller.h"
 #include "vi/render.h"
@@ -59,10 +61,88 @@ int read_vi_regs(void *opaque, uint32_t address, uint32_t *word) {
   return 0;
 }
 
+// Copies part of a frame, putting 16-bit pixels in host order (so
+// that OpenGL doesn't have to swap them itself) if swap16 is set.
+static inline void vi_copy_pixels(uint8_t *dest, const uint8_t *src,
+  size_t length, bool swap16) {
+  if (swap16)
+    byteswap_copy_16(dest, src, length & ~(size_t) 1);
+  else
+    memcpy(dest, src, length);
+}
+
+// Copies the part of RDRAM that's being scanned out to a frame that's
+// handed to the renderer. If it's the same part of RDRAM as the last
+// time that frame was filled, only the blocks that were written to
+// since then are copied.
+static void vi_copy_frame(struct ri_controller *ri, struct cen64_frame *frame,
+  uint8_t bit, uint32_t origin, size_t size, bool swap16) {
+  uint32_t first, last, block;
+
+  if (size == 0) {
+    frame->size = 0;
+    return;
+  }
+
+  first = origin >> RDRAM_DIRTY_BLOCK_SHIFT;
+  last = (origin + size - 1) >> RDRAM_DIRTY_BLOCK_SHIFT;
+
+  if (origin != frame->origin || size != frame->size ||
+    swap16 != frame->swapped) {
+    // Clear before copying, as below: a write that lands during
+    // the copy leaves its block dirty for the next frame.
+    for (block = first; block <= last; block++)
+      ri->dirty[block] &= ~bit;
+
+    vi_copy_pixels(frame->data, ri->ram + origin, size, swap16);
+    frame->origin = origin;
+    frame->size = size;
+    frame->swapped = swap16;
+    return;
+  }
+
+  for (block = first; block <= last; block++) {
+    uint32_t start, end;
+
+    if (!(ri->dirty[block] & bit))
+      continue;
+
+    // Copy runs of dirty blocks at once.
+    for (start = block; block < last && (ri->dirty[block + 1] & bit); block++);
+
+    for (end = start; end <= block; end++)
+      ri->dirty[end] &= ~bit;
+
+    start <<= RDRAM_DIRTY_BLOCK_SHIFT;
+    end = (block + 1) << RDRAM_DIRTY_BLOCK_SHIFT;
+
+    if (start < origin)
+      start = origin;
+
+    if (end > origin + size)
+      end = origin + size;
+
+    // Keep halfwords whole (blocks may not line up with the origin).
+    if (swap16) {
+      start = origin + ((start - origin) & ~1U);
+      end = origin + ((end - origin + 1) & ~1U);
+
+      if (end > origin + size)
+        end = origin + size;
+    }
+
+    vi_copy_pixels(frame->data + (start - origin),
+      ri->ram + start, end - start, swap16);
+  }
+}
+
 // Advances the controller by one clock cycle.
 void vi_cycle(struct vi_controller *vi) {
   cen64_gl_window window;
+  struct cen64_frame *frame;
+  uint32_t origin;
   size_t copy_size;
+  unsigned type;
 
   unsigned counter;
   struct render_area *ra = &vi->render_area;
@@ -91,6 +171,18 @@ void vi_cycle(struct vi_controller *vi) {
   vi->field = !vi->field;
   window = vi->window;
 
+  if (unlikely(vi->bus->rdp->stats != NULL))
+    rdp_stats_frame(vi->bus->rdp->stats);
+
+  if (unlikely(vi->soft != NULL)) {
+    vi_soft_render(vi->soft, vi);
+
+    if (vi->dump) {
+      vi_dump_frame(vi->dump, vi_soft_output(vi->soft),
+        (vi->regs[VI_V_SYNC_REG] & 0x3FF) > 550);
+    }
+  }
+
   // Calculate the bounding positions.
   ra->x.start = vi->regs[VI_H_START_REG] >> 16 & 0x3FF;
   ra->x.end = vi->regs[VI_H_START_REG] & 0x3FF;
@@ -100,6 +192,38 @@ void vi_cycle(struct vi_controller *vi) {
   hcoeff = (float) (vi->regs[VI_X_SCALE_REG] & 0xFFF) / (1 << 10);
   vcoeff = (float) (vi->regs[VI_Y_SCALE_REG] & 0xFFF) / (1 << 10);
 
+  // Calculate the height and width of the frame.
+  ra->height =((ra->y.end - ra->y.start) >> 1) * vcoeff;
+  ra->width = ((ra->x.end - ra->x.start)) * hcoeff;
+  ra->hskip = vi->regs[VI_WIDTH_REG] - ra->width;
+  type = vi->regs[VI_STATUS_REG] & 0x3;
+
+  if (ra->width <= 0 || ra->height <= 0)
+    type = 0;
+
+  // Work out which part of RDRAM is displayed; only as much as the
+  // renderer will read (GL rows are 4-byte aligned).
+  memcpy(&bus, vi, sizeof(bus));
+  origin = vi->regs[VI_ORIGIN_REG] & MAX_RDRAM_SIZE_MASK;
+  copy_size = 0;
+
+  if (type >= 2) {
+    size_t bpp = type == 3 ? 4 : 2;
+    size_t pitch = ((ra->width + ra->hskip) * bpp + 3) & ~3;
+    copy_size = pitch * ra->height;
+  }
+
+  if (copy_size > sizeof(bus->ri->ram) - origin)
+    copy_size = sizeof(bus->ri->ram) - origin;
+
+  if (unlikely(bus->rdp->frameskip != NULL))
+    rdp_frameskip_field(bus->rdp->frameskip, origin, copy_size);
+
+  if (unlikely(vi->hash != NULL)) {
+    if (!vi_hash_frame(vi->hash, bus->ri->ram + origin, copy_size))
+      device_exit(vi->bus);
+  }
+
   // Interact with the user interface?
   if (likely(window)) {
     cen64_mutex_lock(&window->event_mutex);
@@ -110,30 +234,39 @@ void vi_cycle(struct vi_controller *vi) {
     }
 
     cen64_mutex_unlock(&window->event_mutex);
-    cen64_mutex_lock(&window->render_mutex);
-
-    // Calculate the height and width of the frame.
-    window->frame_vres = ra->height =((ra->y.end - ra->y.start) >> 1) * vcoeff;
-    window->frame_hres = ra->width = ((ra->x.end - ra->x.start)) * hcoeff;
-    window->frame_hskip = ra->hskip = vi->regs[VI_WIDTH_REG] - ra->width;
-    window->frame_type = vi->regs[VI_STATUS_REG] & 0x3;
-
-    if (window->frame_hres <= 0 || window->frame_vres <= 0)
-      window->frame_type = 0;
-
-    // Copy the frame data into a temporary buffer.
-    copy_size = sizeof(bus->ri->ram) - (vi->regs[VI_ORIGIN_REG] & MAX_RDRAM_SIZE_MASK);
+    frame = cen64_frame_queue_back(&window->frames);
+
+    frame->vres = ra->height;
+    frame->hres = ra->width;
+    frame->hskip = ra->hskip;
+    frame->type = type;
+
+    // The software VI's output is always shown as a 32-bit image.
+    if (vi->soft) {
+      memcpy(frame->data, vi_soft_output(vi->soft),
+        VI_SOFT_WIDTH * VI_SOFT_HEIGHT * 4);
+
+      frame->hres = VI_SOFT_WIDTH;
+      frame->vres = VI_SOFT_HEIGHT;
+      frame->hskip = 0;
+      frame->type = 3;
+      frame->size = 0;
+    }
 
-    if (copy_size > sizeof(vi->window->frame_buffer))
-      copy_size = sizeof(vi->window->frame_buffer);
+    // Otherwise, copy the frame data into the back frame.
+    else {
+      if (copy_size > FRAMEBUF_SZ)
+        copy_size = FRAMEBUF_SZ;
 
-    memcpy(&bus, vi, sizeof(bus));
-    memcpy(vi->window->frame_buffer,
-      bus->ri->ram + (vi->regs[VI_ORIGIN_REG] & MAX_RDRAM_SIZE_MASK),
-      copy_size);
+      vi_copy_frame(bus->ri, frame, 1 << (frame - window->frames.frames),
+        origin, copy_size, type == 2);
+    }
 
-    cen64_mutex_unlock(&vi->window->render_mutex);
-    cen64_gl_window_push_frame(window);
+    // Only wake the UI if it's drawn everything we've pushed so
+    // far; otherwise, it'll pick this frame up in place of the
+    // previous one, and we never block on it.
+    if (cen64_frame_queue_push(&window->frames))
+      cen64_gl_window_push_frame(window);
   }
 
   else if (++(vi->frame_count) == 60) {
@@ -147,17 +280,64 @@ void vi_cycle(struct vi_controller *vi) {
 
     printf("VI/s: %.2f\n", (60 / (ns / NS_PER_SEC)));
   }
+
+  if (vi->pace)
+    vi_pacer_wait(&vi->pacer, (vi->regs[VI_V_SYNC_REG] & 0x3FF) > 550);
+}
+
+// Releases memory acquired for the VI.
+void vi_destroy(struct vi_controller *vi) {
+  if (vi->pace)
+    vi_pacer_report(&vi->pacer);
+
+  if (vi->hash)
+    vi_hash_close(vi->hash);
+
+  if (vi->dump)
+    vi_dump_close(vi->dump);
+
+  if (vi->soft)
+    vi_soft_destroy(vi->soft);
 }
 
 // Initializes the VI.
-int vi_init(struct vi_controller *vi,
-  struct bus_controller *bus, bool no_interface) {
+int vi_init(struct vi_controller *vi, struct bus_controller *bus,
+  bool no_interface, unsigned soft_vi_threads, const char *dump_video_path,
+  const char *dump_video_format, bool dump_video_wait,
+  const char *hash_log_path, const char *hash_ref_path,
+  bool pace, bool unlimited) {
   vi->counter = VI_COUNTER_START;
   vi->bus = bus;
 
+  // Pacing is opt-in; -unlimited only starts it out in turbo.
+  vi->pace = pace || unlimited;
+  vi_pacer_init(&vi->pacer, unlimited);
+
+  if (soft_vi_threads) {
+    if ((vi->soft = vi_soft_create(soft_vi_threads)) == NULL)
+      return -1;
+  }
+
+  if (dump_video_path) {
+    if ((vi->dump = vi_dump_open(dump_video_path,
+      dump_video_format, dump_video_wait)) == NULL) {
+      vi_destroy(vi);
+      return -1;
+    }
+  }
+
+  if (hash_log_path || hash_ref_path) {
+    if ((vi->hash = vi_hash_open(hash_log_path, hash_ref_path)) == NULL) {
+      vi_destroy(vi);
+      return -1;
+    }
+  }
+
   if (!no_interface) {
-    if (vi_create_window(vi))
+    if (vi_create_window(vi)) {
+      vi_destroy(vi);
       return -1;
+    }
 
     gl_window_init(vi);
   }
@@ -17,6 +17,11 @@
 #include "gl_screen.h"
 #include "gl_window.h"
 #include "timer.h"
+#include "vi/dump.h"
+#include "vi/hash.h"
+#include "vi/pacer.h"
+#include "vi/soft.h"
+#include "vi/upload.h"
 
 enum vi_register {
 #define X(reg) reg,
@@ -58,17 +63,35 @@ struct vi_controller {
   cen64_gl_context context;
 
   struct render_area render_area;
+  struct vi_upload upload;
   float viuv[8];
   float quad[8];
 
+  // Set if the VI's output is produced in software (-soft-vi).
+  struct vi_soft *soft;
+
+  // Set if the VI's output is being recorded (-dump-video).
+  struct vi_dump *dump;
+
+  // Set if frames are being hashed (-vi-hash, -vi-hash-ref).
+  struct vi_hash *hash;
+
+  // Keeps emulation at real-time speed, if pace is set.
+  struct vi_pacer pacer;
+  bool pace;
+
   cen64_time last_update_time;
   unsigned intr_counter;
   unsigned frame_count;
   unsigned field;
 };
 
+cen64_cold void vi_destroy(struct vi_controller *vi);
 cen64_cold int vi_init(struct vi_controller *vi, struct bus_controller *bus,
-  bool no_interface);
+  bool no_interface, unsigned soft_vi_threads, const char *dump_video_path,
+  const char *dump_video_format, bool dump_video_wait,
+  const char *hash_log_path, const char *hash_ref_path,
+  bool pace, bool unlimited);
 
 cen64_flatten cen64_hot void vi_cycle(struct vi_controller *vi);
 
@@ -0,0 +1,275 @@
+//
+// vi/dump.c: VI output recording.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// The VI copies each frame into a ring of preallocated slots; a
+// writer thread converts them and writes each one out in a single
+// call. When the writer falls behind (a slow disk, a full pipe), the
+// VI drops frames rather than waiting, unless asked to wait.
+//
+
+#include "common.h"
+#include "thread.h"
+#include "vi/dump.h"
+#include "vi/soft.h"
+#include <signal.h>
+
+#ifdef _WIN32
+#define fdopen _fdopen
+#endif
+
+#define VI_DUMP_FRAME_SIZE (VI_SOFT_WIDTH * VI_SOFT_HEIGHT * 4)
+#define VI_DUMP_Y4M_SIZE (VI_SOFT_WIDTH * VI_SOFT_HEIGHT * 3 / 2)
+
+struct vi_dump {
+  uint8_t slots[VI_DUMP_SLOTS][VI_DUMP_FRAME_SIZE];
+  uint8_t yuv[VI_DUMP_Y4M_SIZE];
+
+  FILE *f;
+  enum vi_dump_format format;
+  bool wait;
+  bool pal;
+
+  cen64_thread thread;
+  cen64_mutex mutex;
+  cen64_cv filled_cv;
+  cen64_cv freed_cv;
+
+  // head is only touched by the VI, tail by the writer;
+  // count is shared and protected by the mutex.
+  unsigned head, tail, count;
+  bool exiting;
+  bool failed;
+
+  unsigned long long frames;
+  unsigned long long written;
+  unsigned long long dropped;
+};
+
+static CEN64_THREAD_RETURN_TYPE vi_dump_thread(void *opaque);
+
+// Converts an RGBA frame to planar 4:2:0 (BT.601, limited range).
+static void vi_dump_rgba_to_yuv(uint8_t *yuv, const uint8_t *rgba) {
+  uint8_t *y_plane = yuv;
+  uint8_t *u_plane = y_plane + VI_SOFT_WIDTH * VI_SOFT_HEIGHT;
+  uint8_t *v_plane = u_plane + VI_SOFT_WIDTH * VI_SOFT_HEIGHT / 4;
+  unsigned x, y;
+
+  for (y = 0; y < VI_SOFT_HEIGHT; y += 2) {
+    const uint8_t *top = rgba + y * VI_SOFT_WIDTH * 4;
+    const uint8_t *bottom = top + VI_SOFT_WIDTH * 4;
+
+    for (x = 0; x < VI_SOFT_WIDTH; x += 2) {
+      const uint8_t *p[4] = {top + x * 4, top + x * 4 + 4,
+        bottom + x * 4, bottom + x * 4 + 4};
+
+      int r = 0, g = 0, b = 0;
+      unsigned i;
+
+      for (i = 0; i < 4; i++) {
+        y_plane[(y + (i >> 1)) * VI_SOFT_WIDTH + x + (i & 1)] =
+          ((66 * p[i][0] + 129 * p[i][1] + 25 * p[i][2] + 128) >> 8) + 16;
+
+        r += p[i][0];
+        g += p[i][1];
+        b += p[i][2];
+      }
+
+      r = (r + 2) >> 2;
+      g = (g + 2) >> 2;
+      b = (b + 2) >> 2;
+
+      *u_plane++ = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+      *v_plane++ = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+  }
+}
+
+// Writes out one queued frame. Returns nonzero on error.
+static int vi_dump_write(struct vi_dump *dump, const uint8_t *rgba) {
+  if (dump->format == VI_DUMP_FORMAT_RAW)
+    return fwrite(rgba, VI_DUMP_FRAME_SIZE, 1, dump->f) != 1;
+
+  if (dump->written == 0) {
+    fprintf(dump->f, "YUV4MPEG2 W%u H%u %s Ip A1:1 C420jpeg\n",
+      VI_SOFT_WIDTH, VI_SOFT_HEIGHT, dump->pal ? "F50:1" : "F60000:1001");
+  }
+
+  vi_dump_rgba_to_yuv(dump->yuv, rgba);
+
+  return fputs("FRAME\n", dump->f) == EOF ||
+    fwrite(dump->yuv, VI_DUMP_Y4M_SIZE, 1, dump->f) != 1;
+}
+
+struct vi_dump *vi_dump_open(const char *path,
+  const char *format, bool wait) {
+  struct vi_dump *dump;
+  const char *ext;
+
+  if ((dump = calloc(1, sizeof(*dump))) == NULL)
+    return NULL;
+
+  dump->wait = wait;
+
+  if (format == NULL) {
+    ext = strrchr(path, '.');
+    format = ext && !strcmp(ext, ".y4m") ? "y4m" : "raw";
+  }
+
+  if (!strcmp(format, "y4m"))
+    dump->format = VI_DUMP_FORMAT_Y4M;
+
+  else if (!strcmp(format, "raw"))
+    dump->format = VI_DUMP_FORMAT_RAW;
+
+  else {
+    printf("Unknown video dump format: %s\n", format);
+    free(dump);
+    return NULL;
+  }
+
+  if (path[0] && strspn(path, "0123456789") == strlen(path))
+    dump->f = fdopen(atoi(path), "wb");
+  else
+    dump->f = fopen(path, "wb");
+
+  if (dump->f == NULL) {
+    printf("Can't open %s\n", path);
+    free(dump);
+    return NULL;
+  }
+
+  // Frames are written in one go; don't copy them through stdio.
+  setvbuf(dump->f, NULL, _IONBF, 0);
+
+#ifdef SIGPIPE
+  // If the reader goes away, fail the write instead of exiting.
+  signal(SIGPIPE, SIG_IGN);
+#endif
+
+  if (cen64_mutex_create(&dump->mutex))
+    goto err_mutex;
+
+  if (cen64_cv_create(&dump->filled_cv))
+    goto err_filled_cv;
+
+  if (cen64_cv_create(&dump->freed_cv))
+    goto err_freed_cv;
+
+  if (cen64_thread_create(&dump->thread, vi_dump_thread, dump))
+    goto err_thread;
+
+  cen64_thread_setname(&dump->thread, "vi_dump");
+  return dump;
+
+err_thread:
+  cen64_cv_destroy(&dump->freed_cv);
+err_freed_cv:
+  cen64_cv_destroy(&dump->filled_cv);
+err_filled_cv:
+  cen64_mutex_destroy(&dump->mutex);
+err_mutex:
+  fclose(dump->f);
+  free(dump);
+  return NULL;
+}
+
+// Writes out whatever is still queued up and closes the file.
+void vi_dump_close(struct vi_dump *dump) {
+  if (dump == NULL)
+    return;
+
+  cen64_mutex_lock(&dump->mutex);
+  dump->exiting = true;
+  cen64_cv_signal(&dump->filled_cv);
+  cen64_mutex_unlock(&dump->mutex);
+
+  cen64_thread_join(&dump->thread);
+
+  if (ferror(dump->f) | fclose(dump->f))
+    dump->failed = true;
+
+  printf("VI dump: %llu frames, %llu written, %llu dropped%s.\n",
+    dump->frames, dump->written, dump->dropped,
+    dump->failed ? " (write error)" : "");
+
+  cen64_cv_destroy(&dump->freed_cv);
+  cen64_cv_destroy(&dump->filled_cv);
+  cen64_mutex_destroy(&dump->mutex);
+  free(dump);
+}
+
+void vi_dump_frame(struct vi_dump *dump, const uint8_t *rgba, bool pal) {
+  if (dump->frames++ == 0)
+    dump->pal = pal;
+
+  cen64_mutex_lock(&dump->mutex);
+
+  while (dump->count == VI_DUMP_SLOTS && dump->wait && !dump->failed) {
+    cen64_cv_wait(&dump->freed_cv, &dump->mutex);
+    cen64_mutex_lock(&dump->mutex);
+  }
+
+  if (dump->count == VI_DUMP_SLOTS || dump->failed) {
+    cen64_mutex_unlock(&dump->mutex);
+    dump->dropped++;
+    return;
+  }
+
+  cen64_mutex_unlock(&dump->mutex);
+
+  // The slot at head isn't visible to the writer until count is
+  // bumped, so it can be filled in without holding the lock.
+  memcpy(dump->slots[dump->head], rgba, VI_DUMP_FRAME_SIZE);
+  dump->head = (dump->head + 1) % VI_DUMP_SLOTS;
+
+  cen64_mutex_lock(&dump->mutex);
+
+  if (dump->count++ == 0)
+    cen64_cv_signal(&dump->filled_cv);
+
+  cen64_mutex_unlock(&dump->mutex);
+}
+
+// Drains the ring until vi_dump_close is called and it's empty.
+static CEN64_THREAD_RETURN_TYPE vi_dump_thread(void *opaque) {
+  struct vi_dump *dump = (struct vi_dump *) opaque;
+  bool failed = false;
+
+  cen64_mutex_lock(&dump->mutex);
+
+  while (1) {
+    while (dump->count == 0 && !dump->exiting) {
+      cen64_cv_wait(&dump->filled_cv, &dump->mutex);
+      cen64_mutex_lock(&dump->mutex);
+    }
+
+    if (dump->count == 0)
+      break;
+
+    cen64_mutex_unlock(&dump->mutex);
+
+    if (!failed && vi_dump_write(dump, dump->slots[dump->tail]))
+      failed = true;
+
+    else if (!failed)
+      dump->written++;
+
+    dump->tail = (dump->tail + 1) % VI_DUMP_SLOTS;
+
+    cen64_mutex_lock(&dump->mutex);
+    dump->failed = failed;
+
+    if (dump->count-- == VI_DUMP_SLOTS)
+      cen64_cv_signal(&dump->freed_cv);
+  }
+
+  cen64_mutex_unlock(&dump->mutex);
+  return CEN64_THREAD_RETURN_VAL;
+}
+
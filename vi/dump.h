@@ -0,0 +1,38 @@
+//
+// vi/dump.h: VI output recording.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef CEN64_VI_DUMP_H
+#define CEN64_VI_DUMP_H
+#include "common.h"
+
+// Frames that can be queued up before the VI has to drop (or wait).
+#define VI_DUMP_SLOTS 8
+
+enum vi_dump_format {
+  VI_DUMP_FORMAT_RAW,  // VI_SOFT_WIDTH x VI_SOFT_HEIGHT RGBA frames
+  VI_DUMP_FORMAT_Y4M,  // YUV4MPEG2, 4:2:0, BT.601 limited range
+};
+
+struct vi_dump;
+
+// Opens path for writing (or, if it's a number, that file descriptor).
+// format is "raw" or "y4m"; if NULL, it's picked from the extension.
+// If wait is set, the VI waits for the writer instead of dropping
+// frames when the queue is full.
+cen64_cold struct vi_dump *vi_dump_open(const char *path,
+  const char *format, bool wait);
+cen64_cold void vi_dump_close(struct vi_dump *dump);
+
+// Queues up a frame from vi_soft_output. pal selects the frame rate
+// recorded in the Y4M header, and is only looked at on the first call.
+void vi_dump_frame(struct vi_dump *dump, const uint8_t *rgba, bool pal);
+
+#endif
+
@@ -0,0 +1,253 @@
+//
+// vi/hash.c: Per-frame frame buffer hashing.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// The hash is built like XXH3's long-input loop: eight 64-bit lanes
+// accumulate (data ^ key).lo * (data ^ key).hi over 64-byte stripes,
+// and are scrambled every kilobyte. The key changes with every stripe
+// so that moving data around within a frame changes the hash. The
+// SSE2 and portable versions produce the same hashes.
+//
+
+#include "common.h"
+#include "vi/hash.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define VI_HASH_STRIPE 64
+#define VI_HASH_STRIPES_PER_BLOCK 16
+
+#define VI_HASH_P1 0x9E3779B185EBCA87ULL
+#define VI_HASH_P2 0xC2B2AE3D27D4EB4FULL
+#define VI_HASH_P3 0x165667B19E3779F9ULL
+#define VI_HASH_P4 0x85EBCA77C2B2AE63ULL
+#define VI_HASH_P5 0x27D4EB2F165667C5ULL
+#define VI_HASH_P32 0x9E3779B1U
+
+cen64_align(static const uint64_t vi_hash_secret[8], 16) = {
+  VI_HASH_P1, VI_HASH_P2, VI_HASH_P3, VI_HASH_P4,
+  VI_HASH_P5, VI_HASH_P1 ^ VI_HASH_P3, VI_HASH_P2 ^ VI_HASH_P4,
+  VI_HASH_P3 ^ VI_HASH_P5,
+};
+
+struct vi_hash {
+  FILE *log;
+  FILE *ref;
+
+  unsigned long long frames;
+  bool diverged;
+};
+
+static uint64_t vi_hash_avalanche(uint64_t h) {
+  h ^= h >> 37;
+  h *= VI_HASH_P3;
+  h ^= h >> 32;
+  return h;
+}
+
+#ifdef __SSE2__
+static void vi_hash_stripes(uint64_t *acc_out, uint64_t *key_out,
+  const uint8_t *data, size_t stripes) {
+  const __m128i step = _mm_set_epi32(
+    (uint32_t) (VI_HASH_P5 >> 32), (uint32_t) VI_HASH_P5,
+    (uint32_t) (VI_HASH_P5 >> 32), (uint32_t) VI_HASH_P5);
+  const __m128i prime = _mm_set1_epi32(VI_HASH_P32);
+  __m128i acc[4], key[4];
+  size_t n;
+  unsigned j;
+
+  for (j = 0; j < 4; j++) {
+    acc[j] = _mm_loadu_si128((const __m128i *) (acc_out + j * 2));
+    key[j] = _mm_loadu_si128((const __m128i *) (key_out + j * 2));
+  }
+
+  for (n = 0; n < stripes; n++, data += VI_HASH_STRIPE) {
+    for (j = 0; j < 4; j++) {
+      __m128i d = _mm_loadu_si128((const __m128i *) (data + j * 16));
+      __m128i dk = _mm_xor_si128(d, key[j]);
+      __m128i dk_hi = _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1));
+
+      acc[j] = _mm_add_epi64(acc[j], _mm_mul_epu32(dk, dk_hi));
+      acc[j] = _mm_add_epi64(acc[j],
+        _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+
+      key[j] = _mm_add_epi64(key[j], step);
+    }
+
+    if ((n + 1) % VI_HASH_STRIPES_PER_BLOCK)
+      continue;
+
+    for (j = 0; j < 4; j++) {
+      __m128i secret = _mm_load_si128(
+        (const __m128i *) (vi_hash_secret + j * 2));
+      __m128i x = _mm_xor_si128(acc[j], _mm_srli_epi64(acc[j], 47));
+      __m128i lo, hi;
+
+      x = _mm_xor_si128(x, secret);
+      lo = _mm_mul_epu32(x, prime);
+      hi = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+      acc[j] = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+    }
+  }
+
+  for (j = 0; j < 4; j++) {
+    _mm_storeu_si128((__m128i *) (acc_out + j * 2), acc[j]);
+    _mm_storeu_si128((__m128i *) (key_out + j * 2), key[j]);
+  }
+}
+
+#else
+static uint64_t vi_hash_read64(const uint8_t *p) {
+  return (uint64_t) p[0] | (uint64_t) p[1] << 8 |
+    (uint64_t) p[2] << 16 | (uint64_t) p[3] << 24 |
+    (uint64_t) p[4] << 32 | (uint64_t) p[5] << 40 |
+    (uint64_t) p[6] << 48 | (uint64_t) p[7] << 56;
+}
+
+static void vi_hash_stripes(uint64_t *acc, uint64_t *key,
+  const uint8_t *data, size_t stripes) {
+  size_t n;
+  unsigned i;
+
+  for (n = 0; n < stripes; n++, data += VI_HASH_STRIPE) {
+    for (i = 0; i < 8; i++) {
+      uint64_t d = vi_hash_read64(data + i * 8);
+      uint64_t dk = d ^ key[i];
+
+      acc[i] += (dk & 0xFFFFFFFFU) * (dk >> 32);
+      acc[i ^ 1] += d;
+      key[i] += VI_HASH_P5;
+    }
+
+    if ((n + 1) % VI_HASH_STRIPES_PER_BLOCK)
+      continue;
+
+    for (i = 0; i < 8; i++) {
+      uint64_t x = acc[i] ^ (acc[i] >> 47) ^ vi_hash_secret[i];
+      acc[i] = x * VI_HASH_P32;
+    }
+  }
+}
+#endif
+
+uint64_t vi_hash_buffer(const uint8_t *data, size_t size) {
+  uint64_t acc[8] = {VI_HASH_P3, VI_HASH_P1, VI_HASH_P2, VI_HASH_P4,
+    VI_HASH_P5, VI_HASH_P1 + VI_HASH_P2, VI_HASH_P3 + VI_HASH_P4,
+    VI_HASH_P5 + VI_HASH_P1};
+
+  uint64_t key[8];
+  uint64_t h = size * VI_HASH_P1;
+  size_t stripes = size / VI_HASH_STRIPE;
+  size_t tail = size % VI_HASH_STRIPE;
+  unsigned i;
+
+  memcpy(key, vi_hash_secret, sizeof(key));
+  vi_hash_stripes(acc, key, data, stripes);
+
+  // Pad the last partial stripe with zeroes; the size is part of
+  // the hash, so that doesn't make different buffers collide.
+  if (tail) {
+    uint8_t last[VI_HASH_STRIPE];
+
+    memset(last, 0, sizeof(last));
+    memcpy(last, data + stripes * VI_HASH_STRIPE, tail);
+    vi_hash_stripes(acc, key, last, 1);
+  }
+
+  for (i = 0; i < 8; i++) {
+    h ^= vi_hash_avalanche(acc[i] ^ vi_hash_secret[i]);
+    h = ((h << 27) | (h >> 37)) * VI_HASH_P1 + VI_HASH_P4;
+  }
+
+  return vi_hash_avalanche(h);
+}
+
+struct vi_hash *vi_hash_open(const char *log_path, const char *ref_path) {
+  struct vi_hash *hash;
+
+  if ((hash = calloc(1, sizeof(*hash))) == NULL)
+    return NULL;
+
+  if (log_path && (hash->log = fopen(log_path, "w")) == NULL) {
+    printf("Can't open %s\n", log_path);
+    free(hash);
+    return NULL;
+  }
+
+  if (ref_path && (hash->ref = fopen(ref_path, "r")) == NULL) {
+    printf("Can't open %s\n", ref_path);
+
+    if (hash->log)
+      fclose(hash->log);
+
+    free(hash);
+    return NULL;
+  }
+
+  return hash;
+}
+
+void vi_hash_close(struct vi_hash *hash) {
+  if (hash == NULL)
+    return;
+
+  if (hash->log && (ferror(hash->log) | fclose(hash->log)))
+    printf("VI hash: Failed to write the log.\n");
+
+  if (hash->ref) {
+    fclose(hash->ref);
+
+    if (!hash->diverged)
+      printf("VI hash: %llu frames matched the reference.\n", hash->frames);
+  }
+
+  free(hash);
+}
+
+bool vi_hash_frame(struct vi_hash *hash, const uint8_t *data, size_t size) {
+  unsigned long long frame = hash->frames++;
+  unsigned long long ref_frame, ref_hash;
+  uint64_t h;
+
+  if (hash->diverged)
+    return false;
+
+  h = vi_hash_buffer(data, size);
+
+  if (hash->log)
+    fprintf(hash->log, "%llu %016llx\n", frame, (unsigned long long) h);
+
+  if (hash->ref == NULL)
+    return true;
+
+  // Past the end of the reference, there's nothing left to check.
+  if (fscanf(hash->ref, "%llu %llx", &ref_frame, &ref_hash) != 2) {
+    printf("VI hash: The reference ends at frame %llu.\n", frame);
+    fclose(hash->ref);
+    hash->ref = NULL;
+    return true;
+  }
+
+  if (ref_frame != frame || ref_hash != h) {
+    printf("VI hash: Frame %llu is %016llx, the reference has "
+      "%016llx for frame %llu.\n", frame, (unsigned long long) h,
+      ref_hash, ref_frame);
+
+    hash->diverged = true;
+    return false;
+  }
+
+  return true;
+}
+
+bool vi_hash_diverged(const struct vi_hash *hash) {
+  return hash->diverged;
+}
+
@@ -0,0 +1,33 @@
+//
+// vi/hash.h: Per-frame frame buffer hashing.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef CEN64_VI_HASH_H
+#define CEN64_VI_HASH_H
+#include "common.h"
+
+struct vi_hash;
+
+// Logs one "frame hash" line per VI frame to log_path and/or
+// compares against a log written earlier (ref_path); either may be
+// NULL, but not both.
+cen64_cold struct vi_hash *vi_hash_open(const char *log_path,
+  const char *ref_path);
+cen64_cold void vi_hash_close(struct vi_hash *hash);
+
+// Hashes the displayed part of the frame buffer. Returns false once
+// the hashes no longer match the reference log.
+bool vi_hash_frame(struct vi_hash *hash, const uint8_t *data, size_t size);
+bool vi_hash_diverged(const struct vi_hash *hash);
+
+// 64-bit hash of size bytes; same result on every host.
+uint64_t vi_hash_buffer(const uint8_t *data, size_t size);
+
+#endif
+
@@ -0,0 +1,90 @@
+//
+// vi/pacer.c: Real-time frame pacing.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Deadlines are kept relative to a fixed starting point rather than
+// to the previous frame, so wake-up errors don't add up over time.
+//
+
+#include "common.h"
+#include "timer.h"
+#include "vi/pacer.h"
+
+void vi_pacer_init(struct vi_pacer *pacer, bool turbo) {
+  memset(pacer, 0, sizeof(*pacer));
+
+  pacer->turbo = turbo;
+  pacer->resync = true;
+}
+
+void vi_pacer_report(const struct vi_pacer *pacer) {
+  printf("Pacer: %llu frames on time, %llu late; wake-up jitter "
+    "%.1f us avg, %.1f us max.\n", pacer->paced, pacer->late,
+    pacer->paced ? pacer->jitter_sum_ns / 1e3 / pacer->paced : 0.0,
+    pacer->jitter_max_ns / 1e3);
+}
+
+void vi_pacer_wait(struct vi_pacer *pacer, bool pal) {
+  unsigned rate_num = pal ? 50 : 60000;
+  unsigned rate_den = pal ? 1 : 1001;
+  unsigned long long deadline, elapsed, jitter;
+  cen64_time now;
+
+  get_time(&now);
+
+  if (pacer->turbo) {
+    pacer->resync = true;
+    return;
+  }
+
+  // Start over after running unpaced, or if the mode changed.
+  if (pacer->resync || rate_num != pacer->rate_num) {
+    pacer->epoch = now;
+    pacer->base_ns = 0;
+    pacer->frames = 0;
+    pacer->rate_num = rate_num;
+    pacer->rate_den = rate_den;
+    pacer->resync = false;
+  }
+
+  // Every rate_num frames take exactly rate_den seconds.
+  if (++pacer->frames == rate_num) {
+    pacer->base_ns += rate_den * NS_PER_SEC;
+    pacer->frames = 0;
+  }
+
+  deadline = pacer->base_ns +
+    pacer->frames * rate_den * NS_PER_SEC / rate_num;
+  elapsed = compute_time_difference(&now, &pacer->epoch);
+
+  if (elapsed >= deadline) {
+    pacer->late++;
+
+    if (elapsed - deadline > VI_PACER_MAX_LAG *
+      rate_den * NS_PER_SEC / rate_num)
+      pacer->resync = true;
+
+    return;
+  }
+
+  if (deadline - elapsed > VI_PACER_SPIN_NS)
+    sleep_ns(deadline - elapsed - VI_PACER_SPIN_NS);
+
+  do {
+    get_time(&now);
+    elapsed = compute_time_difference(&now, &pacer->epoch);
+  } while (elapsed < deadline);
+
+  jitter = elapsed - deadline;
+  pacer->jitter_sum_ns += jitter;
+  pacer->paced++;
+
+  if (jitter > pacer->jitter_max_ns)
+    pacer->jitter_max_ns = jitter;
+}
+
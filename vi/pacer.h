@@ -0,0 +1,51 @@
+//
+// vi/pacer.h: Real-time frame pacing.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef CEN64_VI_PACER_H
+#define CEN64_VI_PACER_H
+#include "common.h"
+#include "timer.h"
+
+// The last stretch before a deadline is spun out rather than slept,
+// since sleeps tend to overshoot by about this much.
+#define VI_PACER_SPIN_NS 200000ULL
+
+// If emulation falls further behind than this many frames, stop
+// trying to catch up and start over from the current time.
+#define VI_PACER_MAX_LAG 4
+
+struct vi_pacer {
+  cen64_time epoch;
+
+  // Deadline of the next frame: base_ns plus frames frame periods,
+  // at rate_num / rate_den frames per second.
+  unsigned long long base_ns;
+  unsigned frames;
+  unsigned rate_num, rate_den;
+
+  // Set from the UI thread to run unpaced.
+  volatile bool turbo;
+  bool resync;
+
+  unsigned long long paced;
+  unsigned long long late;
+  unsigned long long jitter_sum_ns;
+  unsigned long long jitter_max_ns;
+};
+
+cen64_cold void vi_pacer_init(struct vi_pacer *pacer, bool turbo);
+cen64_cold void vi_pacer_report(const struct vi_pacer *pacer);
+
+// Waits until it's time to show the next frame (a field at 60000/1001
+// or, if pal, 50 Hz).
+void vi_pacer_wait(struct vi_pacer *pacer, bool pal);
+
+#endif
+
@@ -11,6 +11,7 @@
 #include "common.h"
 #include "os/gl_window.h"
 #include "os/main.h"
+#include "vi/upload.h"
 
 // Initializes OpenGL to an default state.
 void gl_window_init(struct vi_controller *vi) {
@@ -42,8 +43,9 @@ void gl_window_init(struct vi_controller *vi) {
   vi->viuv[2] = vi->viuv[4] =
   vi->viuv[5] = vi->viuv[7] = 1;
 
-  // Tell OpenGL that the byte order is swapped.
-  glPixelStorei(GL_UNPACK_SWAP_BYTES, GL_TRUE);
+  // Have the VI copy frames straight into a mapped buffer, if we can.
+  vi_upload_init(&vi->upload, vi->window->frames.frames,
+    sizeof(vi->window->frames.frames) / sizeof(*vi->window->frames.frames));
 }
 
 // Renders a frame.
@@ -62,13 +64,8 @@ void gl_window_render_frame(struct vi_controller *vi, const uint8_t *buffer,
       return;
 
     case 2:
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, hres + hskip, vres,
-        0, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, buffer);
-      break;
-
     case 3:
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, hres + hskip, vres,
-        0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
+      vi_upload_frame(&vi->upload, buffer, hres + hskip, vres, type);
       break;
   }
 
@@ -88,8 +85,8 @@ void gl_window_render_frame(struct vi_controller *vi, const uint8_t *buffer,
 
   glDrawArrays(GL_QUADS, 0, 4);
 
-  // Gamma boost blend.
-  if (vi->regs[VI_STATUS_REG] & 0x8) {
+  // Gamma boost blend (the software VI applies the real gamma curve).
+  if (!vi->soft && (vi->regs[VI_STATUS_REG] & 0x8)) {
     glEnable(GL_BLEND);
     glColor3f(0.15f, 0.15f, 0.15f);
     glDrawArrays(GL_QUADS, 0, 4); // Texture quad blend
@@ -104,6 +101,9 @@ void gl_window_render_frame(struct vi_controller *vi, const uint8_t *buffer,
   }
 
   cen64_gl_window_swap_buffers(vi->window);
+
+  // The UI hands the frame back to the VI after this.
+  vi_upload_finish(&vi->upload);
 }
 
 // Called when the window was resized.
@@ -0,0 +1,317 @@
+//
+// vi/soft.c: Software VI output stage.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Produces what the VI would put on screen (antialiasing, dedithering,
+// divot removal, resampling and gamma) in software, without a GPU.
+// The VI lines of a frame are split between a few worker threads; the
+// thread calling vi_soft_render takes the first share itself.
+//
+
+#include "common.h"
+#include "thread.h"
+#include "vi/controller.h"
+#include "vi/soft.h"
+
+#define VI_SOFT_PITCH (VI_SOFT_WIDTH * 4)
+
+void angrylion_vi_render(const struct vi_soft_frame *frame,
+  uint8_t *out, size_t pitch, unsigned first, unsigned last);
+
+struct vi_soft_worker {
+  struct vi_soft *soft;
+  cen64_thread thread;
+  cen64_cv start_cv;
+
+  unsigned generation;
+  unsigned first, last;
+};
+
+struct vi_soft {
+  uint8_t output[VI_SOFT_HEIGHT * VI_SOFT_PITCH];
+  struct vi_soft_frame frame;
+  uint32_t frames;
+
+  struct vi_soft_worker workers[VI_SOFT_MAX_THREADS];
+  unsigned num_workers;
+
+  cen64_mutex mutex;
+  cen64_cv done_cv;
+  unsigned generation;
+  unsigned pending;
+  bool exiting;
+};
+
+static CEN64_THREAD_RETURN_TYPE vi_soft_thread(void *opaque);
+
+// Decodes the VI registers. Returns false if nothing is displayed.
+static bool vi_soft_setup(struct vi_soft_frame *frame,
+  const struct vi_controller *vi) {
+  uint32_t status = vi->regs[VI_STATUS_REG];
+  unsigned h_start, h_end, v_start, v_end;
+  unsigned h_base, v_base, aa_mode, skip;
+  bool pal;
+
+  if ((frame->type = status & 0x3) < 2)
+    return false;
+
+  aa_mode = (status >> 8) & 0x3;
+  frame->fsaa = aa_mode < 2;
+  frame->lerp = aa_mode != 3;
+  frame->fetch_bug = aa_mode == 1;
+  frame->dither_filter = (status >> 16) & 0x1;
+  frame->divot = (status >> 4) & 0x1;
+  frame->gamma_and_dither = (status >> 2) & 0x3;
+  frame->interlaced = (status >> 6) & 0x1;
+  frame->field = frame->interlaced ? vi->field & 0x1 : 0;
+
+  frame->origin = vi->regs[VI_ORIGIN_REG] & 0xFFFFFF;
+  frame->fb_width = vi->regs[VI_WIDTH_REG] & 0xFFF;
+  frame->x_start = (vi->regs[VI_X_SCALE_REG] >> 16) & 0xFFF;
+  frame->x_add = vi->regs[VI_X_SCALE_REG] & 0xFFF;
+  frame->y_start = (vi->regs[VI_Y_SCALE_REG] >> 16) & 0xFFF;
+  frame->y_add = vi->regs[VI_Y_SCALE_REG] & 0xFFF;
+
+  h_start = (vi->regs[VI_H_START_REG] >> 16) & 0x3FF;
+  h_end = vi->regs[VI_H_START_REG] & 0x3FF;
+  v_start = (vi->regs[VI_V_START_REG] >> 16) & 0x3FF;
+  v_end = vi->regs[VI_V_START_REG] & 0x3FF;
+
+  if (h_end <= h_start || v_end <= v_start)
+    return false;
+
+  frame->hres = h_end - h_start;
+  frame->vres = (v_end - v_start) >> 1;
+
+  // The output shows the picture area of a standard NTSC (or PAL)
+  // mode; whatever the VI shows outside of it is cut off.
+  pal = (vi->regs[VI_V_SYNC_REG] & 0x3FF) > 550;
+  h_base = pal ? 128 : 108;
+  v_base = pal ? 95 : 37;
+
+  if (h_start < h_base) {
+    skip = h_base - h_start;
+
+    if (skip >= frame->hres)
+      return false;
+
+    frame->x_start += skip * frame->x_add;
+    frame->hres -= skip;
+    frame->out_x = 0;
+  }
+
+  else if ((frame->out_x = h_start - h_base) >= VI_SOFT_WIDTH)
+    return false;
+
+  if (v_start < v_base) {
+    skip = (v_base - v_start + 1) >> 1;
+
+    if (skip >= frame->vres)
+      return false;
+
+    frame->y_start += skip * frame->y_add;
+    frame->vres -= skip;
+    frame->out_y = 0;
+  }
+
+  else if ((frame->out_y = (v_start - v_base) >> 1) >= VI_SOFT_HEIGHT / 2)
+    return false;
+
+  if (frame->hres > VI_SOFT_WIDTH - frame->out_x)
+    frame->hres = VI_SOFT_WIDTH - frame->out_x;
+
+  if (frame->vres > VI_SOFT_HEIGHT / 2 - frame->out_y)
+    frame->vres = VI_SOFT_HEIGHT / 2 - frame->out_y;
+
+  return frame->hres && frame->vres;
+}
+
+// Renders VI lines [first, last) of the current frame.
+static void vi_soft_render_lines(struct vi_soft *soft,
+  unsigned first, unsigned last) {
+  const struct vi_soft_frame *frame = &soft->frame;
+  size_t right = (frame->out_x + frame->hres) * 4;
+  uint8_t *out;
+  unsigned y;
+
+  if (first >= last)
+    return;
+
+  out = soft->output + (frame->out_y * 2 + frame->field) * VI_SOFT_PITCH;
+  angrylion_vi_render(frame, out, VI_SOFT_PITCH * 2, first, last);
+
+  for (y = first; y < last; y++) {
+    uint8_t *row = out + y * VI_SOFT_PITCH * 2;
+
+    memset(row, 0, frame->out_x * 4);
+    memset(row + right, 0, VI_SOFT_PITCH - right);
+
+    // Without interlacing, both fields show the same lines.
+    if (!frame->interlaced)
+      memcpy(row + VI_SOFT_PITCH, row, VI_SOFT_PITCH);
+  }
+}
+
+// Creates the output stage, along with threads - 1 worker threads.
+struct vi_soft *vi_soft_create(unsigned threads) {
+  struct vi_soft *soft;
+  unsigned i;
+
+  if (threads < 1)
+    threads = 1;
+
+  else if (threads > VI_SOFT_MAX_THREADS)
+    threads = VI_SOFT_MAX_THREADS;
+
+  if ((soft = calloc(1, sizeof(*soft))) == NULL)
+    return NULL;
+
+  if (cen64_mutex_create(&soft->mutex)) {
+    free(soft);
+    return NULL;
+  }
+
+  if (cen64_cv_create(&soft->done_cv)) {
+    cen64_mutex_destroy(&soft->mutex);
+    free(soft);
+    return NULL;
+  }
+
+  soft->num_workers = 1;
+
+  for (i = 1; i < threads; i++) {
+    struct vi_soft_worker *worker = soft->workers + i;
+
+    worker->soft = soft;
+
+    if (cen64_cv_create(&worker->start_cv))
+      break;
+
+    if (cen64_thread_create(&worker->thread, vi_soft_thread, worker)) {
+      cen64_cv_destroy(&worker->start_cv);
+      break;
+    }
+
+    cen64_thread_setname(&worker->thread, "vi");
+    soft->num_workers++;
+  }
+
+  if (soft->num_workers < threads)
+    printf("VI: Only started %u of %u software VI threads.\n",
+      soft->num_workers, threads);
+
+  return soft;
+}
+
+// Stops the worker threads and releases the output stage.
+void vi_soft_destroy(struct vi_soft *soft) {
+  unsigned i;
+
+  cen64_mutex_lock(&soft->mutex);
+  soft->exiting = true;
+  cen64_mutex_unlock(&soft->mutex);
+
+  for (i = 1; i < soft->num_workers; i++) {
+    cen64_cv_signal(&soft->workers[i].start_cv);
+    cen64_thread_join(&soft->workers[i].thread);
+    cen64_cv_destroy(&soft->workers[i].start_cv);
+  }
+
+  cen64_cv_destroy(&soft->done_cv);
+  cen64_mutex_destroy(&soft->mutex);
+  free(soft);
+}
+
+const uint8_t *vi_soft_output(const struct vi_soft *soft) {
+  return soft->output;
+}
+
+void vi_soft_render(struct vi_soft *soft, const struct vi_controller *vi) {
+  struct vi_soft_frame *frame = &soft->frame;
+  unsigned i, chunk, row, top, bottom;
+
+  if (!vi_soft_setup(frame, vi)) {
+    memset(soft->output, 0, sizeof(soft->output));
+    return;
+  }
+
+  frame->seed = soft->frames++;
+
+  // Blank the rows of this field that the VI doesn't cover.
+  top = frame->out_y * 2;
+  bottom = (frame->out_y + frame->vres) * 2;
+
+  for (row = frame->field; row < VI_SOFT_HEIGHT;
+    row += frame->interlaced ? 2 : 1) {
+    if (row < top || row >= bottom)
+      memset(soft->output + row * VI_SOFT_PITCH, 0, VI_SOFT_PITCH);
+  }
+
+  chunk = (frame->vres + soft->num_workers - 1) / soft->num_workers;
+
+  for (i = 0; i < soft->num_workers; i++) {
+    soft->workers[i].first = i * chunk < frame->vres ? i * chunk : frame->vres;
+    soft->workers[i].last = (i + 1) * chunk < frame->vres
+      ? (i + 1) * chunk : frame->vres;
+  }
+
+  if (soft->num_workers > 1) {
+    cen64_mutex_lock(&soft->mutex);
+    soft->generation++;
+    soft->pending = soft->num_workers - 1;
+    cen64_mutex_unlock(&soft->mutex);
+
+    for (i = 1; i < soft->num_workers; i++)
+      cen64_cv_signal(&soft->workers[i].start_cv);
+  }
+
+  vi_soft_render_lines(soft, soft->workers[0].first, soft->workers[0].last);
+
+  if (soft->num_workers > 1) {
+    cen64_mutex_lock(&soft->mutex);
+
+    while (soft->pending) {
+      cen64_cv_wait(&soft->done_cv, &soft->mutex);
+      cen64_mutex_lock(&soft->mutex);
+    }
+
+    cen64_mutex_unlock(&soft->mutex);
+  }
+}
+
+// Renders its share of each frame as vi_soft_render hands them out.
+static CEN64_THREAD_RETURN_TYPE vi_soft_thread(void *opaque) {
+  struct vi_soft_worker *worker = (struct vi_soft_worker *) opaque;
+  struct vi_soft *soft = worker->soft;
+
+  cen64_mutex_lock(&soft->mutex);
+
+  while (1) {
+    while (worker->generation == soft->generation && !soft->exiting) {
+      cen64_cv_wait(&worker->start_cv, &soft->mutex);
+      cen64_mutex_lock(&soft->mutex);
+    }
+
+    if (soft->exiting)
+      break;
+
+    worker->generation = soft->generation;
+    cen64_mutex_unlock(&soft->mutex);
+
+    vi_soft_render_lines(soft, worker->first, worker->last);
+
+    cen64_mutex_lock(&soft->mutex);
+
+    if (--soft->pending == 0)
+      cen64_cv_signal(&soft->done_cv);
+  }
+
+  cen64_mutex_unlock(&soft->mutex);
+  return CEN64_THREAD_RETURN_VAL;
+}
+
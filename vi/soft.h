@@ -0,0 +1,60 @@
+//
+// vi/soft.h: Software VI output stage.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef CEN64_VI_SOFT_H
+#define CEN64_VI_SOFT_H
+#include "common.h"
+
+#define VI_SOFT_WIDTH 640
+#define VI_SOFT_HEIGHT 480
+#define VI_SOFT_MAX_THREADS 16
+
+struct vi_controller;
+struct vi_soft;
+
+// What the VI registers say about the frame being scanned out,
+// already clipped to the output. The filters run once per VI line;
+// line y ends up in output row (y * 2 + field), or in both rows of
+// the pair if the mode isn't interlaced.
+struct vi_soft_frame {
+  uint32_t origin;
+  unsigned fb_width;
+  unsigned type;
+
+  bool fsaa;
+  bool dither_filter;
+  bool divot;
+  bool lerp;
+  bool fetch_bug;
+  unsigned gamma_and_dither;
+
+  uint32_t x_start, x_add;
+  uint32_t y_start, y_add;
+  unsigned hres, vres;
+
+  unsigned out_x, out_y;
+  unsigned field;
+  bool interlaced;
+
+  uint32_t seed;
+};
+
+cen64_cold struct vi_soft *vi_soft_create(unsigned threads);
+cen64_cold void vi_soft_destroy(struct vi_soft *soft);
+
+// Runs the VI filters over the frame buffer the VI currently points
+// at, leaving the result in the buffer returned by vi_soft_output.
+void vi_soft_render(struct vi_soft *soft, const struct vi_controller *vi);
+
+// VI_SOFT_WIDTH x VI_SOFT_HEIGHT pixels, stored as R, G, B, A bytes.
+const uint8_t *vi_soft_output(const struct vi_soft *soft);
+
+#endif
+
@@ -0,0 +1,213 @@
+//
+// vi/upload.c: Frame uploads to OpenGL.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+// Where the driver has buffer storage (GL 4.4, or ARB_buffer_storage;
+// Mesa's software rasterizers included), the frame queue's frames live
+// in one persistently mapped pixel unpack buffer. The VI copies RDRAM
+// straight into it, and the UI thread has the texture sourced from it
+// without an intermediate copy. A fence after each upload keeps the
+// frame from going back to the VI while the driver may still read it.
+//
+// Either way, the texture's storage is only reallocated when the
+// frame size changes; otherwise frames are uploaded into it in place.
+//
+
+#include "common.h"
+#include "os/gl_window.h"
+#include "gl_common.h"
+#include "gl_context.h"
+#include "vi/upload.h"
+
+#ifdef _WIN32
+#define CEN64_GL_APIENTRY __stdcall
+#else
+#define CEN64_GL_APIENTRY
+#endif
+
+// Not all platform headers go past OpenGL 1.1.
+#ifndef GL_UNSIGNED_SHORT_5_5_5_1
+#define GL_UNSIGNED_SHORT_5_5_5_1 0x8034
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+
+#define VI_UPLOAD_MAP_FLAGS (GL_MAP_WRITE_BIT | \
+  GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+
+// How long to wait on a fence at a time (in ns).
+#define VI_UPLOAD_FENCE_TIMEOUT 100000000ULL
+
+static struct {
+  void (CEN64_GL_APIENTRY *gen_buffers)(GLsizei n, GLuint *buffers);
+  void (CEN64_GL_APIENTRY *delete_buffers)(GLsizei n, const GLuint *buffers);
+  void (CEN64_GL_APIENTRY *bind_buffer)(GLenum target, GLuint buffer);
+  void (CEN64_GL_APIENTRY *buffer_storage)(GLenum target, ptrdiff_t size,
+    const void *data, GLbitfield flags);
+  void *(CEN64_GL_APIENTRY *map_buffer_range)(GLenum target,
+    ptrdiff_t offset, ptrdiff_t length, GLbitfield access);
+  void *(CEN64_GL_APIENTRY *fence_sync)(GLenum condition, GLbitfield flags);
+  GLenum (CEN64_GL_APIENTRY *client_wait_sync)(void *sync,
+    GLbitfield flags, uint64_t timeout);
+  void (CEN64_GL_APIENTRY *delete_sync)(void *sync);
+} gl;
+
+// Function pointers can't portably be assigned from a void *,
+// but they can be written through one.
+#define VI_UPLOAD_LOAD(member, name) \
+  (*(void **) &gl.member = cen64_gl_context_get_proc(name))
+
+// Checks for a whole token in the extension string.
+static bool vi_upload_has_extension(const char *name) {
+  const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+  size_t length = strlen(name);
+  const char *match;
+
+  for (match = extensions; match && (match = strstr(match, name));
+    match += length) {
+    if ((match == extensions || match[-1] == ' ') &&
+      (match[length] == ' ' || match[length] == '\0'))
+      return true;
+  }
+
+  return false;
+}
+
+static bool vi_upload_has_version(unsigned major, unsigned minor) {
+  const char *version = (const char *) glGetString(GL_VERSION);
+  unsigned have_major, have_minor;
+
+  if (version == NULL ||
+    sscanf(version, "%u.%u", &have_major, &have_minor) != 2)
+    return false;
+
+  return have_major > major || (have_major == major && have_minor >= minor);
+}
+
+static bool vi_upload_load_procs(void) {
+  if (!vi_upload_has_version(4, 4) &&
+    !vi_upload_has_extension("GL_ARB_buffer_storage"))
+    return false;
+
+  if (!vi_upload_has_version(3, 2) && !vi_upload_has_extension("GL_ARB_sync"))
+    return false;
+
+  // Buffer objects and unpack buffers are core in any version
+  // that has buffer storage.
+  VI_UPLOAD_LOAD(gen_buffers, "glGenBuffers");
+  VI_UPLOAD_LOAD(delete_buffers, "glDeleteBuffers");
+  VI_UPLOAD_LOAD(bind_buffer, "glBindBuffer");
+  VI_UPLOAD_LOAD(buffer_storage, "glBufferStorage");
+  VI_UPLOAD_LOAD(map_buffer_range, "glMapBufferRange");
+  VI_UPLOAD_LOAD(fence_sync, "glFenceSync");
+  VI_UPLOAD_LOAD(client_wait_sync, "glClientWaitSync");
+  VI_UPLOAD_LOAD(delete_sync, "glDeleteSync");
+
+  return gl.gen_buffers && gl.delete_buffers && gl.bind_buffer &&
+    gl.buffer_storage && gl.map_buffer_range && gl.fence_sync &&
+    gl.client_wait_sync && gl.delete_sync;
+}
+
+bool vi_upload_init(struct vi_upload *upload,
+  struct cen64_frame *frames, unsigned count) {
+  GLuint pbo;
+  unsigned i;
+
+  memset(upload, 0, sizeof(*upload));
+
+  if (!vi_upload_load_procs())
+    return false;
+
+  upload->size = (size_t) count * FRAMEBUF_SZ;
+
+  while (glGetError() != GL_NO_ERROR);
+  gl.gen_buffers(1, &pbo);
+  gl.bind_buffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+  gl.buffer_storage(GL_PIXEL_UNPACK_BUFFER, upload->size,
+    NULL, VI_UPLOAD_MAP_FLAGS);
+
+  upload->mapping = (uint8_t *) gl.map_buffer_range(GL_PIXEL_UNPACK_BUFFER,
+    0, upload->size, VI_UPLOAD_MAP_FLAGS);
+
+  gl.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  if (glGetError() != GL_NO_ERROR || upload->mapping == NULL) {
+    gl.delete_buffers(1, &pbo);
+    upload->mapping = NULL;
+    return false;
+  }
+
+  upload->pbo = pbo;
+
+  // The VI hasn't started yet; it'll do full copies into these.
+  for (i = 0; i < count; i++) {
+    frames[i].data = upload->mapping + (size_t) i * FRAMEBUF_SZ;
+    frames[i].size = 0;
+  }
+
+  return true;
+}
+
+void vi_upload_frame(struct vi_upload *upload, const uint8_t *buffer,
+  unsigned width, unsigned height, unsigned type) {
+  GLenum format = type == 2 ? GL_UNSIGNED_SHORT_5_5_5_1 : GL_UNSIGNED_BYTE;
+
+  if (width != upload->width || height != upload->height) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
+      0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    upload->width = width;
+    upload->height = height;
+  }
+
+  if (upload->mapping && buffer >= upload->mapping &&
+    buffer < upload->mapping + upload->size) {
+    gl.bind_buffer(GL_PIXEL_UNPACK_BUFFER, upload->pbo);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, format,
+      (const void *) (uintptr_t) (buffer - upload->mapping));
+    gl.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    upload->fence = gl.fence_sync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+
+  else {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+      GL_RGBA, format, buffer);
+  }
+}
+
+void vi_upload_finish(struct vi_upload *upload) {
+  if (upload->fence == NULL)
+    return;
+
+  while (gl.client_wait_sync(upload->fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+    VI_UPLOAD_FENCE_TIMEOUT) == GL_TIMEOUT_EXPIRED);
+
+  gl.delete_sync(upload->fence);
+  upload->fence = NULL;
+}
+
@@ -0,0 +1,46 @@
+//
+// vi/upload.h: Frame uploads to OpenGL.
+//
+// CEN64: Cycle-Accurate Nintendo 64 Emulator.
+// Copyright (C) 2015, Tyler J. Stachecki.
+//
+// This file is subject to the terms and conditions defined in
+// 'LICENSE', which is part of this source code package.
+//
+
+#ifndef CEN64_VI_UPLOAD_H
+#define CEN64_VI_UPLOAD_H
+#include "common.h"
+#include "frame_queue.h"
+
+struct vi_upload {
+  // Persistently mapped pixel buffer holding every queued frame's
+  // data (NULL if the driver can't do that).
+  unsigned pbo;
+  uint8_t *mapping;
+  size_t size;
+
+  // Signalled once the last upload out of the buffer is done.
+  void *fence;
+
+  // Size of the texture's storage.
+  unsigned width, height;
+};
+
+// Points the frames at a persistently mapped pixel buffer, if the
+// driver supports it; returns false (and leaves the frames alone) if
+// not, in which case frames are uploaded from client memory.
+cen64_cold bool vi_upload_init(struct vi_upload *upload,
+  struct cen64_frame *frames, unsigned count);
+
+// Copies a frame into the bound texture, reallocating its storage
+// only when the size changes. type is the VI's pixel format.
+void vi_upload_frame(struct vi_upload *upload, const uint8_t *buffer,
+  unsigned width, unsigned height, unsigned type);
+
+// Waits until the last upload is done with the frame's data, so that
+// the frame can be handed back to the VI.
+void vi_upload_finish(struct vi_upload *upload);
+
+#endif
+